@@ -14,8 +14,8 @@ do
     echo "Processing file $FileName"
     for RNum in $(seq 1 $N_REPETITIONS)
     do
-        >&2 echo "Run.." $RNum " with params " "--maxEvents 100 --inputFile data/input/$FileName.csv --numberOfStreams 2"
-        $CMD --maxEvents 100 --inputFile data/input/$FileName.csv --numberOfStreams 2 2> /dev/null | tail -1 | cut -d' ' -f 5 
+        >&2 echo "Run.." $RNum " with params " "--maxEvents 100 --inputFile data/input/$FileName.bin --numberOfStreams 2"
+        $CMD --maxEvents 100 --inputFile data/input/$FileName.bin --numberOfStreams 2 2> /dev/null | tail -1 | cut -d' ' -f 5 
     done
 done
 
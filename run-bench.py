@@ -0,0 +1,310 @@
+#!/usr/bin/env python3
+
+import os
+import json
+import math
+import time
+import random
+import socket
+import struct
+import argparse
+import platform
+import importlib
+import statistics
+import subprocess
+import collections
+import multiprocessing
+
+scan = importlib.import_module("run-scan")
+
+# Pipeline stages that can be benchmarked, with the program arguments enabling them
+default_stages = {
+    "framework": ["--empty"],
+    "clue": [],
+    "validation": ["--validation"],
+}
+
+Point = collections.namedtuple("Point", ["backend", "input", "threads", "streams", "stage"])
+
+"""
+Example of a benchmark configuration file
+
+{
+  "backends": {
+    "serial": "./serial",
+    "alpaka-tbb": "./alpaka --tbb"
+  },
+  "inputs": [
+    "data/input/raw2D.bin",
+    {"path": "data/input/raw3D.bin", "dim": 3},
+    {"name": "synthetic2D_10k", "dim": 2, "events": 100, "points": 10000, "seed": 1}
+  ],
+  "threads": [1, 4],
+  "streams": [0],
+  "stages": ["framework", "clue"],
+  "events": 1000,
+  "repeat": 5,
+  "args": ["--configFile", "config/hgcal_config.csv"]
+}
+
+A stream number 0 means the same number of streams as threads. Inputs
+given as objects without a "path" are generated (once) in the
+--syntheticDir directory, "dim": 3 adds '--dim 3' to the command.
+"""
+
+def machineMetadata():
+    data = dict(
+        hostname=socket.gethostname(),
+        platform=platform.platform(),
+        python=platform.python_version(),
+        cores=multiprocessing.cpu_count(),
+        date=time.strftime("%Y-%m-%d %H:%M:%S"),
+    )
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    data["cpu"] = line.split(":", 1)[1].strip()
+                    break
+        with open("/proc/meminfo") as f:
+            for line in f:
+                if line.startswith("MemTotal"):
+                    data["memory_kB"] = int(line.split()[1])
+                    break
+    except OSError:
+        pass
+    try:
+        data["commit"] = subprocess.check_output(["git", "rev-parse", "HEAD"], stderr=subprocess.DEVNULL,
+                                                 universal_newlines=True, cwd=os.path.dirname(os.path.abspath(__file__))).strip()
+    except (OSError, subprocess.CalledProcessError):
+        pass
+    return data
+
+def writeSynthetic(path, dim, events, points, seed):
+    """Write a raw input file with 'events' events of 'points' points each, grouped in gaussian blobs"""
+    rng = random.Random(seed)
+    with open(path, "wb") as out:
+        for ev in range(events):
+            out.write(struct.pack("I", points))
+            nblobs = max(1, points // 50)
+            if dim == 2:
+                # blobs in x-y on each of the 100 layers
+                blobs = [(rng.uniform(-200, 200), rng.uniform(-200, 200)) for i in range(nblobs)]
+                for i in range(points):
+                    (cx, cy) = blobs[rng.randrange(nblobs)]
+                    out.write(struct.pack("4f", rng.gauss(cx, 3.0), rng.gauss(cy, 3.0), rng.randrange(100), rng.expovariate(1.0)))
+            else:
+                # showers in eta-phi, developing along the 47 layers of either endcap
+                blobs = [(rng.choice([-1.0, 1.0]), rng.uniform(1.7, 2.8), rng.uniform(-math.pi, math.pi)) for i in range(nblobs)]
+                for i in range(points):
+                    (side, ceta, cphi) = blobs[rng.randrange(nblobs)]
+                    layer = rng.randrange(47)
+                    eta = rng.gauss(ceta, 0.02)
+                    phi = math.remainder(rng.gauss(cphi, 0.02), 2*math.pi)
+                    z = side * (320.0 + layer)
+                    r = abs(z) / math.sinh(eta)
+                    out.write(struct.pack("10f", r*math.cos(phi), r*math.sin(phi), z, side*eta, phi, r/abs(z), 2.0,
+                                          layer + (47 if side > 0 else 0), rng.expovariate(1.0), 1.0))
+
+def resolveInputs(inputs, syntheticDir):
+    """Return a list of (name, path, program arguments) and generate the synthetic inputs that do not exist yet"""
+    ret = []
+    for inp in inputs:
+        if isinstance(inp, str):
+            inp = dict(path=inp)
+        dim = inp.get("dim", 2)
+        args = inp.get("args", []) + (["--dim", "3"] if dim == 3 else [])
+        if "path" in inp:
+            ret.append((inp.get("name", os.path.basename(inp["path"])), inp["path"], args))
+            continue
+        name = inp["name"]
+        path = os.path.join(syntheticDir, name+".bin")
+        if not os.path.exists(path):
+            os.makedirs(syntheticDir, exist_ok=True)
+            scan.printMessage("Generating synthetic input {}".format(path))
+            writeSynthetic(path, dim, inp.get("events", 100), inp.get("points", 10000), inp.get("seed", 1))
+        ret.append((name, path, args))
+    return ret
+
+def runPoint(command, logfilename, dryRun):
+    with open(logfilename, "w") as logfile:
+        logfile.write(" ".join(command))
+        logfile.write("\n----\n")
+        logfile.flush()
+        if dryRun:
+            print(" ".join(command))
+            return None
+        p = subprocess.run(command, stdout=logfile, stderr=subprocess.STDOUT, universal_newlines=True)
+        if p.returncode != 0:
+            raise Exception("Got return code %d, see output in the log file %s" % (p.returncode, logfilename))
+    with open(logfilename) as logfile:
+        return scan.throughput(logfile, logfilename)
+
+def pointKey(point):
+    return "/".join(str(x) for x in point)
+
+def runMatrix(opts):
+    with open(opts.config) as inp:
+        config = json.load(inp)
+    stages = dict(default_stages)
+    stages.update(config.get("stageArgs", {}))
+    inputs = resolveInputs(config["inputs"], opts.syntheticDir)
+    repeat = opts.repeat if opts.repeat > 0 else config.get("repeat", 3)
+    events = config.get("events", 1000)
+    commonArgs = config.get("args", [])
+
+    data = dict(metadata=machineMetadata(), config=config, results={})
+    if os.path.exists(opts.output) and not opts.overwrite:
+        with open(opts.output) as inp:
+            data["results"] = json.load(inp).get("results", {})
+
+    for backend, program in config["backends"].items():
+        for inputName, inputPath, inputArgs in inputs:
+            for nth in config.get("threads", [1]):
+                for nstr in config.get("streams", [0]):
+                    for stage in config.get("stages", ["clue"]):
+                        point = Point(backend, inputName, nth, nstr if nstr > 0 else nth, stage)
+                        key = pointKey(point)
+                        if key in data["results"]:
+                            continue
+                        command = program.split() + ["--inputFile", inputPath, "--maxEvents", str(events),
+                                                     "--numberOfThreads", str(nth), "--numberOfStreams", str(point.streams)]
+                        command += inputArgs + commonArgs + stages[stage]
+                        scan.printMessage("Running {}".format(key))
+                        throughputs = []
+                        for i in range(repeat):
+                            logfilename = "{}_log_{}_n{}.txt".format(os.path.splitext(opts.output)[0], key.replace("/", "_"), i)
+                            measurement = runPoint(command, logfilename, opts.dryRun)
+                            if measurement is not None:
+                                throughputs.append(measurement.throughput)
+                        if opts.dryRun:
+                            continue
+                        data["results"][key] = dict(point._asdict(), command=" ".join(command), throughput=throughputs,
+                                                    mean=statistics.mean(throughputs),
+                                                    stdev=statistics.stdev(throughputs) if len(throughputs) > 1 else 0.0)
+                        # Save results after each point
+                        with open(opts.output, "w") as out:
+                            json.dump(data, out, indent=2)
+
+def betacf(a, b, x):
+    """Continued fraction of the incomplete beta function (modified Lentz)"""
+    tiny = 1e-300
+    qab = a + b
+    qap = a + 1.0
+    qam = a - 1.0
+    c = 1.0
+    d = 1.0 - qab * x / qap
+    d = tiny if abs(d) < tiny else d
+    d = 1.0 / d
+    h = d
+    for m in range(1, 300):
+        m2 = 2 * m
+        aa = m * (b - m) * x / ((qam + m2) * (a + m2))
+        d = 1.0 + aa * d
+        d = tiny if abs(d) < tiny else d
+        c = 1.0 + aa / c
+        c = tiny if abs(c) < tiny else c
+        d = 1.0 / d
+        h *= d * c
+        aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2))
+        d = 1.0 + aa * d
+        d = tiny if abs(d) < tiny else d
+        c = 1.0 + aa / c
+        c = tiny if abs(c) < tiny else c
+        d = 1.0 / d
+        delta = d * c
+        h *= delta
+        if abs(delta - 1.0) < 1e-12:
+            break
+    return h
+
+def incompleteBeta(a, b, x):
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    lbeta = math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) + a * math.log(x) + b * math.log(1.0 - x)
+    if x < (a + 1.0) / (a + b + 2.0):
+        return math.exp(lbeta) * betacf(a, b, x) / a
+    return 1.0 - math.exp(lbeta) * betacf(b, a, 1.0 - x) / b
+
+def welchTest(sample, baseline):
+    """Two-sided p-value of Welch's t-test for the means of the two samples"""
+    n1, n2 = len(sample), len(baseline)
+    if n1 < 2 or n2 < 2:
+        return float("nan")
+    v1 = statistics.variance(sample) / n1
+    v2 = statistics.variance(baseline) / n2
+    if v1 + v2 == 0.0:
+        return 0.0 if statistics.mean(sample) != statistics.mean(baseline) else 1.0
+    t = (statistics.mean(sample) - statistics.mean(baseline)) / math.sqrt(v1 + v2)
+    dof = (v1 + v2)**2 / (v1**2 / (n1 - 1) + v2**2 / (n2 - 1))
+    return incompleteBeta(dof / 2.0, 0.5, dof / (dof + t * t))
+
+def compare(opts):
+    with open(opts.results) as inp:
+        results = json.load(inp)
+    with open(opts.baseline) as inp:
+        baseline = json.load(inp)
+    if results["metadata"].get("cpu") != baseline["metadata"].get("cpu"):
+        print("WARNING: comparing results from different CPUs ('{}' vs. baseline '{}')".format(
+            results["metadata"].get("cpu"), baseline["metadata"].get("cpu")))
+
+    regressions = 0
+    print("{:<60} {:>12} {:>12} {:>8} {:>8}".format("point", "baseline", "current", "change", "p-value"))
+    for key, res in sorted(results["results"].items()):
+        base = baseline["results"].get(key)
+        if base is None:
+            continue
+        change = res["mean"] / base["mean"] - 1.0 if base["mean"] > 0 else 0.0
+        pvalue = welchTest(res["throughput"], base["throughput"])
+        flag = ""
+        if pvalue < opts.alpha and abs(change) > opts.threshold:
+            flag = "REGRESSION" if change < 0 else "improvement"
+            if change < 0:
+                regressions += 1
+        print("{:<60} {:>12.2f} {:>12.2f} {:>+7.1f}% {:>8.3f} {}".format(key, base["mean"], res["mean"], change*100, pvalue, flag))
+    print()
+    print("Found {} significant regression(s) (p < {}, change larger than {:.1f}%)".format(regressions, opts.alpha, opts.threshold*100))
+    return 1 if regressions > 0 else 0
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Run a matrix of benchmarks (backends x inputs x threads x streams x pipeline stages) and compare the results against a saved baseline.")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    run_parser = sub.add_parser("run", help="Run the benchmark matrix")
+    run_parser.add_argument("config", type=str,
+                            help="JSON file with the benchmark matrix (see the top of this script)")
+    run_parser.add_argument("-o", "--output", type=str, default="bench.json",
+                            help="Output JSON file. If it exists, the points already in it are skipped (see also --overwrite) (default: 'bench.json')")
+    run_parser.add_argument("--overwrite", action="store_true",
+                            help="Overwrite the output JSON instead of updating it")
+    run_parser.add_argument("--repeat", type=int, default=-1,
+                            help="Repeat each point this many times (default: -1 to take it from the configuration, or 3)")
+    run_parser.add_argument("--syntheticDir", type=str, default="data/synthetic",
+                            help="Directory for the generated synthetic inputs (default: 'data/synthetic')")
+    run_parser.add_argument("--dryRun", action="store_true",
+                            help="Print out commands, don't actually run anything")
+
+    compare_parser = sub.add_parser("compare", help="Compare results against a baseline, the exit code is 1 if there are regressions")
+    compare_parser.add_argument("results", type=str, help="Output JSON of 'run'")
+    compare_parser.add_argument("baseline", type=str, help="Output JSON of 'run' used as the baseline")
+    compare_parser.add_argument("--alpha", type=float, default=0.05,
+                                help="Significance level of the Welch t-test (default: 0.05)")
+    compare_parser.add_argument("--threshold", type=float, default=0.02,
+                                help="Minimum relative change of the mean throughput to be reported (default: 0.02)")
+
+    synthetic_parser = sub.add_parser("synthetic", help="Generate a synthetic raw input file")
+    synthetic_parser.add_argument("output", type=str, help="Output file")
+    synthetic_parser.add_argument("--dim", type=int, default=2, choices=[2, 3])
+    synthetic_parser.add_argument("--events", type=int, default=100)
+    synthetic_parser.add_argument("--points", type=int, default=10000)
+    synthetic_parser.add_argument("--seed", type=int, default=1)
+
+    opts = parser.parse_args()
+    if opts.command == "run":
+        runMatrix(opts)
+    elif opts.command == "compare":
+        exit(compare(opts))
+    else:
+        writeSynthetic(opts.output, opts.dim, opts.events, opts.points, opts.seed)
@@ -64,6 +64,9 @@ class Program:
         else:
             command.extend(["--maxEvents", str(self._events)])
         command.extend(["--numberOfThreads", str(self._threads), "--numberOfStreams", str(self._streams)])
+        if opts.monitorEnergy:
+            # the counters cover the whole sockets, shared by all the programs
+            command.append("--energy")
         msg = "Program {} threads {} streams {}".format(self.programShort(), self._threads, self._streams)
         if self._numa is not None:
             command = ["numactl", "--cpunodebind={}".format(self._numa), "--membind={}".format(self._numa)] + command
@@ -31,7 +31,9 @@ background_events_per_thread = 30*3600*8
 
 result_re = re.compile("Processed (?P<events>\d+) events in (?P<time>\S+) seconds, throughput (?P<throughput>\S+) events/s, CPU usage per thread: (?P<cpueff>\d+(.\d+)?)%")
 
-Measurement = collections.namedtuple("Measurement", ["events", "time", "throughput", "cpueff"])
+energy_re = re.compile("Energy: package (?P<package>\S+) J \((?P<packageWatts>\S+) W\)(, DRAM (?P<dram>\S+) J \((?P<dramWatts>\S+) W\))?(, (?P<eventsPerJoule>\S+) events/J)?")
+
+Measurement = collections.namedtuple("Measurement", ["events", "time", "throughput", "cpueff", "energy"])
 GPU = collections.namedtuple("GPU", ["id", "name", "driver_version"])
 GPUStatus = collections.namedtuple("GPUStatus", ["utilization", "temperature", "power", "clock"])
 BackgroundJob = collections.namedtuple("BackgroundJob", ["handle", "logfile", "cores"])
@@ -44,11 +46,14 @@ class Monitor:
         self._monitorClock = opts.monitorClock
         self._monitorUtilization = opts.monitorUtilization
         self._monitorCuda = opts.monitorCuda
+        self._monitorTelemetry = opts.monitorTelemetry
+        self._telemetryFile = None
 
         self._timeStamp = []
         self._dataProcess = []
         self._dataClock = {x: [] for x in range(0, multiprocessing.cpu_count())}
         self._dataCuda = {x: [] for x in cudaDevices}
+        self._dataTelemetry = []
 
     def setIntervalSeconds(self, interval):
         self._intervalSeconds = interval
@@ -56,6 +61,22 @@ class Monitor:
     def intervalSeconds(self):
         return self._intervalSeconds
 
+    def telemetryArguments(self, logfilename):
+        """Command line arguments to make the program report its own telemetry (--monitorInterval) into a JSON-lines file"""
+        if self._intervalSeconds is None or not self._monitorTelemetry:
+            return []
+        self._telemetryFile = os.path.splitext(logfilename)[0]+"_telemetry.jsonl"
+        return ["--monitorInterval", str(self._intervalSeconds), "--monitorOutput", "file:"+self._telemetryFile]
+
+    def readTelemetry(self):
+        if self._telemetryFile is None or not os.path.exists(self._telemetryFile):
+            return
+        with open(self._telemetryFile) as inp:
+            for line in inp:
+                line = line.strip()
+                if line:
+                    self._dataTelemetry.append(json.loads(line))
+
     def snapshot(self, pid=None, cudaDevices=[]):
         if self._intervalSeconds is None:
             return
@@ -93,20 +114,44 @@ class Monitor:
                     data["host"]["cpu"] = self._dataClock
             if self._monitorCuda:
                 data["cuda"] = self._dataCuda
+            if self._monitorTelemetry:
+                data["telemetry"] = self._dataTelemetry
         return data
 
 
 def printMessage(*args):
     print(time.strftime("%y-%m-%d %H:%M:%S"), *args)
 
+def energy(line):
+    """Energy reported by the program with --energy, as a dict, or None if the line does not hold it"""
+    m = energy_re.search(line)
+    if not m:
+        return None
+    ret = dict(packageJoules=float(m.group("package")), packageWatts=float(m.group("packageWatts")))
+    if m.group("dram") is not None:
+        ret["dramJoules"] = float(m.group("dram"))
+        ret["dramWatts"] = float(m.group("dramWatts"))
+    if m.group("eventsPerJoule") is not None:
+        ret["eventsPerJoule"] = float(m.group("eventsPerJoule"))
+    return ret
+
 def throughput(output, filename):
+    # the last throughput counts, as some modes (e.g. --coldCache) run a reference first
+    measurement = None
     for line in output:
         m = result_re.search(line)
         if m:
             printMessage(line.rstrip())
-            return Measurement(int(m.group("events")), float(m.group("time")), float(m.group("throughput")), float(m.group("cpueff")))
+            measurement = Measurement(int(m.group("events")), float(m.group("time")), float(m.group("throughput")), float(m.group("cpueff")), None)
+            continue
+        e = energy(line)
+        if e is not None and measurement is not None:
+            printMessage(line.rstrip())
+            measurement = measurement._replace(energy=e)
 
-    raise Exception("Did not find throughput from the log")
+    if measurement is None:
+        raise Exception("Did not find throughput from the log")
+    return measurement
 
 def partition_cores(cores, nth):
     if nth >= len(cores):
@@ -183,7 +228,7 @@ def _run(processUntil, nstr, cores_main, opts, logfilename, monitor, cudaDevices
     with open(logfilename, "w") as logfile:
         taskset = []
         nvprof = []
-        command = [opts.program] + processUntil + ["--numberOfStreams", str(nstr), "--numberOfThreads", str(nth)] + opts.args
+        command = [opts.program] + processUntil + ["--numberOfStreams", str(nstr), "--numberOfThreads", str(nth)] + opts.args + monitor.telemetryArguments(logfilename) + (["--energy"] if opts.monitorEnergy else [])
         if opts.taskset:
             taskset = ["taskset", "-c", ",".join(cores_main)]
 
@@ -218,6 +263,7 @@ def _run(processUntil, nstr, cores_main, opts, logfilename, monitor, cudaDevices
             break
         if p.returncode != 0:
             raise Exception("Got return code %d, see output in the log file %s" % (p.returncode, logfilename))
+    monitor.readTelemetry()
     with open(logfilename) as logfile:
         return throughput(logfile, logfilename)
 
@@ -375,6 +421,7 @@ def main(opts):
                 msg += ", running on devices " + ",".join(opts.cudaDevices)
             printMessage(msg)
             throughputs = []
+            eventsPerJoule = []
             for i in range(opts.repeat):
                 tryAgain = opts.tryAgain
                 while tryAgain > 0:
@@ -402,6 +449,10 @@ def main(opts):
                     throughput=measurement.throughput,
                     cpueff=measurement.cpueff,
                 )
+                if measurement.energy is not None:
+                    d["energy"] = measurement.energy
+                    if "eventsPerJoule" in measurement.energy:
+                        eventsPerJoule.append(measurement.energy["eventsPerJoule"])
                 if monitor.intervalSeconds() is not None:
                     d["monitor"]=monitor.toArrays()
                 if len(opts.cudaDevices) > 0:
@@ -433,7 +484,10 @@ def main(opts):
             thr = statistics.mean(throughputs)
             if len(throughputs) > 1:
                 stdev = statistics.stdev(throughputs)
-        printMessage("Number of streams {} threads {}, average throughput {} stdev {}".format(nstr, nth, thr, stdev))
+        msg = "Number of streams {} threads {}, average throughput {} stdev {}".format(nstr, nth, thr, stdev)
+        if len(eventsPerJoule) > 0:
+            msg += ", average {} events/J".format(statistics.mean(eventsPerJoule))
+        printMessage(msg)
         print()
         if stop:
             print("Reached max wall time of %d s, stopping scan" % opts.stopAfterWallTime)
@@ -461,6 +515,10 @@ def addCommonArguments(parser):
                                help="Enable monitoring of CPU utilization with 'ps'")
     monitor_group.add_argument("--monitorCuda", action="store_true",
                                help="Enable monitoring of CUDA devices (utilization, power, memory etc)")
+    monitor_group.add_argument("--monitorTelemetry", action="store_true",
+                               help="Enable the telemetry reported by the program itself (throughput, in-flight events per stream, event latency percentiles, memory), with --monitorInterval")
+    monitor_group.add_argument("--monitorEnergy", action="store_true",
+                               help="Make the program measure the energy of the CPU packages and DRAM with --energy (serial and alpaka), and store the joules, watts and events/J")
 
     parser.add_argument("--tryAgain", type=int, default=1,
                         help="In case of failure on a point, try again at most this many times (default: 1)")
@@ -17,6 +17,7 @@
 #include <alpaka/alpaka.hpp>
 
 #include "AlpakaCore/alpakaDevices.h"
+#include "Framework/HugePages.h"
 
 // Inspired by cub::CachingDeviceAllocator
 
@@ -350,6 +351,13 @@ namespace cms::alpakatools {
         block.buffer = allocateBuffer(block.bytes, *block.queue);
       }
 
+      if constexpr (std::is_same_v<Device, alpaka::DevCpu> and std::is_same_v<alpaka::Dev<Queue>, alpaka::DevCpu>) {
+        // the cached blocks of the CPU backends hold the large scratch buffers (e.g. the tiles and the followers of
+        // CLUE), ask for them to be backed by transparent huge pages according to the policy; the memory is not
+        // touched yet, so the first faults can already be served by huge pages
+        edm::hugepages::advise(block.buffer->data(), block.bytes);
+      }
+
       // create a new event associated to the "synchronisation device"
       block.event = Event{block.device()};
 
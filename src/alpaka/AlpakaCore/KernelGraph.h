@@ -0,0 +1,105 @@
+#ifndef AlpakaCore_KernelGraph_h
+#define AlpakaCore_KernelGraph_h
+
+#include <algorithm>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include <alpaka/alpaka.hpp>
+
+#include "AlpakaCore/alpakaConfig.h"
+#include "AlpakaCore/alpakaWorkDiv.h"
+
+namespace cms::alpakatools {
+
+  /* Host side description of the fixed sequence of copies and kernels an
+   * algorithm runs for each event, to be owned by the algorithm and hence
+   * used by a single stream.
+   *
+   * The work divisions are computed once: the ones over a fixed number of
+   * elements (the tiles, the seeds) when the graph is set up, and the one
+   * over the points of the event only when its number of blocks changes.
+   *
+   * On the CPU accelerators, where a kernel is a host task run by the
+   * thread that executes the queue, the whole sequence can be fused into
+   * a single task, so that an event costs one enqueue and one hand over
+   * to the queue thread instead of one per step; each kernel still
+   * parallelises over its blocks as it would on its own. The steps run in
+   * the same order either way, so the results do not change. On the GPU
+   * accelerators the steps are always enqueued one by one.
+   *
+   * Kernels over several dimensions are given their accelerator explicitly,
+   * e.g. kernel<Acc2D>(layersWorkDiv<Acc2D>(NLAYERS, points), ...).
+   */
+  template <typename TAcc>
+  class KernelGraph {
+  public:
+    static constexpr bool kHost = std::is_same_v<alpaka::Dev<TAcc>, alpaka::DevCpu>;
+
+    // blockSize is the number of threads per block on the GPUs, and of
+    // elements per thread on the CPUs
+    explicit KernelGraph(Idx blockSize = 1024, bool fuse = true) : blockSize_{blockSize}, fuse_{kHost and fuse} {}
+
+    bool fused() const { return fuse_; }
+
+    // work division with one element per thread (or per element slot) for
+    // a fixed number of elements
+    WorkDiv<Dim1D> workDiv(Idx elements) const {
+      return make_workdiv<TAcc>(divide_up_by(elements, blockSize_), blockSize_);
+    }
+
+    // work division over the points of the event
+    WorkDiv<Dim1D> const& pointsWorkDiv(Idx points) {
+      Idx const blocks = divide_up_by(points, blockSize_);
+      if (not pointsWorkDiv_ or blocks != pointsBlocks_) {
+        pointsWorkDiv_.emplace(make_workdiv<TAcc>(blocks, blockSize_));
+        pointsBlocks_ = blocks;
+      }
+      return *pointsWorkDiv_;
+    }
+
+    // 2D work division over (layer, point in layer), for up to points points
+    // in each layer; on the CPUs each layer is a single block, so that a block
+    // only works on the data of its own layer
+    template <typename TAcc2D>
+    WorkDiv<Dim2D> const& layersWorkDiv(Idx layers, Idx points) {
+      Idx const blocks = kHost ? 1 : std::max<Idx>(divide_up_by(points, blockSize_), 1);
+      if (not layersWorkDiv_ or layers != layers_ or blocks != layerBlocks_) {
+        layersWorkDiv_.emplace(make_workdiv<TAcc2D>(Vec2D{layers, blocks}, Vec2D{Idx{1}, blockSize_}));
+        layers_ = layers;
+        layerBlocks_ = blocks;
+      }
+      return *layersWorkDiv_;
+    }
+
+    template <typename TKernelAcc = TAcc, typename TKernel, typename... TArgs>
+    auto kernel(WorkDiv<alpaka::Dim<TKernelAcc>> const& workDiv, TKernel const& kernel, TArgs&&... args) const {
+      return alpaka::createTaskKernel<TKernelAcc>(workDiv, kernel, std::forward<TArgs>(args)...);
+    }
+
+    // Enqueues the steps on queue, in order, as a single host task when fused
+    template <typename TQueue, typename... TTasks>
+    void enqueue(TQueue& queue, TTasks&&... tasks) const {
+      if constexpr (kHost) {
+        if (fuse_) {
+          alpaka::enqueue(queue, [tasks...]() { (tasks(), ...); });
+          return;
+        }
+      }
+      (alpaka::enqueue(queue, std::forward<TTasks>(tasks)), ...);
+    }
+
+  private:
+    Idx const blockSize_;
+    bool const fuse_;
+    Idx pointsBlocks_ = 0;
+    std::optional<WorkDiv<Dim1D>> pointsWorkDiv_;
+    Idx layers_ = 0;
+    Idx layerBlocks_ = 0;
+    std::optional<WorkDiv<Dim2D>> layersWorkDiv_;
+  };
+
+}  // namespace cms::alpakatools
+
+#endif  // AlpakaCore_KernelGraph_h
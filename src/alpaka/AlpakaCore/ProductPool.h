@@ -0,0 +1,64 @@
+#ifndef AlpakaCore_ProductPool_h
+#define AlpakaCore_ProductPool_h
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include <alpaka/alpaka.hpp>
+
+#include "Framework/ReusableObjectHolder.h"
+
+namespace cms::alpakatools {
+
+  /* Pool of the device buffers of a product, to be owned by a producer
+   * module, and hence used by a single stream.
+   *
+   * Buffers must be constructible as Buffers(queue, capacity) and provide
+   * capacity(). Buffers handed out by get() return to the pool when the
+   * last shared_ptr to them, i.e. the event's Product, is released, and
+   * are reallocated only when an event needs more than their capacity, so
+   * that in the steady state the products are made without going through
+   * the caching allocator and without uploading their view again.
+   */
+  template <typename Queue, typename Buffers>
+  class ProductPool {
+    using Event = alpaka::Event<Queue>;
+
+    struct Entry {
+      explicit Entry(Queue& queue) : released{alpaka::getDev(queue)} {}
+
+      std::optional<Buffers> buffers;
+      // recorded, when the buffers are released, on the queue passed to the get() that handed them out
+      Event released;
+    };
+
+  public:
+    // Returns buffers for at least size elements. The work enqueued on
+    // queue is ordered after the work enqueued on the queue of the previous
+    // get() of the same buffers, which may be another queue; consumers of
+    // the product on other queues are not tracked.
+    std::shared_ptr<Buffers> get(Queue& queue, uint32_t size) {
+      std::shared_ptr<Entry> entry = pool_.makeOrGet([&queue]() { return std::make_unique<Entry>(queue); });
+      alpaka::wait(queue, entry->released);
+      if (not entry->buffers or entry->buffers->capacity() < size) {
+        // leave half of the new size as room, so that growing events do not reallocate every time
+        uint32_t capacity = entry->buffers ? std::max(size, size / 2 * 3) : size;
+        entry->buffers.reset();
+        entry->buffers.emplace(queue, capacity);
+      }
+      Buffers* buffers = &*entry->buffers;
+      return std::shared_ptr<Buffers>(buffers, [entry = std::move(entry), queue](Buffers*) mutable {
+        alpaka::enqueue(queue, entry->released);
+        entry.reset();
+      });
+    }
+
+  private:
+    edm::ReusableObjectHolder<Entry> pool_;
+  };
+
+}  // namespace cms::alpakatools
+
+#endif  // AlpakaCore_ProductPool_h
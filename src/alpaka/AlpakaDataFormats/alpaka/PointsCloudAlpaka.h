@@ -2,9 +2,11 @@
 #define Points_Cloud_Alpaka_h
 
 #include <memory>
+#include <utility>
 
 #include "AlpakaCore/alpakaConfig.h"
 #include "AlpakaCore/alpakaMemory.h"
+#include "AlpakaCore/ProductPool.h"
 #include "DataFormats/PointsCloud.h"
 
 namespace ALPAKA_ACCELERATOR_NAMESPACE {
@@ -12,32 +14,76 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
   class PointsCloudAlpaka {
   public:
     PointsCloudAlpaka() = delete;
+
+    class PointsCloudAlpakaView {
+    public:
+      float *x;
+      float *y;
+      int *layer;
+      float *weight;
+      float *rho;
+      float *delta;
+      int *nearestHigher;
+      int *clusterIndex;
+      int *isSeed;
+    };
+
+    // device buffers for up to capacity points, with their view already on the device
+    class Buffers {
+    public:
+      explicit Buffers(Queue &stream, uint32_t capacity)
+          //input variables
+          : x{cms::alpakatools::make_device_buffer<float[]>(stream, capacity)},
+            y{cms::alpakatools::make_device_buffer<float[]>(stream, capacity)},
+            layer{cms::alpakatools::make_device_buffer<int[]>(stream, capacity)},
+            weight{cms::alpakatools::make_device_buffer<float[]>(stream, capacity)},
+            //result variables
+            rho{cms::alpakatools::make_device_buffer<float[]>(stream, capacity)},
+            delta{cms::alpakatools::make_device_buffer<float[]>(stream, capacity)},
+            nearestHigher{cms::alpakatools::make_device_buffer<int[]>(stream, capacity)},
+            clusterIndex{cms::alpakatools::make_device_buffer<int[]>(stream, capacity)},
+            isSeed{cms::alpakatools::make_device_buffer<int[]>(stream, capacity)},
+            view_d{cms::alpakatools::make_device_buffer<PointsCloudAlpakaView>(stream)},
+            capacity_{capacity} {
+        auto view_h = cms::alpakatools::make_host_buffer<PointsCloudAlpakaView>(stream);
+        view_h->x = x.data();
+        view_h->y = y.data();
+        view_h->layer = layer.data();
+        view_h->weight = weight.data();
+        view_h->rho = rho.data();
+        view_h->delta = delta.data();
+        view_h->nearestHigher = nearestHigher.data();
+        view_h->clusterIndex = clusterIndex.data();
+        view_h->isSeed = isSeed.data();
+
+        alpaka::memcpy(stream, view_d, view_h);
+      }
+
+      uint32_t capacity() const { return capacity_; }
+
+      cms::alpakatools::device_buffer<Device, float[]> x;
+      cms::alpakatools::device_buffer<Device, float[]> y;
+      cms::alpakatools::device_buffer<Device, int[]> layer;
+      cms::alpakatools::device_buffer<Device, float[]> weight;
+      cms::alpakatools::device_buffer<Device, float[]> rho;
+      cms::alpakatools::device_buffer<Device, float[]> delta;
+      cms::alpakatools::device_buffer<Device, int[]> nearestHigher;
+      cms::alpakatools::device_buffer<Device, int[]> clusterIndex;
+      cms::alpakatools::device_buffer<Device, int[]> isSeed;
+      cms::alpakatools::device_buffer<Device, PointsCloudAlpakaView> view_d;
+
+    private:
+      uint32_t capacity_;
+    };
+
+    // per stream pool of Buffers, see AlpakaCore/ProductPool.h
+    using Pool = cms::alpakatools::ProductPool<Queue, Buffers>;
+
     explicit PointsCloudAlpaka(Queue stream, int nPoints)
-        //input variables
-        : x{cms::alpakatools::make_device_buffer<float[]>(stream, nPoints)},
-          y{cms::alpakatools::make_device_buffer<float[]>(stream, nPoints)},
-          layer{cms::alpakatools::make_device_buffer<int[]>(stream, nPoints)},
-          weight{cms::alpakatools::make_device_buffer<float[]>(stream, nPoints)},
-          //result variables
-          rho{cms::alpakatools::make_device_buffer<float[]>(stream, nPoints)},
-          delta{cms::alpakatools::make_device_buffer<float[]>(stream, nPoints)},
-          nearestHigher{cms::alpakatools::make_device_buffer<int[]>(stream, nPoints)},
-          clusterIndex{cms::alpakatools::make_device_buffer<int[]>(stream, nPoints)},
-          isSeed{cms::alpakatools::make_device_buffer<int[]>(stream, nPoints)},
-          view_d{cms::alpakatools::make_device_buffer<PointsCloudAlpakaView>(stream)} {
-      auto view_h = cms::alpakatools::make_host_buffer<PointsCloudAlpakaView>(stream);
-      view_h->x = x.data();
-      view_h->y = y.data();
-      view_h->layer = layer.data();
-      view_h->weight = weight.data();
-      view_h->rho = rho.data();
-      view_h->delta = delta.data();
-      view_h->nearestHigher = nearestHigher.data();
-      view_h->clusterIndex = clusterIndex.data();
-      view_h->isSeed = isSeed.data();
-
-      alpaka::memcpy(stream, view_d, view_h);
-    }
+        : PointsCloudAlpaka(std::make_shared<Buffers>(stream, nPoints)) {}
+    // takes the buffers from pool, reusing them once the Product of a previous event is released
+    explicit PointsCloudAlpaka(Queue stream, int nPoints, Pool &pool)
+        : PointsCloudAlpaka(pool.get(stream, nPoints)) {}
     PointsCloudAlpaka(PointsCloudAlpaka const &) = delete;
     PointsCloudAlpaka(PointsCloudAlpaka &&) = default;
     PointsCloudAlpaka &operator=(PointsCloudAlpaka const &) = delete;
@@ -55,23 +101,25 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     cms::alpakatools::device_buffer<Device, int[]> clusterIndex;
     cms::alpakatools::device_buffer<Device, int[]> isSeed;
 
-    class PointsCloudAlpakaView {
-    public:
-      float *x;
-      float *y;
-      int *layer;
-      float *weight;
-      float *rho;
-      float *delta;
-      int *nearestHigher;
-      int *clusterIndex;
-      int *isSeed;
-    };
-
     PointsCloudAlpakaView *view() { return view_d.data(); }
 
   private:
+    explicit PointsCloudAlpaka(std::shared_ptr<Buffers> buffers)
+        : x{buffers->x},
+          y{buffers->y},
+          layer{buffers->layer},
+          weight{buffers->weight},
+          rho{buffers->rho},
+          delta{buffers->delta},
+          nearestHigher{buffers->nearestHigher},
+          clusterIndex{buffers->clusterIndex},
+          isSeed{buffers->isSeed},
+          view_d{buffers->view_d},
+          buffers_{std::move(buffers)} {}
+
     cms::alpakatools::device_buffer<Device, PointsCloudAlpakaView> view_d;
+    // keeps the buffers out of the pool as long as the product is alive
+    std::shared_ptr<Buffers> buffers_;
   };
 }  // namespace ALPAKA_ACCELERATOR_NAMESPACE
 
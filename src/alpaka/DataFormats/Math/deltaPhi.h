@@ -9,6 +9,9 @@
  */
 
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
 #include "DataFormats/Math/angle_units.h"
 
 namespace reco {
@@ -40,6 +43,40 @@ namespace reco {
   constexpr T deltaPhi(T phi1, T phi2) {
     return reduceRange(phi1 - phi2);
   }
+
+  // Same as reduceRange, but written with selects instead of branches,
+  // so that the loops over arrays of angles vectorise: std::round is
+  // replaced by a truncation through the integer conversion, corrected
+  // by one away from zero for the fractions of at least one half. The
+  // result is bit-identical to reduceRange for |x| below 2^31 turns; for
+  // |x| up to 3 pi, as for the difference of two angles in [-pi, pi], the
+  // product n * 2 pi is exact, so also when the subtraction is fused.
+  template <typename T>
+  constexpr T reduceRangeBranchless(T x) {
+    using Int = std::conditional_t<std::is_same_v<T, float>, std::int32_t, std::int64_t>;
+    constexpr T o2pi = 1. / (2. * M_PI);
+    T turns = x * o2pi;
+    T n = static_cast<T>(static_cast<Int>(turns));
+    n += std::abs(turns - n) >= T(0.5) ? std::copysign(T(1), turns) : T(0);
+    n = std::abs(x) <= T(M_PI) ? T(0) : n;
+    return x - n * T(2. * M_PI);
+  }
+
+  // dphi[i] = deltaPhi(phi1[i], phi2[i]) for i in [0, n)
+  template <typename T>
+  inline void deltaPhi(T const* __restrict__ phi1, T const* __restrict__ phi2, T* __restrict__ dphi, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      dphi[i] = reduceRangeBranchless(phi1[i] - phi2[i]);
+    }
+  }
+
+  // dphi[i] = deltaPhi(phi1, phi2[i]) for i in [0, n)
+  template <typename T>
+  inline void deltaPhi(T phi1, T const* __restrict__ phi2, T* __restrict__ dphi, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      dphi[i] = reduceRangeBranchless(phi1 - phi2[i]);
+    }
+  }
 }  // namespace reco
 
 // lovely!  VI
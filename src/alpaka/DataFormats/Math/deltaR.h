@@ -7,6 +7,7 @@
  */
 #include "DataFormats/Math/deltaPhi.h"
 #include <cmath>
+#include <cstddef>
 
 namespace reco {
 
@@ -47,6 +48,19 @@ namespace reco {
     return std::sqrt(deltaR2(eta1, phi1, eta2, phi2));
   }
 
+  // dr2[i] = deltaR2(eta1, phi1, eta2[i], phi2[i]) for i in [0, n); the
+  // conditional subtraction is written as a select, so that the loop vectorises
+  template <typename T>
+  inline void deltaR2(
+      T eta1, T phi1, T const* __restrict__ eta2, T const* __restrict__ phi2, T* __restrict__ dr2, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      T deta = eta1 - eta2[i];
+      T dphi = std::abs(phi1 - phi2[i]);
+      dphi -= dphi > T(M_PI) ? T(2 * M_PI) : T(0);
+      dr2[i] = deta * deta + dphi * dphi;
+    }
+  }
+
 }  // namespace reco
 
 // woderful!  VI
@@ -0,0 +1,5 @@
+#include "Framework/CurrentModule.h"
+
+namespace edm {
+  thread_local ModuleTag const* currentModule = nullptr;
+}
@@ -26,6 +26,7 @@
 
 // user include files
 #include "Framework/TaskBase.h"
+#include "Framework/TaskPool.h"
 
 // forward declarations
 
@@ -45,6 +46,12 @@ namespace edm {
   FunctorTask<F>* make_functor_task(F f) {
     return new FunctorTask<F>(std::move(f));
   }
+
+  ///Makes the task in the memory of pool, to which it returns once it has run
+  template <typename F>
+  PooledTask<FunctorTask<F>>* make_functor_task(TaskPool& pool, F f) {
+    return make_pooled_task<FunctorTask<F>>(pool, std::move(f));
+  }
 }  // namespace edm
 
 #endif  // Framework_FunctorTask_h
@@ -0,0 +1,134 @@
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+#include <sys/mman.h>
+
+#include "HugePages.h"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+namespace {
+  std::atomic<edm::hugepages::Policy> thePolicy = edm::hugepages::Policy::None;
+  std::atomic<std::size_t> theHugeBytes = 0;
+  std::atomic<std::size_t> theAdvisedBytes = 0;
+  std::atomic<std::size_t> theFallbacks = 0;
+
+  constexpr std::size_t roundUp(std::size_t bytes, std::size_t alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+  }
+
+  // map length bytes starting on a huge page boundary, by over-allocating
+  // one huge page and unmapping what sticks out on either side
+  void* mapAligned(std::size_t length) {
+    constexpr auto page = edm::hugepages::pageSize;
+    void* ptr = mmap(nullptr, length + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    auto begin = reinterpret_cast<std::uintptr_t>(ptr);
+    auto aligned = roundUp(begin, page);
+    if (aligned > begin) {
+      munmap(ptr, aligned - begin);
+    }
+    if (auto tail = begin + page - aligned; tail > 0) {
+      munmap(reinterpret_cast<void*>(aligned + length), tail);
+    }
+    return reinterpret_cast<void*>(aligned);
+  }
+
+  class HugePageResource : public std::pmr::memory_resource {
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+      return edm::hugepages::allocate(bytes, alignment);
+    }
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override {
+      edm::hugepages::deallocate(ptr, bytes, alignment);
+    }
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+  };
+}  // namespace
+
+namespace edm {
+  namespace hugepages {
+    Policy parsePolicy(std::string const& name) {
+      if (name == "none") {
+        return Policy::None;
+      } else if (name == "advise") {
+        return Policy::Advise;
+      } else if (name == "explicit") {
+        return Policy::Explicit;
+      }
+      throw std::invalid_argument("Invalid huge page policy " + name);
+    }
+
+    char const* policyName(Policy policy) {
+      switch (policy) {
+        case Policy::Advise:
+          return "advise";
+        case Policy::Explicit:
+          return "explicit";
+        default:
+          return "none";
+      }
+    }
+
+    void setPolicy(Policy policy) { thePolicy = policy; }
+    Policy policy() { return thePolicy; }
+
+    void* allocate(std::size_t bytes, std::size_t alignment) {
+      auto const pol = thePolicy.load(std::memory_order_relaxed);
+      if (pol == Policy::None or bytes < pageSize or alignment > pageSize) {
+        return ::operator new(bytes, std::align_val_t(alignment));
+      }
+      auto const length = roundUp(bytes, pageSize);
+      if (pol == Policy::Explicit) {
+        void* ptr = mmap(
+            nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+        if (ptr != MAP_FAILED) {
+          theHugeBytes += length;
+          return ptr;
+        }
+        ++theFallbacks;
+      }
+      void* ptr = mapAligned(length);
+      madvise(ptr, length, MADV_HUGEPAGE);
+      theAdvisedBytes += length;
+      return ptr;
+    }
+
+    void deallocate(void* ptr, std::size_t bytes, std::size_t alignment) noexcept {
+      auto const pol = thePolicy.load(std::memory_order_relaxed);
+      if (pol == Policy::None or bytes < pageSize or alignment > pageSize) {
+        ::operator delete(ptr, std::align_val_t(alignment));
+        return;
+      }
+      // both kinds of mappings span a whole number of huge pages, so the
+      // length to unmap does not depend on which one was obtained
+      auto const length = roundUp(bytes, pageSize);
+      munmap(ptr, length);
+    }
+
+    void advise(void* ptr, std::size_t bytes) noexcept {
+      if (thePolicy.load(std::memory_order_relaxed) == Policy::None) {
+        return;
+      }
+      auto begin = roundUp(reinterpret_cast<std::uintptr_t>(ptr), pageSize);
+      auto end = (reinterpret_cast<std::uintptr_t>(ptr) + bytes) / pageSize * pageSize;
+      if (end > begin) {
+        madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+      }
+    }
+
+    Statistics statistics() { return Statistics{theHugeBytes.load(), theAdvisedBytes.load(), theFallbacks.load()}; }
+
+    std::pmr::memory_resource* resource() {
+      static HugePageResource resource;
+      return &resource;
+    }
+  }  // namespace hugepages
+}  // namespace edm
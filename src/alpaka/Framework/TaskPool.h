@@ -0,0 +1,82 @@
+#ifndef Framework_TaskPool_h
+#define Framework_TaskPool_h
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace edm {
+  // Fixed number of blocks of memory for the task objects made for each
+  // event, owned by a stream, so that dispatching an event does not go
+  // through the heap. The blocks are handed out and given back through a
+  // lock-free free list, as the tasks of a stream are made and recycled
+  // on any thread. Tasks larger than a block, or made while all the
+  // blocks are in use, are allocated from the heap instead.
+  class TaskPool {
+  public:
+    static constexpr std::size_t kBlockSize = 256;
+
+    explicit TaskPool(unsigned int blocks);
+    ~TaskPool();
+
+    TaskPool(TaskPool const&) = delete;
+    TaskPool& operator=(TaskPool const&) = delete;
+
+    // thread safe
+    void* allocate(std::size_t bytes);
+    void deallocate(void* ptr) noexcept;
+
+    unsigned int size() const { return size_; }
+
+  private:
+    struct alignas(64) Block {
+      std::byte data[kBlockSize];
+    };
+
+    static constexpr std::uint32_t kEnd = ~std::uint32_t(0);
+
+    bool owns(void const* ptr) const;
+
+    std::unique_ptr<Block[]> blocks_;
+    std::unique_ptr<std::atomic<std::uint32_t>[]> next_;
+    unsigned int const size_;
+    // index of the first free block in the low half, and in the high half
+    // a count of the updates, which prevents the ABA problem of the list
+    std::atomic<std::uint64_t> head_;
+  };
+
+  // T constructed in the memory of a TaskPool, to which it returns when
+  // the TaskSentry that ran it recycles it
+  template <typename T>
+  class PooledTask final : public T {
+  public:
+    template <typename... Args>
+    explicit PooledTask(TaskPool& pool, Args&&... args) : T(std::forward<Args>(args)...), pool_(pool) {}
+
+  private:
+    void recycle() final {
+      TaskPool& pool = pool_;
+      this->~PooledTask();
+      pool.deallocate(this);
+    }
+
+    TaskPool& pool_;
+  };
+
+  template <typename T, typename... Args>
+  PooledTask<T>* make_pooled_task(TaskPool& pool, Args&&... args) {
+    static_assert(alignof(PooledTask<T>) <= alignof(std::max_align_t), "over-aligned tasks can not be pooled");
+    void* ptr = pool.allocate(sizeof(PooledTask<T>));
+    try {
+      return new (ptr) PooledTask<T>(pool, std::forward<Args>(args)...);
+    } catch (...) {
+      pool.deallocate(ptr);
+      throw;
+    }
+  }
+}  // namespace edm
+
+#endif  // Framework_TaskPool_h
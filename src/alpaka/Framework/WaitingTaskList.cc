@@ -54,18 +54,23 @@ void WaitingTaskList::reset() {
   unsigned int nSeenTasks = m_lastAssignedCacheIndex;
   m_lastAssignedCacheIndex = 0;
   assert(m_head == nullptr);
-  if (nSeenTasks > m_nodeCacheSize) {
-    //need to expand so next time we don't have to do any
-    // memory requests
-    m_nodeCacheSize = nSeenTasks;
-    m_nodeCache.reset(new WaitNode[nSeenTasks]);
+  //need to expand so next time we don't have to do any
+  // memory requests
+  reserve(nSeenTasks);
+  //this will make sure all cores see the changes
+  m_waiting = true;
+}
+
+void WaitingTaskList::reserve(unsigned int iSize) {
+  assert(m_head == nullptr);
+  if (iSize > m_nodeCacheSize) {
+    m_nodeCacheSize = iSize;
+    m_nodeCache.reset(new WaitNode[iSize]);
     auto nodeCache = m_nodeCache.get();
     for (auto it = nodeCache, itEnd = nodeCache + m_nodeCacheSize; it != itEnd; ++it) {
       it->m_fromCache = true;
     }
   }
-  //this will make sure all cores see the changes
-  m_waiting = true;
 }
 
 WaitingTaskList::WaitNode* WaitingTaskList::createNode(tbb::task_group* iGroup, WaitingTask* iTask) {
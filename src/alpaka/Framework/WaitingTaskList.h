@@ -133,6 +133,12 @@ namespace edm {
        */
     void reset();
 
+    ///Makes room for iSize tasks in the cache, so that adding them does not allocate
+    /**Like reset(), reserve() is NOT thread safe and can not be called while tasks are
+       * being added.
+       */
+    void reserve(unsigned int iSize);
+
   private:
     /**Handles spawning the tasks,
        * safe to call from multiple threads
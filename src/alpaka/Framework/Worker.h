@@ -4,9 +4,12 @@
 #include <atomic>
 #include <exception>
 //#include <iostream>
+#include <string>
 #include <utility>
 #include <vector>
 
+#include "Framework/CurrentModule.h"
+#include "Framework/TaskPool.h"
 #include "Framework/WaitingTask.h"
 #include "Framework/WaitingTaskHolder.h"
 #include "Framework/WaitingTaskList.h"
@@ -22,6 +25,15 @@ namespace edm {
     Worker() : prefetchRequested_{false} {}
     virtual ~Worker() = default;
 
+    // not thread safe
+    void setTag(std::string module, int stream) {
+      module_ = std::move(module);
+      tag_ = {module_.c_str(), stream};
+    }
+
+    // not thread safe; the tasks of each event are made in the memory of pool
+    void setTaskPool(TaskPool* pool) { taskPool_ = pool; }
+
     // not thread safe
     void setItemsToGet(std::vector<Worker*> workers) { itemsToGet_ = std::move(workers); }
 
@@ -34,6 +46,9 @@ namespace edm {
     // not thread safe
     virtual void doEndJob() = 0;
 
+    // not thread safe; callers is the number of doWorkAsync() calls per event
+    virtual void reserveWaitingTasks(unsigned int callers) = 0;
+
     // not thread safe
     void reset() {
       prefetchRequested_ = false;
@@ -43,7 +58,15 @@ namespace edm {
   protected:
     virtual void doReset() = 0;
 
+    // identifies the running module to the sampling profiler
+    ModuleTag const* tag() const { return &tag_; }
+
+    TaskPool& taskPool() const { return *taskPool_; }
+
   private:
+    std::string module_;
+    ModuleTag tag_ = {"", -1};
+    TaskPool* taskPool_ = nullptr;
     std::vector<Worker*> itemsToGet_;
     std::atomic<bool> prefetchRequested_;
   };
@@ -61,13 +84,14 @@ namespace edm {
         //std::cout << "first doWorkAsync call" << std::endl;
 
         WaitingTask* moduleTask =
-            make_waiting_task([this, &event, &eventSetup](std::exception_ptr const* iPtr) mutable {
+            make_waiting_task(taskPool(), [this, &event, &eventSetup](std::exception_ptr const* iPtr) mutable {
               if (iPtr) {
                 waitingTasksWork_.doneWaiting(*iPtr);
               } else {
                 std::exception_ptr exceptionPtr;
                 try {
                   //std::cout << "calling doProduce " << this << std::endl;
+                  CurrentModuleSentry sentry(tag());
                   producer_.doProduce(event, eventSetup);
                 } catch (...) {
                   exceptionPtr = std::current_exception();
@@ -79,20 +103,23 @@ namespace edm {
         auto* group = task.group();
         if (producer_.hasAcquire()) {
           WaitingTaskWithArenaHolder runProduceHolder{*group, moduleTask};
-          moduleTask = make_waiting_task([this, &event, &eventSetup, runProduceHolder = std::move(runProduceHolder)](
-                                             std::exception_ptr const* iPtr) mutable {
-            if (iPtr) {
-              runProduceHolder.doneWaiting(*iPtr);
-            } else {
-              std::exception_ptr exceptionPtr;
-              try {
-                producer_.doAcquire(event, eventSetup, runProduceHolder);
-              } catch (...) {
-                exceptionPtr = std::current_exception();
-              }
-              runProduceHolder.doneWaiting(exceptionPtr);
-            }
-          });
+          moduleTask = make_waiting_task(
+              taskPool(),
+              [this, &event, &eventSetup, runProduceHolder = std::move(runProduceHolder)](
+                  std::exception_ptr const* iPtr) mutable {
+                if (iPtr) {
+                  runProduceHolder.doneWaiting(*iPtr);
+                } else {
+                  std::exception_ptr exceptionPtr;
+                  try {
+                    CurrentModuleSentry sentry(tag());
+                    producer_.doAcquire(event, eventSetup, runProduceHolder);
+                  } catch (...) {
+                    exceptionPtr = std::current_exception();
+                  }
+                  runProduceHolder.doneWaiting(exceptionPtr);
+                }
+              });
         }
         //std::cout << "calling prefetchAsync " << this << " with moduleTask " << moduleTask << std::endl;
         prefetchAsync(event, eventSetup, WaitingTaskHolder(*group, moduleTask));
@@ -101,6 +128,8 @@ namespace edm {
 
     void doEndJob() override { producer_.doEndJob(); }
 
+    void reserveWaitingTasks(unsigned int callers) override { waitingTasksWork_.reserve(callers); }
+
   private:
     void doReset() override {
       waitingTasksWork_.reset();
@@ -0,0 +1,66 @@
+#ifndef EventCodec_h
+#define EventCodec_h
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Compressed form of the input files, which hold for each event the
+// number of points followed by the points as rows of float columns (4 for
+// CLUE 2D, 10 for CLUE3D). The compressed file starts with a header
+//   "CLZ1" nColumns
+// followed by one block per event
+//   nPoints nBytes payload
+// where the payload holds the columns one after the other, so that each
+// block can be decoded on its own. Each column is stored as
+//   mode [quantum] data
+// with the smallest of the modes below for that column of that event.
+namespace eventcodec {
+  enum class Mode : std::uint8_t {
+    Raw,        // the 4 bytes of each value
+    Xor,        // varint of the bits of each value xor those of the previous one
+    Delta,      // integral values: varint of the zig-zag difference to the previous one
+    RunLength,  // integral values: as Delta, each followed by the varint of the number of repetitions
+    // the same two for values rounded to a multiple of a quantum, lossy
+    QuantisedDelta,
+    QuantisedRunLength,
+  };
+
+  // the columns of one event, in the order of the input file
+  using Columns = std::vector<std::vector<float>>;
+
+  struct Statistics {
+    std::size_t events = 0;
+    std::size_t points = 0;
+    std::size_t rawBytes = 0;
+    std::size_t compressedBytes = 0;
+    // number of columns stored with each Mode
+    std::vector<std::size_t> modes = std::vector<std::size_t>(6, 0);
+  };
+
+  // true if the file starts with the header of a compressed file
+  bool isCompressed(std::filesystem::path const& file);
+
+  // a quantum larger than 0 allows the lossy modes for the non-integral values
+  std::string encode(Columns const& event, float quantum = 0.f, Statistics* statistics = nullptr);
+  // throws std::runtime_error for a corrupt block
+  Columns decode(char const* data, std::size_t size, unsigned int nColumns, std::size_t nPoints);
+
+  // reads a raw input file, calling f with the columns of each event
+  void readRaw(std::filesystem::path const& file, unsigned int nColumns, std::function<void(Columns&&)> const& f);
+
+  // reads a compressed file, decoding the blocks in parallel in a TBB
+  // pipeline and calling f with each event in the order of the file;
+  // throws std::runtime_error if it does not hold nColumns columns
+  void read(std::filesystem::path const& file, unsigned int nColumns, std::function<void(Columns&&)> const& f);
+
+  // compresses the raw file input into output
+  Statistics convert(std::filesystem::path const& input,
+                     std::filesystem::path const& output,
+                     unsigned int nColumns,
+                     float quantum = 0.f);
+}  // namespace eventcodec
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef EventDispatcher_h
+#define EventDispatcher_h
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace edm {
+  // Order in which the Source hands out the events of a run
+  enum class DispatchOrder {
+    // the order of the input file
+    File,
+    // the events with the most points first
+    LargestFirst,
+    // the events with the most points alternated with the ones with the fewest
+    Interleaved,
+    // the events that took the longest on their previous passes first, the
+    // others from their points and the time per point measured so far
+    Learned
+  };
+
+  // Chooses which event number the Source produces next. The run always
+  // processes the same events, each with the same event number and hence
+  // the same content, only their order changes: with an order other than
+  // the file one the streams start with the longest events and end with
+  // the shortest ones, so that fewer of them wait idle at the end of the
+  // run for a few long events to finish.
+  //
+  // When the run is limited to a number of events which is not a multiple
+  // of the number of input events, the events of the final incomplete pass
+  // over the input are handed out first. The learned order takes the time
+  // of an event as the time between its stream asking for it and asking
+  // for the next one, and sorts each pass over the input as it begins.
+  //
+  // It also records when each stream runs out of events, to report how
+  // long the streams waited idle at the end of the run.
+  class EventDispatcher {
+  public:
+    explicit EventDispatcher(DispatchOrder order = DispatchOrder::File);
+
+    EventDispatcher(EventDispatcher const&) = delete;
+    EventDispatcher& operator=(EventDispatcher const&) = delete;
+
+    // returns false for an unknown name
+    static bool parse(std::string const& name, DispatchOrder& order);
+    static char const* name(DispatchOrder order);
+
+    // sizes are the number of points of each input event, maxEvents the
+    // number of events of the run, or negative for a run limited by time
+    void setup(std::vector<std::size_t> sizes, int maxEvents);
+    void start();
+
+    // thread safe; the event number, from 1, of the position-th event of the run
+    int eventNumber(int streamId, int position);
+    // thread safe; streamId got no event
+    void outOfEvents(int streamId);
+
+    DispatchOrder order() const { return order_; }
+    // number of input events
+    int events() const { return events_; }
+    // time from the first stream running out of events to the last one,
+    // and the time the streams spent idle meanwhile, summed over them
+    double tailSeconds() const;
+    double tailIdleSeconds() const;
+    void report(std::ostream& out) const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pass {
+      std::vector<int> order;
+      int left;
+    };
+
+    // order of the input events index < n, from their size
+    std::vector<int> sortBySize(int n) const;
+    // learned order of the input events, from their measured or predicted time
+    std::vector<int> sortByTime() const;
+    std::vector<int> arrange(std::vector<int> sorted) const;
+    // records the time of the event streamId was processing, under mutex_
+    void measure(int streamId, Clock::time_point now);
+
+    DispatchOrder const order_;
+    std::vector<std::size_t> sizes_;
+    int events_ = 0;
+    // the events of the final incomplete pass, handed out first, and of each full pass
+    int firstPass_ = 0;
+    std::vector<int> first_;
+    std::vector<int> full_;
+
+    mutable std::mutex mutex_;
+    // learned order: time of each input event (negative until measured), the
+    // totals to predict the time of the others from their points, the event
+    // each stream is processing and when it got it, and the order of the
+    // passes being handed out
+    std::vector<double> seconds_;
+    double measuredSeconds_ = 0.;
+    double measuredPoints_ = 0.;
+    std::vector<std::pair<int, Clock::time_point>> inFlight_;
+    std::map<int, Pass> passes_;
+    // start of the run, and when each stream ran out of events
+    Clock::time_point start_;
+    std::vector<Clock::time_point> idle_;
+  };
+}  // namespace edm
+
+#endif
@@ -19,11 +19,16 @@ namespace edm {
                                  std::vector<std::string> const& esproducers,
                                  std::filesystem::path const& inputFile,
                                  std::filesystem::path const& configFile,
-                                 bool validation) {
+                                 bool validation,
+                                 PileupOverlay const& pileup,
+                                 ColdReplay const& coldReplay,
+                                 DispatchOrder dispatchOrder) {
     if (dims == 2)
-      source_ = new Source2D(maxEvents, runForMinutes, registry_, inputFile, validation);
+      source_ = new Source2D(
+          maxEvents, runForMinutes, registry_, inputFile, validation, pileup, coldReplay, dispatchOrder);
     else if (dims == 3)
-      source_ = new Source3D(maxEvents, runForMinutes, registry_, inputFile, validation);
+      source_ = new Source3D(
+          maxEvents, runForMinutes, registry_, inputFile, validation, pileup, coldReplay, dispatchOrder);
     for (auto const& name : esproducers) {
       pluginManager_.load(name);
       if (name == "CLUEAlpakaClusterizerESProducer") {
@@ -35,10 +35,16 @@ namespace edm {
                             std::vector<std::string> const& esproducers,
                             std::filesystem::path const& inputFile,
                             std::filesystem::path const& configFile,
-                            bool validation);
+                            bool validation,
+                            PileupOverlay const& pileup = PileupOverlay(),
+                            ColdReplay const& coldReplay = ColdReplay(),
+                            DispatchOrder dispatchOrder = DispatchOrder::File);
 
     int maxEvents() const { return source_->maxEvents(); }
     int processedEvents() const { return source_->processedEvents(); }
+    int inputEvents() const { return source_->inputEvents(); }
+    double flushSeconds() const { return source_->flushSeconds(); }
+    EventDispatcher const& dispatcher() const { return source_->dispatcher(); }
     std::vector<std::pair<Backend, int>> const& backends() const { return streamsPerBackend_; }
 
     void runToCompletion();
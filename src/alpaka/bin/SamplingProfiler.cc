@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <backtrace.h>
+#include <cxxabi.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include "Framework/CurrentModule.h"
+#include "SamplingProfiler.h"
+
+namespace {
+  // the running profiler, read by the signal handler
+  std::atomic<edm::SamplingProfiler*> active = nullptr;
+  struct sigaction previousAction;
+
+  std::string demangle(char const* name) {
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (status != 0) {
+      return name;
+    }
+    std::string result(demangled);
+    std::free(demangled);
+    return result;
+  }
+
+  // functions of a program counter, the innermost inlined one first
+  struct Symbols {
+    std::vector<std::string> functions;
+    bool failed = false;
+  };
+
+  int addFunction(void* data, std::uintptr_t, char const*, int, char const* function) {
+    auto& symbols = *static_cast<Symbols*>(data);
+    if (function) {
+      symbols.functions.push_back(demangle(function));
+    }
+    return 0;
+  }
+
+  void addSymbol(void* data, std::uintptr_t, char const* symbol, std::uintptr_t, std::uintptr_t) {
+    auto& symbols = *static_cast<Symbols*>(data);
+    symbols.functions.push_back(symbol ? demangle(symbol) : "[unknown]");
+  }
+
+  void symbolError(void* data, char const*, int) { static_cast<Symbols*>(data)->failed = true; }
+}  // namespace
+
+namespace edm {
+  SamplingProfiler::SamplingProfiler(int frequency, std::size_t maxSamples)
+      : frequency_{frequency}, maxSamples_{maxSamples} {
+    if (frequency_ <= 0 or frequency_ > 1000000) {
+      throw std::invalid_argument("The sampling frequency must be between 1 and 1000000 Hz");
+    }
+  }
+
+  SamplingProfiler::~SamplingProfiler() { stop(); }
+
+  void SamplingProfiler::start() {
+    if (running_) {
+      return;
+    }
+    if (not state_) {
+      // threaded, as the handler may run on several threads at the same time
+      state_ = backtrace_create_state(nullptr, 1, error, nullptr);
+      if (not state_) {
+        throw std::runtime_error("Failed to initialise libbacktrace for the sampling profiler");
+      }
+    }
+    if (not samples_) {
+      // left uninitialised, so that only the pages actually used are touched
+      samples_.reset(new Sample[maxSamples_]);
+    }
+    SamplingProfiler* expected = nullptr;
+    if (not active.compare_exchange_strong(expected, this)) {
+      throw std::runtime_error("Another sampling profiler is already running");
+    }
+    next_ = 0;
+    dropped_ = 0;
+    symbolised_ = false;
+
+    // a first unwinding outside of the handler sets up the unwinder, which
+    // would otherwise take the dynamic loader lock from within the handler
+    Sample warmup;
+    warmup.depth = 0;
+    backtrace_simple(state_, 0, collect, error, &warmup);
+
+    struct sigaction action = {};
+    action.sa_handler = handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &previousAction) != 0) {
+      active = nullptr;
+      throw std::runtime_error("Failed to install the SIGPROF handler of the sampling profiler");
+    }
+    long const period = std::max(1000000L / frequency_, 1L);
+    itimerval timer = {{period / 1000000, period % 1000000}, {period / 1000000, period % 1000000}};
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+      sigaction(SIGPROF, &previousAction, nullptr);
+      active = nullptr;
+      throw std::runtime_error("Failed to start the profiling timer");
+    }
+    running_ = true;
+  }
+
+  void SamplingProfiler::stop() {
+    if (not running_) {
+      return;
+    }
+    itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    // ignoring the signal discards the ones still pending, which the
+    // default action would turn into the termination of the process
+    struct sigaction ignore = {};
+    ignore.sa_handler = SIG_IGN;
+    sigemptyset(&ignore.sa_mask);
+    sigaction(SIGPROF, &ignore, nullptr);
+    sigaction(SIGPROF, &previousAction, nullptr);
+    active = nullptr;
+    running_ = false;
+  }
+
+  std::size_t SamplingProfiler::samples() const { return std::min<std::size_t>(next_, maxSamples_); }
+
+  void SamplingProfiler::handler(int) {
+    SamplingProfiler* self = active.load(std::memory_order_acquire);
+    if (not self) {
+      return;
+    }
+    int const savedErrno = errno;
+    std::size_t const index = self->next_.fetch_add(1, std::memory_order_relaxed);
+    if (index < self->maxSamples_) {
+      Sample& sample = self->samples_[index];
+      sample.complete.store(false, std::memory_order_relaxed);
+      ModuleTag const* tag = currentModule;
+      sample.module = tag ? tag->module : nullptr;
+      sample.stream = tag ? tag->stream : -1;
+      sample.depth = 0;
+      backtrace_simple(self->state_, 0, collect, error, &sample);
+      sample.complete.store(true, std::memory_order_release);
+    } else {
+      self->dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    errno = savedErrno;
+  }
+
+  int SamplingProfiler::collect(void* data, std::uintptr_t pc) {
+    auto& sample = *static_cast<Sample*>(data);
+    if (pc == 0 or pc == static_cast<std::uintptr_t>(-1)) {
+      return 1;
+    }
+    sample.pcs[sample.depth++] = pc;
+    return sample.depth == kMaxDepth ? 1 : 0;
+  }
+
+  void SamplingProfiler::error(void*, char const*, int) {}
+
+  void SamplingProfiler::symbolise() const {
+    if (symbolised_) {
+      return;
+    }
+    folded_.clear();
+    modules_.clear();
+    streams_.clear();
+    std::unordered_map<std::uintptr_t, std::vector<std::string>> cache;
+    auto functions = [this, &cache](std::uintptr_t pc) -> std::vector<std::string> const& {
+      auto found = cache.find(pc);
+      if (found != cache.end()) {
+        return found->second;
+      }
+      Symbols symbols;
+      backtrace_pcinfo(state_, pc, addFunction, symbolError, &symbols);
+      if (symbols.functions.empty() or symbols.failed) {
+        // no debug information, fall back to the symbol table
+        symbols.functions.clear();
+        backtrace_syminfo(state_, pc, addSymbol, symbolError, &symbols);
+        if (symbols.functions.empty()) {
+          symbols.functions.emplace_back("[unknown]");
+        }
+      }
+      return cache.emplace(pc, std::move(symbols.functions)).first->second;
+    };
+
+    std::string const handlerPrefix = "edm::SamplingProfiler::handler";
+    std::string stack;
+    for (std::size_t i = 0, n = samples(); i < n; ++i) {
+      Sample const& sample = samples_[i];
+      if (not sample.complete.load(std::memory_order_acquire)) {
+        continue;
+      }
+      // the innermost frames are the handler and the signal trampoline
+      unsigned int first = 0;
+      while (first < sample.depth and functions(sample.pcs[first]).front().rfind(handlerPrefix, 0) == 0) {
+        ++first;
+      }
+      if (first > 0) {
+        ++first;
+      }
+      std::string const module = sample.module ? sample.module : "(framework)";
+      stack = module;
+      for (unsigned int frame = sample.depth; frame-- > first;) {
+        auto const& inlined = functions(sample.pcs[frame]);
+        for (auto function = inlined.rbegin(); function != inlined.rend(); ++function) {
+          stack += ';';
+          stack += *function;
+        }
+      }
+      ++folded_[stack];
+      ++modules_[module];
+      ++streams_[sample.stream];
+    }
+    symbolised_ = true;
+  }
+
+  void SamplingProfiler::writeFolded(std::string const& file) const {
+    symbolise();
+    std::ofstream out(file);
+    for (auto const& [stack, count] : folded_) {
+      out << stack << ' ' << count << '\n';
+    }
+    if (not out) {
+      throw std::runtime_error("Failed to write the profile to " + file);
+    }
+  }
+
+  void SamplingProfiler::report(std::ostream& out) const {
+    symbolise();
+    std::size_t total = 0;
+    for (auto const& [module, count] : modules_) {
+      total += count;
+    }
+    out << "Profile: " << total << " samples at " << frequency_ << " Hz";
+    if (dropped_ > 0) {
+      out << ", " << dropped_ << " dropped when the buffer was full";
+    }
+    out << std::endl;
+    if (total == 0) {
+      return;
+    }
+    std::vector<std::pair<std::string, std::size_t>> modules(modules_.begin(), modules_.end());
+    std::stable_sort(
+        modules.begin(), modules.end(), [](auto const& a, auto const& b) { return a.second > b.second; });
+    out << std::fixed << std::setprecision(1);
+    for (auto const& [module, count] : modules) {
+      out << "  " << std::setw(6) << 100. * count / total << "%  " << module << std::endl;
+    }
+    out << "  streams:";
+    for (auto const& [stream, count] : streams_) {
+      out << ' ' << (stream < 0 ? std::string("none") : std::to_string(stream)) << ' ' << 100. * count / total
+          << '%';
+    }
+    out << std::endl;
+  }
+}  // namespace edm
@@ -1,8 +1,13 @@
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 
+#include <unistd.h>
+
+#include "EventCodec.h"
 #include "Source.h"
 
 struct Point {
@@ -25,6 +30,9 @@ struct PointClus {
   float isSilicon;
 };
 
+static_assert(sizeof(Point) == edm::Source2D::kColumns * sizeof(float));
+static_assert(sizeof(PointClus) == edm::Source3D::kColumns * sizeof(float));
+
 namespace {
 
   PointsCloud readRaw2D(std::ifstream &inputFile, uint32_t n_points) {
@@ -59,6 +67,30 @@ namespace {
     return data;
   }
 
+  PointsCloud toPointsCloud(eventcodec::Columns &&columns) {
+    PointsCloud data;
+    data.x = std::move(columns[0]);
+    data.y = std::move(columns[1]);
+    data.layer.assign(columns[2].begin(), columns[2].end());
+    data.weight = std::move(columns[3]);
+    return data;
+  }
+
+  ClusterCollection toClusterCollection(eventcodec::Columns &&columns) {
+    ClusterCollection data;
+    data.x = std::move(columns[0]);
+    data.y = std::move(columns[1]);
+    data.z = std::move(columns[2]);
+    data.eta = std::move(columns[3]);
+    data.phi = std::move(columns[4]);
+    data.r_over_absz = std::move(columns[5]);
+    data.radius = std::move(columns[6]);
+    data.layer.assign(columns[7].begin(), columns[7].end());
+    data.energy = std::move(columns[8]);
+    data.isSilicon.assign(columns[9].begin(), columns[9].end());
+    return data;
+  }
+
   PointsCloud readToyDetectors(std::filesystem::path const &toyDetector) {
     PointsCloud data;
     for (int l = 0; l < NLAYERS; l++) {
@@ -81,19 +113,118 @@ namespace {
 }  // namespace
 
 namespace edm {
-  Source::Source(
-      int maxEvents, int runForMinutes, ProductRegistry &reg, std::filesystem::path const &inputFile, bool validation)
-      : maxEvents_(maxEvents), runForMinutes_(runForMinutes), validation_(validation) {}
+  Source::Source(int maxEvents,
+                 int runForMinutes,
+                 ProductRegistry &reg,
+                 std::filesystem::path const &inputFile,
+                 bool validation,
+                 PileupOverlay const &pileup,
+                 ColdReplay const &coldReplay,
+                 DispatchOrder dispatchOrder)
+      : maxEvents_(maxEvents),
+        runForMinutes_(runForMinutes),
+        validation_(validation),
+        pileup_(pileup),
+        coldReplay_(coldReplay),
+        dispatcher_(dispatchOrder) {
+    if (coldReplay_.flush) {
+      // larger than the cache, as its replacement policy is not exactly LRU
+      flushBuffer_.assign(ColdReplay::lastLevelCacheBytes() / 2 * 3, 1);
+    }
+  }
+
+  std::size_t ColdReplay::lastLevelCacheBytes() {
+    for (int name : {_SC_LEVEL4_CACHE_SIZE, _SC_LEVEL3_CACHE_SIZE, _SC_LEVEL2_CACHE_SIZE}) {
+      long const size = sysconf(name);
+      if (size > 0) {
+        return size;
+      }
+    }
+    // unknown, assume a large one
+    return std::size_t(64) << 20;
+  }
+
+  void Source2D::InputStore::append(PointsCloud const &event) {
+    x.insert(x.end(), event.x.begin(), event.x.end());
+    y.insert(y.end(), event.y.begin(), event.y.end());
+    layer.insert(layer.end(), event.layer.begin(), event.layer.end());
+    weight.insert(weight.end(), event.weight.begin(), event.weight.end());
+    offsets.push_back(x.size());
+  }
+
+  PointsCloud Source2D::InputStore::event(std::size_t index) const {
+    auto const begin = offsets[index], end = offsets[index + 1];
+    PointsCloud data;
+    data.x.assign(x.begin() + begin, x.begin() + end);
+    data.y.assign(y.begin() + begin, y.begin() + end);
+    data.layer.assign(layer.begin() + begin, layer.begin() + end);
+    data.weight.assign(weight.begin() + begin, weight.begin() + end);
+    return data;
+  }
+
+  std::mt19937 Source::pileupEngine(int iev) const {
+    std::seed_seq seq{pileup_.seed, static_cast<unsigned int>(iev)};
+    return std::mt19937(seq);
+  }
 
-  Source2D::Source2D(
-      int maxEvents, int runForMinutes, ProductRegistry &reg, std::filesystem::path const &inputFile, bool validation)
-      : Source(maxEvents, runForMinutes, reg, inputFile, validation), cloudToken_(reg.produces<PointsCloud>()) {
+  std::mt19937 Source::replicaEngine(int replica) const {
+    std::seed_seq seq{coldReplay_.seed, static_cast<unsigned int>(replica)};
+    return std::mt19937(seq);
+  }
+
+  int Source::replicas(std::size_t inputBytes) const {
+    if (not coldReplay_.enabled() or inputBytes == 0 or inputBytes >= coldReplay_.poolBytes) {
+      return 0;
+    }
+    return (coldReplay_.poolBytes + inputBytes - 1) / inputBytes - 1;
+  }
+
+  void Source::flushCaches() {
+    if (flushBuffer_.empty()) {
+      return;
+    }
+    auto const start = std::chrono::steady_clock::now();
+    // one load per cache line, summed so that the loads are not optimised away
+    unsigned int sum = 0;
+    for (std::size_t i = 0; i < flushBuffer_.size(); i += 64) {
+      sum += flushBuffer_[i];
+    }
+    flushSink_ += sum;
+    flushNanoseconds_ +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  int Source::pileupSize(std::mt19937 &engine) const {
+    switch (pileup_.distribution) {
+      case PileupOverlay::Distribution::Poisson:
+        return std::max(1, std::poisson_distribution<int>(pileup_.k)(engine));
+      case PileupOverlay::Distribution::Uniform:
+        return std::uniform_int_distribution<int>(1, 2 * pileup_.k - 1)(engine);
+      default:
+        return pileup_.k;
+    }
+  }
+
+  Source2D::Source2D(int maxEvents,
+                     int runForMinutes,
+                     ProductRegistry &reg,
+                     std::filesystem::path const &inputFile,
+                     bool validation,
+                     PileupOverlay const &pileup,
+                     ColdReplay const &coldReplay,
+                     DispatchOrder dispatchOrder)
+      : Source(maxEvents, runForMinutes, reg, inputFile, validation, pileup, coldReplay, dispatchOrder),
+        cloudToken_(reg.produces<PointsCloud>()) {
     std::string input(inputFile);
     if (input.find("toyDetector") != std::string::npos) {
-      cloud_.emplace_back(readToyDetectors(inputFile));
+      cloud_.append(readToyDetectors(inputFile));
       if (runForMinutes_ < 0 and maxEvents_ < 0) {
         maxEvents_ = 10;
       }
+    } else if (eventcodec::isCompressed(inputFile)) {
+      eventcodec::read(inputFile, kColumns, [this](eventcodec::Columns &&columns) {
+        cloud_.append(toPointsCloud(std::move(columns)));
+      });
     } else {
       std::ifstream in_raw(inputFile, std::ios::binary);
       uint32_t n_points;
@@ -102,64 +233,247 @@ namespace edm {
 
       while (not in_raw.eof()) {
         in_raw.exceptions(std::ifstream::badbit | std::ifstream::failbit | std::ifstream::eofbit);
-        cloud_.emplace_back(readRaw2D(in_raw, n_points));
+        cloud_.append(readRaw2D(in_raw, n_points));
 
         // next event
         in_raw.exceptions(std::ifstream::badbit);
         in_raw.read(reinterpret_cast<char *>(&n_points), sizeof(uint32_t));
       }
-      if (runForMinutes_ < 0 and maxEvents_ < 0) {
-        maxEvents_ = cloud_.size();
-      }
     }
+    replicate();
+    if (runForMinutes_ < 0 and maxEvents_ < 0) {
+      maxEvents_ = cloud_.size();
+    }
+    std::vector<std::size_t> sizes(cloud_.size());
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+      sizes[i] = cloud_.offsets[i + 1] - cloud_.offsets[i];
+    }
+    dispatcher_.setup(std::move(sizes), runForMinutes_ < 0 ? maxEvents_ : -1);
     if (validation_) {
-      for (unsigned int i = 0; i != cloud_.size(); ++i) {
-        assert(cloud_[i].x.size() == cloud_[i].y.size());
-        assert(cloud_[i].y.size() == cloud_[i].layer.size());
-        assert(cloud_[i].layer.size() == cloud_[i].weight.size());
-      }
+      assert(cloud_.x.size() == cloud_.y.size());
+      assert(cloud_.y.size() == cloud_.layer.size());
+      assert(cloud_.layer.size() == cloud_.weight.size());
     }
   }
 
-  Source3D::Source3D(
-      int maxEvents, int runForMinutes, ProductRegistry &reg, std::filesystem::path const &inputFile, bool validation)
-      : Source(maxEvents, runForMinutes, reg, inputFile, validation), clusterToken_(reg.produces<ClusterCollection>()) {
-    std::string input(inputFile);
-    std::ifstream in_raw(inputFile, std::ios::binary);
-    uint32_t n_points;
-    in_raw.exceptions(std::ifstream::badbit);
-    in_raw.read(reinterpret_cast<char *>(&n_points), sizeof(uint32_t));
-
-    while (not in_raw.eof()) {
-      in_raw.exceptions(std::ifstream::badbit | std::ifstream::failbit | std::ifstream::eofbit);
-      clusters_.emplace_back(readRaw3D(in_raw, n_points));
-
-      // next event
+  Source3D::Source3D(int maxEvents,
+                     int runForMinutes,
+                     ProductRegistry &reg,
+                     std::filesystem::path const &inputFile,
+                     bool validation,
+                     PileupOverlay const &pileup,
+                     ColdReplay const &coldReplay,
+                     DispatchOrder dispatchOrder)
+      : Source(maxEvents, runForMinutes, reg, inputFile, validation, pileup, coldReplay, dispatchOrder),
+        clusterToken_(reg.produces<ClusterCollection>()) {
+    if (eventcodec::isCompressed(inputFile)) {
+      eventcodec::read(inputFile, kColumns, [this](eventcodec::Columns &&columns) {
+        clusters_.emplace_back(toClusterCollection(std::move(columns)));
+      });
+    } else {
+      std::ifstream in_raw(inputFile, std::ios::binary);
+      uint32_t n_points;
       in_raw.exceptions(std::ifstream::badbit);
       in_raw.read(reinterpret_cast<char *>(&n_points), sizeof(uint32_t));
+
+      while (not in_raw.eof()) {
+        in_raw.exceptions(std::ifstream::badbit | std::ifstream::failbit | std::ifstream::eofbit);
+        clusters_.emplace_back(readRaw3D(in_raw, n_points));
+
+        // next event
+        in_raw.exceptions(std::ifstream::badbit);
+        in_raw.read(reinterpret_cast<char *>(&n_points), sizeof(uint32_t));
+      }
     }
+    replicate();
     if (runForMinutes_ < 0 and maxEvents_ < 0) {
       maxEvents_ = clusters_.size();
     }
+    std::vector<std::size_t> sizes;
+    sizes.reserve(clusters_.size());
+    for (auto const &event : clusters_) {
+      sizes.push_back(event.x.size());
+    }
+    dispatcher_.setup(std::move(sizes), runForMinutes_ < 0 ? maxEvents_ : -1);
+  }
+
+  void Source2D::replicate() {
+    std::size_t const nEvents = cloud_.size(), nPoints = cloud_.x.size();
+    int const n = replicas(nPoints * kColumns * sizeof(float));
+    if (n == 0) {
+      return;
+    }
+    auto reserve = [size = nPoints * (n + 1)](auto &... columns) { (columns.reserve(size), ...); };
+    reserve(cloud_.x, cloud_.y, cloud_.layer, cloud_.weight);
+    cloud_.offsets.reserve(nEvents * (n + 1) + 1);
+    for (int r = 1; r <= n; ++r) {
+      auto engine = replicaEngine(r);
+      std::normal_distribution<float> jitter(0.f, coldReplay_.jitter);
+      for (std::size_t e = 0; e < nEvents; ++e) {
+        auto data = cloud_.event(e);
+        if (coldReplay_.jitter > 0.f) {
+          for (std::size_t i = 0; i < data.x.size(); ++i) {
+            data.x[i] += jitter(engine);
+            data.y[i] += jitter(engine);
+          }
+        }
+        cloud_.append(data);
+      }
+    }
+  }
+
+  void Source3D::replicate() {
+    std::size_t const nEvents = clusters_.size();
+    std::size_t nPoints = 0;
+    for (auto const &event : clusters_) {
+      nPoints += event.x.size();
+    }
+    int const n = replicas(nPoints * kColumns * sizeof(float));
+    if (n == 0) {
+      return;
+    }
+    clusters_.reserve(nEvents * (n + 1));
+    for (int r = 1; r <= n; ++r) {
+      auto engine = replicaEngine(r);
+      std::normal_distribution<float> jitter(0.f, coldReplay_.jitter);
+      for (std::size_t e = 0; e < nEvents; ++e) {
+        ClusterCollection data = clusters_[e];
+        if (coldReplay_.jitter > 0.f) {
+          // z is the one of the layer, so only x and y move
+          for (std::size_t i = 0; i < data.x.size(); ++i) {
+            data.x[i] += jitter(engine);
+            data.y[i] += jitter(engine);
+            float const rxy = std::hypot(data.x[i], data.y[i]);
+            data.eta[i] = std::asinh(data.z[i] / rxy);
+            data.phi[i] = std::atan2(data.y[i], data.x[i]);
+            data.r_over_absz[i] = rxy / std::abs(data.z[i]);
+          }
+        }
+        clusters_.emplace_back(std::move(data));
+      }
+    }
+  }
+
+  PointsCloud Source2D::overlay(int iev) const {
+    auto engine = pileupEngine(iev);
+    int const k = pileupSize(engine);
+    std::uniform_int_distribution<std::size_t> pick(0, cloud_.size() - 1);
+    std::uniform_real_distribution<float> angle(-M_PI, M_PI);
+    std::bernoulli_distribution flip;
+
+    std::vector<std::size_t> events(k);
+    std::size_t nPoints = 0;
+    for (auto &e : events) {
+      e = pick(engine);
+      nPoints += cloud_.offsets[e + 1] - cloud_.offsets[e];
+    }
+    PointsCloud data;
+    data.x.reserve(nPoints);
+    data.y.reserve(nPoints);
+    data.layer.reserve(nPoints);
+    data.weight.reserve(nPoints);
+    for (auto e : events) {
+      auto const begin = cloud_.offsets[e], end = cloud_.offsets[e + 1];
+      float cxx = 1.f, cxy = 0.f, cyx = 0.f, cyy = 1.f;
+      if (pileup_.rotation == PileupOverlay::Rotation::Phi) {
+        float const alpha = angle(engine);
+        cxx = cyy = std::cos(alpha);
+        cyx = std::sin(alpha);
+        cxy = -cyx;
+      } else if (pileup_.rotation == PileupOverlay::Rotation::XY) {
+        cxx = flip(engine) ? -1.f : 1.f;
+        cyy = flip(engine) ? -1.f : 1.f;
+      }
+      for (std::size_t i = begin; i < end; ++i) {
+        data.x.emplace_back(cxx * cloud_.x[i] + cxy * cloud_.y[i]);
+        data.y.emplace_back(cyx * cloud_.x[i] + cyy * cloud_.y[i]);
+      }
+      data.layer.insert(data.layer.end(), cloud_.layer.begin() + begin, cloud_.layer.begin() + end);
+      data.weight.insert(data.weight.end(), cloud_.weight.begin() + begin, cloud_.weight.begin() + end);
+    }
+    return data;
+  }
+
+  ClusterCollection Source3D::overlay(int iev) const {
+    auto engine = pileupEngine(iev);
+    int const k = pileupSize(engine);
+    std::uniform_int_distribution<std::size_t> pick(0, clusters_.size() - 1);
+    std::uniform_real_distribution<float> angle(-M_PI, M_PI);
+    std::bernoulli_distribution flip;
+
+    std::vector<std::size_t> events(k);
+    std::size_t nPoints = 0;
+    for (auto &e : events) {
+      e = pick(engine);
+      nPoints += clusters_[e].x.size();
+    }
+    ClusterCollection data;
+    auto reserve = [nPoints](auto &... columns) { (columns.reserve(nPoints), ...); };
+    reserve(data.x,
+            data.y,
+            data.z,
+            data.eta,
+            data.phi,
+            data.r_over_absz,
+            data.radius,
+            data.layer,
+            data.energy,
+            data.isSilicon);
+    for (auto e : events) {
+      auto const &in = clusters_[e];
+      // the rotation or mirroring is expressed as phi -> sign * phi + offset
+      float sign = 1.f, offset = 0.f;
+      if (pileup_.rotation == PileupOverlay::Rotation::Phi) {
+        offset = angle(engine);
+      } else if (pileup_.rotation == PileupOverlay::Rotation::XY) {
+        if (flip(engine)) {
+          // x -> -x
+          sign = -sign;
+          offset = M_PI;
+        }
+        if (flip(engine)) {
+          // y -> -y
+          sign = -sign;
+          offset = -offset;
+        }
+      }
+      float const c = std::cos(offset), s = std::sin(offset);
+      for (std::size_t i = 0; i < in.x.size(); ++i) {
+        float const y = sign * in.y[i];
+        data.x.emplace_back(c * in.x[i] - s * y);
+        data.y.emplace_back(s * in.x[i] + c * y);
+        data.phi.emplace_back(std::remainder(sign * in.phi[i] + offset, static_cast<float>(2 * M_PI)));
+      }
+      data.z.insert(data.z.end(), in.z.begin(), in.z.end());
+      data.eta.insert(data.eta.end(), in.eta.begin(), in.eta.end());
+      data.r_over_absz.insert(data.r_over_absz.end(), in.r_over_absz.begin(), in.r_over_absz.end());
+      data.radius.insert(data.radius.end(), in.radius.begin(), in.radius.end());
+      data.layer.insert(data.layer.end(), in.layer.begin(), in.layer.end());
+      data.energy.insert(data.energy.end(), in.energy.begin(), in.energy.end());
+      data.isSilicon.insert(data.isSilicon.end(), in.isSilicon.begin(), in.isSilicon.end());
+    }
+    return data;
   }
 
   void Source::startProcessing() {
     if (runForMinutes_ >= 0) {
       startTime_ = std::chrono::steady_clock::now();
     }
+    dispatcher_.start();
   }
 
   std::unique_ptr<Event> Source2D::produce(int streamId, ProductRegistry const &reg) {
     if (shouldStop_) {
+      dispatcher_.outOfEvents(streamId);
       return nullptr;
     }
 
     const int old = numEvents_.fetch_add(1);
-    const int iev = old + 1;
     if (runForMinutes_ < 0) {
       if (old >= maxEvents_) {
         shouldStop_ = true;
         --numEvents_;
+        dispatcher_.outOfEvents(streamId);
         return nullptr;
       }
     } else {
@@ -175,29 +489,37 @@ namespace edm {
         }
         if (shouldStop_) {
           --numEvents_;
+          dispatcher_.outOfEvents(streamId);
           return nullptr;
         }
       }
     }
+    const int iev = dispatcher_.eventNumber(streamId, old);
+    flushCaches();
     auto ev = std::make_unique<Event>(streamId, iev, reg);
-    const int index = old % cloud_.size();
+    const int index = (iev - 1) % cloud_.size();
 
-    ev->emplace(cloudToken_, cloud_[index]);
+    if (pileup_.enabled()) {
+      ev->emplace(cloudToken_, overlay(iev));
+    } else {
+      ev->emplace(cloudToken_, cloud_.event(index));
+    }
 
     return ev;
   }
 
   std::unique_ptr<Event> Source3D::produce(int streamId, ProductRegistry const &reg) {
     if (shouldStop_) {
+      dispatcher_.outOfEvents(streamId);
       return nullptr;
     }
 
     const int old = numEvents_.fetch_add(1);
-    const int iev = old + 1;
     if (runForMinutes_ < 0) {
       if (old >= maxEvents_) {
         shouldStop_ = true;
         --numEvents_;
+        dispatcher_.outOfEvents(streamId);
         return nullptr;
       }
     } else {
@@ -213,14 +535,21 @@ namespace edm {
         }
         if (shouldStop_) {
           --numEvents_;
+          dispatcher_.outOfEvents(streamId);
           return nullptr;
         }
       }
     }
+    const int iev = dispatcher_.eventNumber(streamId, old);
+    flushCaches();
     auto ev = std::make_unique<Event>(streamId, iev, reg);
-    const int index = old % clusters_.size();
+    const int index = (iev - 1) % clusters_.size();
 
-    ev->emplace(clusterToken_, clusters_[index]);
+    if (pileup_.enabled()) {
+      ev->emplace(clusterToken_, overlay(iev));
+    } else {
+      ev->emplace(clusterToken_, clusters_[index]);
+    }
 
     return ev;
   }
@@ -6,32 +6,91 @@
 #include <filesystem>
 #include <memory>
 #include <mutex>
+#include <random>
 #include <string>
+#include <vector>
 
 #include "Framework/Event.h"
+#include "Framework/HugePages.h"
+#include "EventDispatcher.h"
 #include "DataFormats/PointsCloud.h"
 #include "DataFormats/ClusterCollection.h"
 #include "DataFormats/LayerTilesConstants.h"
 
 namespace edm {
+
+  // Emulation of higher occupancy by overlaying, in each event, K
+  // randomly chosen events of the input file. The choice only depends
+  // on the seed and on the event number.
+  struct PileupOverlay {
+    enum class Distribution { Fixed, Poisson, Uniform };
+    enum class Rotation { None, Phi, XY };
+
+    int k = 0;  // 0 disables the overlay
+    // Fixed: always k; Poisson: mean k; Uniform: between 1 and 2k-1
+    Distribution distribution = Distribution::Fixed;
+    // Phi: random rotation around the beam axis; XY: random mirroring in x and y
+    Rotation rotation = Rotation::None;
+    unsigned int seed = 12345;
+
+    bool enabled() const { return k > 0; }
+  };
+
+  // Replay of a pool of replicas of the input events, larger than the
+  // last level cache, instead of the input events alone, which stay in
+  // the cache when they are few and make the throughput optimistic. Each
+  // replica moves the x and y of the points by a gaussian jitter (and
+  // updates eta, phi and r/|z| accordingly in CLUE3D).
+  struct ColdReplay {
+    std::size_t poolBytes = 0;  // 0 disables the replay
+    float jitter = 0.01f;       // standard deviation of the jitter, in cm
+    // also evict the caches, by reading a buffer larger than the last
+    // level cache, before each event
+    bool flush = false;
+    unsigned int seed = 12345;
+
+    bool enabled() const { return poolBytes > 0; }
+
+    // size of the last level cache of the machine
+    static std::size_t lastLevelCacheBytes();
+  };
+
   class Source {
   public:
     explicit Source(int maxEvents,
                     int runForMinutes,
                     ProductRegistry& reg,
                     std::filesystem::path const& inputFile,
-                    bool validation);
+                    bool validation,
+                    PileupOverlay const& pileup = PileupOverlay(),
+                    ColdReplay const& coldReplay = ColdReplay(),
+                    DispatchOrder dispatchOrder = DispatchOrder::File);
 
     virtual ~Source() = default;
     void startProcessing();
 
     int maxEvents() const { return maxEvents_; }
     int processedEvents() const { return numEvents_; }
+    // number of input events, with the replicas of the cold replay
+    int inputEvents() const { return dispatcher_.events(); }
+    // time spent evicting the caches, summed over the streams
+    double flushSeconds() const { return flushNanoseconds_ * 1e-9; }
+    EventDispatcher const& dispatcher() const { return dispatcher_; }
 
     // thread safe
     virtual std::unique_ptr<Event> produce(int streamId, ProductRegistry const& reg) = 0;
 
   protected:
+    // random engine of the overlay of event iev, and the number of events to overlay
+    std::mt19937 pileupEngine(int iev) const;
+    int pileupSize(std::mt19937& engine) const;
+    // random engine of the r-th replica of the input events
+    std::mt19937 replicaEngine(int replica) const;
+    // number of replicas of the input events, of inputBytes in total, for the cold replay
+    int replicas(std::size_t inputBytes) const;
+    // evicts the caches if the cold replay asks for it
+    void flushCaches();
+
     int maxEvents_;
 
     // these are all for the mode where the processing length is limited by time
@@ -43,37 +102,82 @@ namespace edm {
 
     std::atomic<int> numEvents_ = 0;
     bool validation_;
+    PileupOverlay const pileup_;
+    ColdReplay const coldReplay_;
+    std::vector<char> flushBuffer_;
+    std::atomic<unsigned int> flushSink_ = 0;
+    std::atomic<long long> flushNanoseconds_ = 0;
+    EventDispatcher dispatcher_;
   };
+
   class Source2D : public Source {
   public:
+    // x, y, layer and weight of each point in the input file
+    static constexpr unsigned int kColumns = 4;
+
     explicit Source2D(int maxEvents,
                       int runForMinutes,
                       ProductRegistry& reg,
                       std::filesystem::path const& inputFile,
-                      bool validation);
+                      bool validation,
+                      PileupOverlay const& pileup = PileupOverlay(),
+                      ColdReplay const& coldReplay = ColdReplay(),
+                      DispatchOrder dispatchOrder = DispatchOrder::File);
     //thread safe
     std::unique_ptr<Event> produce(int streamId, ProductRegistry const& reg) override;
 
   private:
+    // All the input events, packed column by column in buffers backed
+    // according to the huge page policy, as the pileup overlay gathers
+    // from random events
+    struct InputStore {
+      template <typename T>
+      using Column = std::vector<T, hugepages::Allocator<T>>;
+
+      void append(PointsCloud const& event);
+      PointsCloud event(std::size_t index) const;
+      std::size_t size() const { return offsets.size() - 1; }
+
+      std::vector<std::size_t> offsets{0};
+      Column<float> x;
+      Column<float> y;
+      Column<int> layer;
+      Column<float> weight;
+    };
+
+    PointsCloud overlay(int iev) const;
+    // appends the jittered replicas of the input events
+    void replicate();
+
     EDPutTokenT<PointsCloud> const cloudToken_;
-    std::vector<PointsCloud> cloud_;
+    InputStore cloud_;
   };
 
   class Source3D : public Source {
   public:
+    // x, y, z, eta, phi, r_over_absz, radius, layer, energy and isSilicon
+    static constexpr unsigned int kColumns = 10;
+
     explicit Source3D(int maxEvents,
                       int runForMinutes,
                       ProductRegistry& reg,
                       std::filesystem::path const& inputFile,
-                      bool validation);
+                      bool validation,
+                      PileupOverlay const& pileup = PileupOverlay(),
+                      ColdReplay const& coldReplay = ColdReplay(),
+                      DispatchOrder dispatchOrder = DispatchOrder::File);
     //thread safe
     std::unique_ptr<Event> produce(int streamId, ProductRegistry const& reg) override;
 
   private:
+    ClusterCollection overlay(int iev) const;
+    // appends the jittered replicas of the input events
+    void replicate();
+
     EDPutTokenT<ClusterCollection> const clusterToken_;
     std::vector<ClusterCollection> clusters_;
   };
-  
+
 }  // namespace edm
 
 #endif
\ No newline at end of file
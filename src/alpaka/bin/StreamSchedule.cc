@@ -8,6 +8,7 @@
 
 #include "Framework/FunctorTask.h"
 #include "Framework/PluginFactory.h"
+#include "Framework/TaskPool.h"
 #include "Framework/WaitingTask.h"
 #include "Framework/Worker.h"
 
@@ -24,22 +25,36 @@ namespace edm {
                                  std::vector<std::string> const& path)
       : registry_(std::move(reg)), source_(source), eventSetup_(eventSetup), streamId_(streamId) {
     path_.reserve(path.size());
+    // up to two tasks per module (acquire and produce) and the end of the
+    // event, for the event being processed and the previous one, whose
+    // tasks may not all have been recycled yet, and the task starting the
+    // stream
+    taskPool_ = std::make_unique<TaskPool>(2 * (2 * path.size() + 1) + 1);
+    // the number of doWorkAsync() calls each worker receives per event
+    std::vector<unsigned int> callers(path.size(), 0);
     int modInd = 1;
     for (auto const& name : path) {
       pluginManager.load(name);
       registry_.beginModuleConstruction(modInd);
       path_.emplace_back(PluginFactory::create(name, registry_));
+      path_.back()->setTag(name, streamId_);
+      path_.back()->setTaskPool(taskPool_.get());
       //std::cout << "module " << modInd << " " << path_.back().get() << std::endl;
       std::vector<Worker*> consumes;
       for (unsigned int depInd : registry_.consumedModules()) {
         if (depInd != ProductRegistry::kSourceIndex) {
           //std::cout << "module " << modInd << " depends on " << (depInd-1) << " " << path_[depInd-1].get() << std::endl;
           consumes.push_back(path_[depInd - 1].get());
+          ++callers[depInd - 1];
         }
       }
       path_.back()->setItemsToGet(std::move(consumes));
       ++modInd;
     }
+    // all the workers are started for each event
+    for (std::size_t i = 0; i < path_.size(); ++i) {
+      path_[i]->reserveWaitingTasks(callers[i] + 1);
+    }
   }
 
   StreamSchedule::~StreamSchedule() = default;
@@ -47,7 +62,7 @@ namespace edm {
   StreamSchedule& StreamSchedule::operator=(StreamSchedule&&) = default;
 
   void StreamSchedule::runToCompletionAsync(WaitingTaskHolder h) {
-    auto task = make_functor_task([this, h]() mutable { processOneEventAsync(std::move(h)); });
+    auto task = make_functor_task(*taskPool_, [this, h]() mutable { processOneEventAsync(std::move(h)); });
     if (streamId_ == 0) {
       h.group()->run([task]() {
         TaskSentry s{task};
@@ -70,8 +85,8 @@ namespace edm {
       //std::cout << "Begin processing event " << event->eventID() << std::endl;
       auto eventPtr = event.get();
       auto* group = h.group();
-      auto nextEventTask =
-          make_waiting_task([this, h = std::move(h), ev = std::move(event)](std::exception_ptr const* iPtr) mutable {
+      auto nextEventTask = make_waiting_task(
+          *taskPool_, [this, h = std::move(h), ev = std::move(event)](std::exception_ptr const* iPtr) mutable {
             ev.reset();
             if (iPtr) {
               h.doneWaiting(*iPtr);
@@ -15,6 +15,7 @@ namespace edmplugin {
 namespace edm {
   class EventSetup;
   class Source;
+  class TaskPool;
   class Worker;
 
   // Schedule of modules per stream (concurrent event)
@@ -44,6 +45,8 @@ namespace edm {
     Source* source_;
     EventSetup const* eventSetup_;
     std::vector<std::unique_ptr<Worker>> path_;
+    // for the tasks of each event, shared by the workers
+    std::unique_ptr<TaskPool> taskPool_;
     int streamId_;
   };
 }  // namespace edm
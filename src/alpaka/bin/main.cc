@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -15,8 +17,12 @@
 #include "AlpakaCore/alpakaConfig.h"
 #include "AlpakaCore/backend.h"
 #include "AlpakaCore/initialise.h"
+#include "EnergyMeter.h"
 #include "EventProcessor.h"
+#include "Framework/HugePages.h"
 #include "PosixClockGettime.h"
+#include "SamplingProfiler.h"
+#include "TLBMissCounter.h"
 
 namespace {
   void print_help(std::string const& name) {
@@ -35,7 +41,9 @@ namespace {
 #endif
               << "[--dim D] [--numberOfThreads NT] [--numberOfStreams NS] [--maxEvents ME] [--inputFile "
                  "PATH] [--configFile] [--transfer] [--validation] "
-                 "[--empty]\n\n"
+                 "[--empty] [--pileup K] [--pileupDistribution D] [--pileupRotation R] [--pileupSeed S] [--hugePages P] "
+                 "[--coldCache MB] [--coldCacheJitter J] [--coldCacheFlush] [--energy] [--profile PATH] "
+                 "[--profileFrequency HZ] [--dispatchOrder O]\n\n"
               << "Options\n"
 #ifdef ALPAKA_ACC_CPU_B_SEQ_T_SEQ_PRESENT
               << " --serial            Use CPU Serial backend\n"
@@ -63,6 +71,32 @@ namespace {
               << " --transfer          Transfer results from GPU to CPU (default is to leave them on GPU)\n"
               << " --validation        Run (rudimentary) validation at the end (CLUE 2D only, implies --transfer)\n"
               << " --empty             Ignore all producers (for testing only)\n"
+              << " --pileup            Overlay K randomly chosen input events in each event, to emulate a higher "
+                 "occupancy (default 0 for disabled; conflicts with --validation)\n"
+              << " --pileupDistribution  Number of overlaid events: 'fixed' K (default), 'poisson' with mean K, or "
+                 "'uniform' between 1 and 2K-1\n"
+              << " --pileupRotation    Randomise each overlaid event: 'none' (default), 'phi' for a rotation around the "
+                 "beam axis, or 'xy' for mirroring in x and y\n"
+              << " --pileupSeed        Seed of the choice of the overlaid events (default 12345)\n"
+              << " --hugePages         Back the input store and the host memory of the caching allocators with huge "
+                 "pages: 'none', 'advise' for transparent huge pages, or 'explicit' for pre-reserved 2 MB pages "
+                 "falling back to 'advise' (default: not set, same as 'none'); when given, the data TLB misses are "
+                 "reported at the end\n"
+              << " --coldCache         Replay a pool of MB megabytes ('auto' for twice the last level cache) of replicas "
+                 "of the input events with jittered coordinates, after a reference run replaying the input events "
+                 "alone, and compare the throughputs (default 0 for disabled; conflicts with --validation)\n"
+              << " --coldCacheJitter   Standard deviation of the jitter of the replicas, in cm (default 0.01)\n"
+              << " --coldCacheFlush    With --coldCache, also evict the caches before each event\n"
+              << " --energy            Measure the energy used by the CPU packages and their DRAM with the RAPL "
+                 "counters, and report it with the throughput\n"
+              << " --profile           Sample the call stacks of the threads while running, write them to PATH in the "
+                 "folded format of flamegraph.pl, rooted at the module that was running, and report the share of "
+                 "each module\n"
+              << " --profileFrequency  Samples per second of CPU time with --profile (default 250)\n"
+              << " --dispatchOrder     Order in which the events are handed out to the streams: 'file' (default), "
+                 "'largest' for the events with the most points first, 'interleaved' for the largest events "
+                 "alternated with the smallest, or 'learned' for the longest first, from the time measured on the "
+                 "previous passes over the input (conflicts with --pileup)\n"
               << std::endl;
   }
 }  // namespace
@@ -110,6 +144,19 @@ bool getOptionalArgument(std::vector<std::string> const& args,
   return true;
 }
 
+bool getOptionalArgument(std::vector<std::string> const& args,
+                         std::vector<std::string>::iterator& i,
+                         std::string& value) {
+  auto it = i;
+  ++it;
+  if (it == args.end()) {
+    return false;
+  }
+  value = *it;
+  ++i;
+  return true;
+}
+
 template <typename T>
 void getArgument(std::vector<std::string> const& args, std::vector<std::string>::iterator& i, T& value) {
   if (not getOptionalArgument(args, i, value)) {
@@ -132,6 +179,13 @@ int main(int argc, char** argv) {
   bool transfer = false;
   bool validation = false;
   bool empty = false;
+  edm::PileupOverlay pileup;
+  edm::ColdReplay coldReplay;
+  std::unique_ptr<edm::TLBMissCounter> tlbMisses;
+  std::unique_ptr<edm::EnergyMeter> energy;
+  std::string profileFile;
+  int profileFrequency = 250;
+  edm::DispatchOrder dispatchOrder = edm::DispatchOrder::File;
   for (auto i = args.begin() + 1, e = args.end(); i != e; ++i) {
     if (*i == "-h" or *i == "--help") {
       print_help(args.front());
@@ -186,6 +240,70 @@ int main(int argc, char** argv) {
       }
     } else if (*i == "--empty") {
       empty = true;
+    } else if (*i == "--pileup") {
+      getArgument(args, i, pileup.k);
+    } else if (*i == "--pileupDistribution") {
+      std::string value;
+      getArgument(args, i, value);
+      if (value == "fixed") {
+        pileup.distribution = edm::PileupOverlay::Distribution::Fixed;
+      } else if (value == "poisson") {
+        pileup.distribution = edm::PileupOverlay::Distribution::Poisson;
+      } else if (value == "uniform") {
+        pileup.distribution = edm::PileupOverlay::Distribution::Uniform;
+      } else {
+        std::cerr << "error: invalid pileup distribution " << value << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (*i == "--pileupRotation") {
+      std::string value;
+      getArgument(args, i, value);
+      if (value == "none") {
+        pileup.rotation = edm::PileupOverlay::Rotation::None;
+      } else if (value == "phi") {
+        pileup.rotation = edm::PileupOverlay::Rotation::Phi;
+      } else if (value == "xy") {
+        pileup.rotation = edm::PileupOverlay::Rotation::XY;
+      } else {
+        std::cerr << "error: invalid pileup rotation " << value << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (*i == "--pileupSeed") {
+      int seed;
+      getArgument(args, i, seed);
+      pileup.seed = seed;
+    } else if (*i == "--coldCache") {
+      std::string value;
+      getArgument(args, i, value);
+      coldReplay.poolBytes = value == "auto" ? 2 * edm::ColdReplay::lastLevelCacheBytes() : std::stoul(value) << 20;
+    } else if (*i == "--coldCacheJitter") {
+      getArgument(args, i, coldReplay.jitter);
+    } else if (*i == "--coldCacheFlush") {
+      coldReplay.flush = true;
+    } else if (*i == "--energy") {
+      energy = std::make_unique<edm::EnergyMeter>();
+    } else if (*i == "--profile") {
+      getArgument(args, i, profileFile);
+    } else if (*i == "--profileFrequency") {
+      getArgument(args, i, profileFrequency);
+    } else if (*i == "--dispatchOrder") {
+      std::string value;
+      getArgument(args, i, value);
+      if (not edm::EventDispatcher::parse(value, dispatchOrder)) {
+        std::cerr << "error: invalid dispatch order " << value << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (*i == "--hugePages") {
+      std::string value;
+      getArgument(args, i, value);
+      try {
+        edm::hugepages::setPolicy(edm::hugepages::parsePolicy(value));
+      } catch (std::invalid_argument& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+      }
+      // before any thread is started, so that all of them are counted
+      tlbMisses = std::make_unique<edm::TLBMissCounter>();
     } else {
       std::cout << "Invalid parameter " << *i << std::endl << std::endl;
       print_help(args.front());
@@ -200,6 +318,23 @@ int main(int argc, char** argv) {
     std::cout << "Got both --maxEvents and --runForMinutes, please give only one of them" << std::endl;
     return EXIT_FAILURE;
   }
+  if (pileup.enabled() and validation) {
+    std::cout << "Got both --pileup and --validation, the overlaid events can not be validated" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (pileup.enabled() and dispatchOrder != edm::DispatchOrder::File) {
+    std::cout << "Got both --pileup and --dispatchOrder, the overlaid events are always handed out in order"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (coldReplay.enabled() and validation) {
+    std::cout << "Got both --coldCache and --validation, the replicas can not be validated" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (coldReplay.flush and not coldReplay.enabled()) {
+    std::cout << "--coldCacheFlush requires --coldCache" << std::endl;
+    return EXIT_FAILURE;
+  }
   if (numberOfThreads == 0) {
     numberOfThreads = tbb::info::default_concurrency();
   }
@@ -223,6 +358,15 @@ int main(int argc, char** argv) {
     std::cout << "Config file '" << configFile << "' does not exist" << std::endl;
     return EXIT_FAILURE;
   }
+  std::unique_ptr<edm::SamplingProfiler> profiler;
+  if (not profileFile.empty()) {
+    try {
+      profiler = std::make_unique<edm::SamplingProfiler>(profileFrequency);
+    } catch (std::invalid_argument& e) {
+      std::cout << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
   // Initialiase the selected backends
 #ifdef ALPAKA_ACC_CPU_B_SEQ_T_SEQ_PRESENT
   if (backends.find(Backend::SERIAL) != backends.end()) {
@@ -306,83 +450,170 @@ int main(int argc, char** argv) {
     }
   }
 
+  // Initialize the TBB thread pool
+  tbb::global_control tbb_max_threads{tbb::global_control::max_allowed_parallelism,
+                                      static_cast<std::size_t>(numberOfThreads)};
+
+  // Runs the events and the endJob of processor and reports the timing;
+  // returns the wall clock time, or a negative value after an exception.
+  // The TLB misses, the energy and the profile follow only the main run.
+  auto process = [&](edm::EventProcessor& processor, bool main) -> double {
+    if (runForMinutes < 0) {
+      std::cout << "Processing " << processor.maxEvents() << " events,";
+    } else {
+      std::cout << "Processing for about " << runForMinutes << " minutes,";
+    }
+    {
+      std::cout << " with " << numberOfStreams << " concurrent events (";
+      bool need_comma = false;
+      for (auto const& [backend, streams] : processor.backends()) {
+        if (need_comma) {
+          std::cout << ", ";
+        }
+        std::cout << streams << " on " << backend;
+        need_comma = true;
+      }
+      std::cout << ") and " << numberOfThreads << " threads." << std::endl;
+    }
+
+    // Run work
+    auto cpu_start = PosixClockGettime<CLOCK_PROCESS_CPUTIME_ID>::now();
+    auto start = std::chrono::high_resolution_clock::now();
+    try {
+      tbb::task_arena arena(numberOfThreads);
+      if (main and tlbMisses) {
+        tlbMisses->start();
+      }
+      if (main and energy) {
+        energy->start();
+      }
+      if (main and profiler) {
+        profiler->start();
+      }
+      arena.execute([&] { processor.runToCompletion(); });
+      if (main and profiler) {
+        profiler->stop();
+      }
+      if (main and energy) {
+        energy->stop();
+      }
+      if (main and tlbMisses) {
+        tlbMisses->stop();
+      }
+    } catch (std::runtime_error& e) {
+      std::cout << "\n----------\nCaught std::runtime_error" << std::endl;
+      std::cout << e.what() << std::endl;
+      return -1.;
+    } catch (std::exception& e) {
+      std::cout << "\n----------\nCaught std::exception" << std::endl;
+      std::cout << e.what() << std::endl;
+      return -1.;
+    } catch (...) {
+      std::cout << "\n----------\nCaught exception of unknown type" << std::endl;
+      return -1.;
+    }
+    auto cpu_stop = PosixClockGettime<CLOCK_PROCESS_CPUTIME_ID>::now();
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    // Run endJob
+    try {
+      processor.endJob();
+    } catch (std::runtime_error& e) {
+      std::cout << "\n----------\nCaught std::runtime_error" << std::endl;
+      std::cout << e.what() << std::endl;
+      return -1.;
+    } catch (std::exception& e) {
+      std::cout << "\n----------\nCaught std::exception" << std::endl;
+      std::cout << e.what() << std::endl;
+      return -1.;
+    } catch (...) {
+      std::cout << "\n----------\nCaught exception of unknown type" << std::endl;
+      return -1.;
+    }
+
+    // Work done, report timing
+    auto diff = stop - start;
+    auto time = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(diff).count()) / 1e6;
+    auto cpu_diff = cpu_stop - cpu_start;
+    auto cpu = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(cpu_diff).count()) / 1e6;
+    int const events = processor.processedEvents();
+    // before the throughput, which the scripts read from the last line
+    if (numberOfStreams > 1) {
+      processor.dispatcher().report(std::cout);
+    }
+    std::cout << "Processed " << events << " events in " << std::scientific << std::setprecision(6) << time
+              << " seconds, throughput " << std::defaultfloat << (events / time) << " events/s, CPU usage per thread: "
+              << std::fixed << std::setprecision(1) << (cpu / time / numberOfThreads * 100) << "%" << std::endl;
+    if (main and energy) {
+      energy->report(std::cout, events);
+    }
+    if (main and tlbMisses) {
+      tlbMisses->report(std::cout, events);
+    }
+    if (main and profiler) {
+      profiler->report(std::cout);
+      try {
+        profiler->writeFolded(profileFile);
+      } catch (std::runtime_error& e) {
+        std::cout << e.what() << std::endl;
+        return -1.;
+      }
+    }
+    return time;
+  };
+
   edm::EventProcessor processor(dim,
                                 maxEvents,
                                 runForMinutes,
                                 numberOfStreams,
-                                std::move(alternatives),
-                                std::move(esmodules),
+                                alternatives,
+                                esmodules,
                                 inputFile,
                                 configFile,
-                                validation);
-
-  if (runForMinutes < 0) {
-    std::cout << "Processing " << processor.maxEvents() << " events,";
-  } else {
-    std::cout << "Processing for about " << runForMinutes << " minutes,";
-  }
-  {
-    std::cout << " with " << numberOfStreams << " concurrent events (";
-    bool need_comma = false;
-    for (auto const& [backend, streams] : processor.backends()) {
-      if (need_comma) {
-        std::cout << ", ";
-      }
-      std::cout << streams << " on " << backend;
-      need_comma = true;
+                                validation,
+                                pileup,
+                                coldReplay,
+                                dispatchOrder);
+  double hotThroughput = 0.;
+  if (coldReplay.enabled()) {
+    // reference run over as many events, replaying the input events alone
+    edm::EventProcessor reference(dim,
+                                  runForMinutes < 0 ? processor.maxEvents() : -1,
+                                  runForMinutes,
+                                  numberOfStreams,
+                                  std::move(alternatives),
+                                  esmodules,
+                                  inputFile,
+                                  configFile,
+                                  validation,
+                                  pileup,
+                                  edm::ColdReplay(),
+                                  dispatchOrder);
+    std::cout << "Hot cache reference run" << std::endl;
+    double const time = process(reference, false);
+    if (time < 0.) {
+      return EXIT_FAILURE;
     }
-    std::cout << ") and " << numberOfThreads << " threads." << std::endl;
+    hotThroughput = reference.processedEvents() / time;
+    std::cout << "Cold cache run, replaying a pool of " << processor.inputEvents() << " events" << std::endl;
   }
-
-  // Initialize the TBB thread pool
-  tbb::global_control tbb_max_threads{tbb::global_control::max_allowed_parallelism,
-                                      static_cast<std::size_t>(numberOfThreads)};
-
-  // Run work
-  auto cpu_start = PosixClockGettime<CLOCK_PROCESS_CPUTIME_ID>::now();
-  auto start = std::chrono::high_resolution_clock::now();
-  try {
-    tbb::task_arena arena(numberOfThreads);
-    arena.execute([&] { processor.runToCompletion(); });
-  } catch (std::runtime_error& e) {
-    std::cout << "\n----------\nCaught std::runtime_error" << std::endl;
-    std::cout << e.what() << std::endl;
-    return EXIT_FAILURE;
-  } catch (std::exception& e) {
-    std::cout << "\n----------\nCaught std::exception" << std::endl;
-    std::cout << e.what() << std::endl;
-    return EXIT_FAILURE;
-  } catch (...) {
-    std::cout << "\n----------\nCaught exception of unknown type" << std::endl;
+  double const time = process(processor, true);
+  if (time < 0.) {
     return EXIT_FAILURE;
   }
-  auto cpu_stop = PosixClockGettime<CLOCK_PROCESS_CPUTIME_ID>::now();
-  auto stop = std::chrono::high_resolution_clock::now();
-
-  // Run endJob
-  try {
-    processor.endJob();
-  } catch (std::runtime_error& e) {
-    std::cout << "\n----------\nCaught std::runtime_error" << std::endl;
-    std::cout << e.what() << std::endl;
-    return EXIT_FAILURE;
-  } catch (std::exception& e) {
-    std::cout << "\n----------\nCaught std::exception" << std::endl;
-    std::cout << e.what() << std::endl;
-    return EXIT_FAILURE;
-  } catch (...) {
-    std::cout << "\n----------\nCaught exception of unknown type" << std::endl;
-    return EXIT_FAILURE;
+  if (coldReplay.enabled()) {
+    double const coldThroughput = processor.processedEvents() / time;
+    std::cout << std::fixed << std::setprecision(1) << "Cold cache throughput " << coldThroughput << " events/s, "
+              << 100. * coldThroughput / hotThroughput << "% of the hot cache throughput of " << hotThroughput
+              << " events/s";
+    if (coldReplay.flush) {
+      // the streams flush concurrently, on at most one thread each
+      double const flushTime = processor.flushSeconds() / std::min(numberOfStreams, numberOfThreads);
+      double const throughput = processor.processedEvents() / (time - flushTime);
+      std::cout << "; excluding the " << flushTime << " s spent flushing the caches, " << throughput << " events/s, "
+                << 100. * throughput / hotThroughput << "%";
+    }
+    std::cout << std::endl;
   }
-
-  // Work done, report timing
-  auto diff = stop - start;
-  auto time = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(diff).count()) / 1e6;
-  auto cpu_diff = cpu_stop - cpu_start;
-  auto cpu = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(cpu_diff).count()) / 1e6;
-  maxEvents = processor.processedEvents();
-  std::cout << "Processed " << maxEvents << " events in " << std::scientific << time << " seconds, throughput "
-            << std::defaultfloat << (maxEvents / time) << " events/s, CPU usage per thread: " << std::fixed
-            << std::setprecision(1) << (cpu / time / numberOfThreads * 100) << "%" << std::endl;
   return EXIT_SUCCESS;
 }
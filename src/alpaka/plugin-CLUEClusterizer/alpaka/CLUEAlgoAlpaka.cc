@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <numeric>
+
 #include "DataFormats/PointsCloud.h"
 
 #include "AlpakaCore/alpakaConfig.h"
@@ -11,20 +14,18 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
 
   void CLUEAlgoAlpaka::init_device(Queue queue_) {
     d_hist = cms::alpakatools::make_device_buffer<LayerTilesAlpaka[]>(queue_, NLAYERS);
-    d_seeds = cms::alpakatools::make_device_buffer<cms::alpakatools::VecArray<int, maxNSeeds>>(queue_);
+    d_layerOffsets = cms::alpakatools::make_device_buffer<uint32_t[]>(queue_, NLAYERS + 1);
+    d_layerPoints = cms::alpakatools::make_device_buffer<uint32_t[]>(queue_, reserve);
+    d_layerSeeds = cms::alpakatools::make_device_buffer<int[]>(queue_, reserve);
+    d_nSeeds = cms::alpakatools::make_device_buffer<uint32_t[]>(queue_, NLAYERS);
+    d_clusterOffsets = cms::alpakatools::make_device_buffer<int[]>(queue_, NLAYERS);
     d_followers =
         cms::alpakatools::make_device_buffer<cms::alpakatools::VecArray<int, maxNFollowers>[]>(queue_, reserve);
     hist_ = (*d_hist).data();
-    seeds_ = (*d_seeds).data();
     followers_ = (*d_followers).data();
   }
 
-  void CLUEAlgoAlpaka::setup(PointsCloud const &host_pc, PointsCloudAlpaka &d_points, Queue queue_) {
-    // copy input variables
-    alpaka::memcpy(queue_, d_points.x, cms::alpakatools::make_host_view(host_pc.x.data(), host_pc.x.size()));
-    alpaka::memcpy(queue_, d_points.y, cms::alpakatools::make_host_view(host_pc.y.data(), host_pc.x.size()));
-    alpaka::memcpy(queue_, d_points.layer, cms::alpakatools::make_host_view(host_pc.layer.data(), host_pc.x.size()));
-    alpaka::memcpy(queue_, d_points.weight, cms::alpakatools::make_host_view(host_pc.weight.data(), host_pc.x.size()));
+  void CLUEAlgoAlpaka::setup(Queue queue_) {
     // initialize result and internal variables
     // alpaka::memset(queue_, d_points.rho, 0x00, static_cast<uint32_t>(host_pc.x.size()));
     // alpaka::memset(queue_, d_points.delta, 0x00, static_cast<uint32_t>(host_pc.x.size()));
@@ -32,55 +33,88 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     // alpaka::memset(queue_, d_points.clusterIndex, 0x00, static_cast<uint32_t>(host_pc.x.size()));
     // alpaka::memset(queue_, d_points.isSeed, 0x00, static_cast<uint32_t>(host_pc.x.size()));
     // alpaka::memset(queue_, (*d_hist), 0x00, static_cast<uint32_t>(NLAYERS));
-    alpaka::memset(queue_, (*d_seeds), 0x00);
+    alpaka::memset(queue_, (*d_nSeeds), 0x00, static_cast<uint32_t>(NLAYERS));
     // alpaka::memset(queue_, (*d_followers), 0x00, static_cast<uint32_t>(host_pc.x.size()));
-    const Idx blockSize = 1024;
-    Idx gridSize = std::ceil(host_pc.x.size() / static_cast<float>(blockSize));
-    auto WorkDiv1D = cms::alpakatools::make_workdiv<Acc1D>(gridSize, blockSize);
-    alpaka::enqueue(queue_,
-                    alpaka::createTaskKernel<Acc1D>(WorkDiv1D, KernelResetFollowers(), followers_, host_pc.x.size()));
-    gridSize = std::ceil(LayerTilesConstants::nRows * LayerTilesConstants::nColumns / static_cast<float>(blockSize));
-    WorkDiv1D = cms::alpakatools::make_workdiv<Acc1D>(gridSize, blockSize);
-    alpaka::enqueue(queue_, alpaka::createTaskKernel<Acc1D>(WorkDiv1D, KernelResetHist(), hist_));
   }
 
-  void CLUEAlgoAlpaka::makeClusters(PointsCloud const &host_pc, PointsCloudAlpaka &d_points, Queue queue_) {
-    setup(host_pc, d_points, queue_);
-    // calculate rho, delta and find seeds
-    // 1 point per thread
-    const Idx blockSize = 1024;
-    const Idx gridSize = ceil(host_pc.x.size() / static_cast<float>(blockSize));
-    auto WorkDiv1D = cms::alpakatools::make_workdiv<Acc1D>(gridSize, blockSize);
-    alpaka::enqueue(
-        queue_,
-        alpaka::createTaskKernel<Acc1D>(WorkDiv1D, KernelComputeHistogram(), hist_, d_points.view(), host_pc.x.size()));
-    alpaka::enqueue(queue_,
-                    alpaka::createTaskKernel<Acc1D>(
-                        WorkDiv1D, KernelCalculateDensity(), hist_, d_points.view(), dc_, host_pc.x.size()));
-    alpaka::enqueue(queue_,
-                    alpaka::createTaskKernel<Acc1D>(WorkDiv1D,
-                                                    KernelComputeDistanceToHigher(),
-                                                    hist_,
-                                                    d_points.view(),
-                                                    outlierDeltaFactor_,
-                                                    dc_,
-                                                    host_pc.x.size()));
-    alpaka::enqueue(queue_,
-                    alpaka::createTaskKernel<Acc1D>(WorkDiv1D,
-                                                    KernelFindClusters(),
-                                                    seeds_,
-                                                    followers_,
-                                                    d_points.view(),
-                                                    outlierDeltaFactor_,
-                                                    dc_,
-                                                    rhoc_,
-                                                    host_pc.x.size()));
+  void CLUEAlgoAlpaka::partitionByLayer(PointsCloud const &host_pc) {
+    // counting sort of the point indices by layer, which keeps the order of the points within a layer
+    uint32_t const nPoints = host_pc.x.size();
+    layerOffsets_.assign(NLAYERS + 1, 0);
+    for (uint32_t i = 0; i < nPoints; ++i) {
+      ++layerOffsets_[host_pc.layer[i] + 1];
+    }
+    maxLayerPoints_ = *std::max_element(layerOffsets_.begin(), layerOffsets_.end());
+    std::partial_sum(layerOffsets_.begin(), layerOffsets_.end(), layerOffsets_.begin());
+    layerPoints_.resize(nPoints);
+    std::vector<uint32_t> next(layerOffsets_.begin(), layerOffsets_.end() - 1);
+    for (uint32_t i = 0; i < nPoints; ++i) {
+      layerPoints_[next[host_pc.layer[i]]++] = i;
+    }
+  }
 
-    const Idx gridSize_seeds = ceil(maxNSeeds / static_cast<float>(blockSize));
-    auto WorkDiv1D_seeds = cms::alpakatools::make_workdiv<Acc1D>(gridSize_seeds, blockSize);
-    alpaka::enqueue(
+  void CLUEAlgoAlpaka::makeClusters(PointsCloud const &host_pc, PointsCloudAlpaka &d_points, Queue queue_) {
+    setup(queue_);
+    partitionByLayer(host_pc);
+    uint32_t const nPoints = host_pc.x.size();
+    auto const &workDiv = graph_.pointsWorkDiv(nPoints);
+    auto const &layersWorkDiv = graph_.layersWorkDiv<Acc2D>(NLAYERS, maxLayerPoints_);
+    uint32_t const *layerOffsets = (*d_layerOffsets).data();
+    uint32_t const *layerPoints = (*d_layerPoints).data();
+    int *layerSeeds = (*d_layerSeeds).data();
+    uint32_t *nSeeds = (*d_nSeeds).data();
+    int *clusterOffsets = (*d_clusterOffsets).data();
+    // copy input variables and their partition by layer, the device buffers may be larger, as they are
+    // reused across events; reset the tiles and the followers; then calculate rho, delta and find seeds,
+    // over a 2D grid of (layer, point in layer); number the clusters layer by layer and assign them
+    graph_.enqueue(
         queue_,
-        alpaka::createTaskKernel<Acc1D>(WorkDiv1D_seeds, KernelAssignClusters(), seeds_, followers_, d_points.view()));
+        alpaka::createTaskMemcpy(d_points.x, cms::alpakatools::make_host_view(host_pc.x.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(d_points.y, cms::alpakatools::make_host_view(host_pc.y.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(
+            d_points.layer, cms::alpakatools::make_host_view(host_pc.layer.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(
+            d_points.weight, cms::alpakatools::make_host_view(host_pc.weight.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(*d_layerOffsets,
+                                 cms::alpakatools::make_host_view(layerOffsets_.data(), NLAYERS + 1),
+                                 static_cast<uint32_t>(NLAYERS + 1)),
+        alpaka::createTaskMemcpy(
+            *d_layerPoints, cms::alpakatools::make_host_view(layerPoints_.data(), nPoints), nPoints),
+        graph_.kernel(workDiv, KernelResetFollowers(), followers_, nPoints),
+        graph_.kernel(histWorkDiv_, KernelResetHist(), hist_),
+        graph_.kernel<Acc2D>(
+            layersWorkDiv, KernelComputeHistogram(), hist_, d_points.view(), layerOffsets, layerPoints),
+        graph_.kernel<Acc2D>(
+            layersWorkDiv, KernelCalculateDensity(), hist_, d_points.view(), layerOffsets, layerPoints, dc_),
+        graph_.kernel<Acc2D>(layersWorkDiv,
+                             KernelComputeDistanceToHigher(),
+                             hist_,
+                             d_points.view(),
+                             layerOffsets,
+                             layerPoints,
+                             outlierDeltaFactor_,
+                             dc_),
+        graph_.kernel<Acc2D>(layersWorkDiv,
+                             KernelFindClusters(),
+                             layerSeeds,
+                             nSeeds,
+                             followers_,
+                             d_points.view(),
+                             layerOffsets,
+                             layerPoints,
+                             outlierDeltaFactor_,
+                             dc_,
+                             rhoc_,
+                             nPoints),
+        graph_.kernel(scanWorkDiv_, KernelComputeClusterOffsets(), nSeeds, clusterOffsets),
+        graph_.kernel<Acc2D>(layersWorkDiv,
+                             KernelAssignClusters(),
+                             layerSeeds,
+                             nSeeds,
+                             clusterOffsets,
+                             followers_,
+                             d_points.view(),
+                             layerOffsets));
     alpaka::wait(queue_);
   }
 }  // namespace ALPAKA_ACCELERATOR_NAMESPACE
@@ -2,7 +2,9 @@
 #define CLUEAlgo_Alpaka_h
 
 // #include <optional>
+#include <vector>
 
+#include "AlpakaCore/KernelGraph.h"
 #include "AlpakaCore/alpakaConfig.h"
 #include "AlpakaCore/alpakaMemory.h"
 #include "AlpakaDataFormats/alpaka/PointsCloudAlpaka.h"
@@ -15,7 +17,11 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     // constructor
     CLUEAlgoAlpaka() = delete;
     explicit CLUEAlgoAlpaka(float const &dc, float const &rhoc, float const &outlierDeltaFactor, Queue stream)
-        : dc_{dc}, rhoc_{rhoc}, outlierDeltaFactor_{outlierDeltaFactor} {
+        : dc_{dc},
+          rhoc_{rhoc},
+          outlierDeltaFactor_{outlierDeltaFactor},
+          histWorkDiv_{graph_.workDiv(LayerTilesConstants::nRows * LayerTilesConstants::nColumns)},
+          scanWorkDiv_{graph_.workDiv(1)} {
       init_device(stream);
     }
 
@@ -24,7 +30,6 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     void makeClusters(PointsCloud const &host_pc, PointsCloudAlpaka &d_points, Queue stream);
 
     LayerTilesAlpaka *hist_;
-    cms::alpakatools::VecArray<int, maxNSeeds> *seeds_;
     cms::alpakatools::VecArray<int, maxNFollowers> *followers_;
 
   private:
@@ -32,14 +37,33 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     float rhoc_;
     float outlierDeltaFactor_;
 
+    // the copies and kernels of each event, fused into a single task on the CPUs
+    cms::alpakatools::KernelGraph<Acc1D> graph_;
+    WorkDiv1D const histWorkDiv_;
+    WorkDiv1D const scanWorkDiv_;
+
+    // the points of the event partitioned by layer: the indices of the points
+    // of layer l are layerPoints_[layerOffsets_[l]] up to layerPoints_[layerOffsets_[l + 1]]
+    std::vector<uint32_t> layerOffsets_;
+    std::vector<uint32_t> layerPoints_;
+    uint32_t maxLayerPoints_ = 0;
+
     std::optional<cms::alpakatools::device_buffer<Device, LayerTilesAlpaka[]>> d_hist;
-    std::optional<cms::alpakatools::device_buffer<Device, cms::alpakatools::VecArray<int, maxNSeeds>>> d_seeds;
+    std::optional<cms::alpakatools::device_buffer<Device, uint32_t[]>> d_layerOffsets;
+    std::optional<cms::alpakatools::device_buffer<Device, uint32_t[]>> d_layerPoints;
+    // the seeds of layer l from d_layerSeeds[d_layerOffsets[l]], d_nSeeds[l] of them,
+    // and the index of the first cluster of each layer
+    std::optional<cms::alpakatools::device_buffer<Device, int[]>> d_layerSeeds;
+    std::optional<cms::alpakatools::device_buffer<Device, uint32_t[]>> d_nSeeds;
+    std::optional<cms::alpakatools::device_buffer<Device, int[]>> d_clusterOffsets;
     std::optional<cms::alpakatools::device_buffer<Device, cms::alpakatools::VecArray<int, maxNFollowers>[]>> d_followers;
 
     // private methods
     void init_device(Queue stream);
 
-    void setup(PointsCloud const &host_pc, PointsCloudAlpaka &d_points, Queue stream);
+    void setup(Queue stream);
+
+    void partitionByLayer(PointsCloud const &host_pc);
   };
 }  // namespace ALPAKA_ACCELERATOR_NAMESPACE
 
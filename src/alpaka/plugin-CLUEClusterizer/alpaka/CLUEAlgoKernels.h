@@ -8,6 +8,28 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
 
   using pointsView = PointsCloudAlpaka::PointsCloudAlpakaView;
 
+  /* The kernels over the points run on a 2D grid of (layer, point in layer):
+   * the points of layer l are d_layerPoints[d_layerOffsets[l]] up to
+   * d_layerPoints[d_layerOffsets[l + 1]], and the blocks along the first
+   * dimension each work on a single layer, so that the atomics into the tiles,
+   * the followers and the seeds of a layer never cross layers.
+   */
+  template <typename TAcc>
+  ALPAKA_FN_ACC uint32_t layerOfBlock(const TAcc &acc) {
+    return alpaka::getIdx<alpaka::Grid, alpaka::Blocks>(acc)[0u];
+  }
+
+  template <typename TAcc, typename Func>
+  ALPAKA_FN_ACC void for_each_point_in_layer(const TAcc &acc,
+                                             uint32_t layer,
+                                             uint32_t const *d_layerOffsets,
+                                             uint32_t const *d_layerPoints,
+                                             const Func func) {
+    const uint32_t first = d_layerOffsets[layer];
+    cms::alpakatools::for_each_element_in_grid_strided(
+        acc, d_layerOffsets[layer + 1] - first, [&](uint32_t k) { func(d_layerPoints[first + k]); }, 1u);
+  }
+
   struct KernelResetHist {
     template <typename TAcc>
     ALPAKA_FN_ACC void operator()(const TAcc &acc, LayerTilesAlpaka *d_hist) const {
@@ -33,10 +55,12 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     ALPAKA_FN_ACC void operator()(const TAcc &acc,
                                   LayerTilesAlpaka *d_hist,
                                   pointsView *d_points,
-                                  uint32_t const &numberOfPoints) const {
+                                  uint32_t const *d_layerOffsets,
+                                  uint32_t const *d_layerPoints) const {
       // push index of points into tiles
-      cms::alpakatools::for_each_element_in_grid(acc, numberOfPoints, [&](uint32_t i) {
-        d_hist[d_points->layer[i]].fill(acc, d_points->x[i], d_points->y[i], i);
+      const uint32_t layer = layerOfBlock(acc);
+      for_each_point_in_layer(acc, layer, d_layerOffsets, d_layerPoints, [&](uint32_t i) {
+        d_hist[layer].fill(acc, d_points->x[i], d_points->y[i], i);
       });
     }
   };
@@ -46,12 +70,13 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     ALPAKA_FN_ACC void operator()(const TAcc &acc,
                                   LayerTilesAlpaka *d_hist,
                                   pointsView *d_points,
-                                  float dc,
-                                  uint32_t const &numberOfPoints) const {
+                                  uint32_t const *d_layerOffsets,
+                                  uint32_t const *d_layerPoints,
+                                  float dc) const {
       const float dcSquared = dc * dc;
-      cms::alpakatools::for_each_element_in_grid(acc, numberOfPoints, [&](uint32_t i) {
+      const uint32_t layeri = layerOfBlock(acc);
+      for_each_point_in_layer(acc, layeri, d_layerOffsets, d_layerPoints, [&](uint32_t i) {
         float rhoi{0.f};
-        int layeri = d_points->layer[i];
         float xi = d_points->x[i];
         float yi = d_points->y[i];
         //get search box
@@ -86,13 +111,14 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     ALPAKA_FN_ACC void operator()(const TAcc &acc,
                                   LayerTilesAlpaka *d_hist,
                                   pointsView *d_points,
+                                  uint32_t const *d_layerOffsets,
+                                  uint32_t const *d_layerPoints,
                                   float outlierDeltaFactor,
-                                  float dc,
-                                  uint32_t const &numberOfPoints) const {
+                                  float dc) const {
       float dm = outlierDeltaFactor * dc;
       float dm_squared = dm * dm;
-      cms::alpakatools::for_each_element_in_grid(acc, numberOfPoints, [&](uint32_t i) {
-        int layeri = d_points->layer[i];
+      const uint32_t layeri = layerOfBlock(acc);
+      for_each_point_in_layer(acc, layeri, d_layerOffsets, d_layerPoints, [&](uint32_t i) {
         float deltai = std::numeric_limits<float>::max();
         int nearestHigheri = -1;
         float xi = d_points->x[i];
@@ -139,14 +165,18 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
   struct KernelFindClusters {
     template <typename TAcc>
     ALPAKA_FN_ACC void operator()(const TAcc &acc,
-                                  cms::alpakatools::VecArray<int, maxNSeeds> *d_seeds,
+                                  int *d_layerSeeds,
+                                  uint32_t *d_nSeeds,
                                   cms::alpakatools::VecArray<int, maxNFollowers> *d_followers,
                                   pointsView *d_points,
+                                  uint32_t const *d_layerOffsets,
+                                  uint32_t const *d_layerPoints,
                                   float outlierDeltaFactor,
                                   float dc,
                                   float rhoc,
                                   uint32_t const &numberOfPoints) const {
-      cms::alpakatools::for_each_element_in_grid(acc, numberOfPoints, [&](uint32_t i) {
+      const uint32_t layer = layerOfBlock(acc);
+      for_each_point_in_layer(acc, layer, d_layerOffsets, d_layerPoints, [&](uint32_t i) {
         // initialize clusterIndex
         d_points->clusterIndex[i] = -1;
         // determine seed or outlier
@@ -158,7 +188,9 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
         if (isSeed) {
           // set isSeed as 1
           d_points->isSeed[i] = 1;
-          d_seeds[0].push_back(acc, i);  // head of d_seeds
+          // the seeds of each layer follow the offset of its points
+          auto k = atomicAdd(acc, &d_nSeeds[layer], 1u, alpaka::hierarchy::Blocks{});
+          d_layerSeeds[d_layerOffsets[layer] + k] = i;
         } else {
           if (!isOutlier) {
             assert(d_points->nearestHigher[i] < static_cast<int>(numberOfPoints));
@@ -171,49 +203,73 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     }
   };
 
+  struct KernelComputeClusterOffsets {
+    template <typename TAcc>
+    ALPAKA_FN_ACC void operator()(const TAcc &acc, uint32_t const *d_nSeeds, int *d_clusterOffsets) const {
+      // exclusive scan of the number of seeds of each layer, too short to be worth more than one thread
+      cms::alpakatools::for_each_element_in_grid(acc, 1, [&](uint32_t) {
+        int offset = 0;
+        for (int layerId = 0; layerId < NLAYERS; ++layerId) {
+          d_clusterOffsets[layerId] = offset;
+          offset += d_nSeeds[layerId];
+        }
+      });
+    }
+  };
+
   struct KernelAssignClusters {
     template <typename TAcc>
     ALPAKA_FN_ACC void operator()(const TAcc &acc,
-                                  cms::alpakatools::VecArray<int, maxNSeeds> *d_seeds,
+                                  int const *d_layerSeeds,
+                                  uint32_t const *d_nSeeds,
+                                  int const *d_clusterOffsets,
                                   cms::alpakatools::VecArray<int, maxNFollowers> *d_followers,
-                                  pointsView *d_points) const {
-      const auto &seeds = d_seeds[0];
-      const auto nSeeds = seeds.size();
-      cms::alpakatools::for_each_element_in_grid(acc, nSeeds, [&](uint32_t idxCls) {
-        int localStack[localStackSizePerSeed] = {-1};
-        int localStackSize = 0;
-
-        // assign cluster to seed[idxCls]
-        int idxThisSeed = seeds[idxCls];
-        d_points->clusterIndex[idxThisSeed] = idxCls;
-        // push_back idThisSeed to localStack
-        // assert((localStackSize < localStackSizePerSeed));
-        localStack[localStackSize] = idxThisSeed;
-        localStackSize++;
-        // process all elements in localStack
-        while (localStackSize > 0) {
-          // get last element of localStack
-          // assert((localStackSize - 1 < localStackSizePerSeed));
-          int idxEndOfLocalStack = localStack[localStackSize - 1];
-          int temp_clusterIndex = d_points->clusterIndex[idxEndOfLocalStack];
-          // pop_back last element of localStack
-          // assert((localStackSize - 1 < localStackSizePerSeed));
-          localStack[localStackSize - 1] = -1;
-          localStackSize--;
-          const auto &followers = d_followers[idxEndOfLocalStack];
-          const auto followers_size = d_followers[idxEndOfLocalStack].size();
-          // loop over followers of last element of localStack
-          for (int j = 0; j < followers_size; ++j) {
-            // pass id to follower
-            int follower = followers[j];
-            d_points->clusterIndex[follower] = temp_clusterIndex;
-            // push_back follower to localStack
+                                  pointsView *d_points,
+                                  uint32_t const *d_layerOffsets) const {
+      // one seed per element along the second dimension of the (layer, point in layer) grid
+      const uint32_t layer = layerOfBlock(acc);
+      const int *seeds = d_layerSeeds + d_layerOffsets[layer];
+      const int firstCls = d_clusterOffsets[layer];
+      cms::alpakatools::for_each_element_in_grid_strided(
+          acc,
+          d_nSeeds[layer],
+          [&](uint32_t k) {
+            int localStack[localStackSizePerSeed] = {-1};
+            int localStackSize = 0;
+
+            // assign cluster to the k-th seed of the layer
+            int idxCls = firstCls + k;
+            int idxThisSeed = seeds[k];
+            d_points->clusterIndex[idxThisSeed] = idxCls;
+            // push_back idThisSeed to localStack
             // assert((localStackSize < localStackSizePerSeed));
-            localStack[localStackSize] = follower;
+            localStack[localStackSize] = idxThisSeed;
             localStackSize++;
-          }
-        }
-      });
+            // process all elements in localStack
+            while (localStackSize > 0) {
+              // get last element of localStack
+              // assert((localStackSize - 1 < localStackSizePerSeed));
+              int idxEndOfLocalStack = localStack[localStackSize - 1];
+              int temp_clusterIndex = d_points->clusterIndex[idxEndOfLocalStack];
+              // pop_back last element of localStack
+              // assert((localStackSize - 1 < localStackSizePerSeed));
+              localStack[localStackSize - 1] = -1;
+              localStackSize--;
+              const auto &followers = d_followers[idxEndOfLocalStack];
+              const auto followers_size = d_followers[idxEndOfLocalStack].size();
+              // loop over followers of last element of localStack
+              for (int j = 0; j < followers_size; ++j) {
+                // pass id to follower
+                int follower = followers[j];
+                d_points->clusterIndex[follower] = temp_clusterIndex;
+                // push_back follower to localStack
+                // assert((localStackSize < localStackSizePerSeed));
+                localStack[localStackSize] = follower;
+                localStackSize++;
+              }
+            }
+          },
+          1u);
     }
   };
 }  // namespace ALPAKA_ACCELERATOR_NAMESPACE
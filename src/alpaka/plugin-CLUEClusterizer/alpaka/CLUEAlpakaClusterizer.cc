@@ -24,6 +24,7 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
 
     edm::EDGetTokenT<PointsCloud> pointsCloudToken_;
     edm::EDPutTokenT<cms::alpakatools::Product<Queue, PointsCloudAlpaka>> clusterToken_;
+    PointsCloudAlpaka::Pool pool_;
     std::unique_ptr<CLUEAlgoAlpaka> clueAlgo;
   };
 
@@ -36,7 +37,7 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     cms::alpakatools::ScopedContextProduce<Queue> ctx(event.streamID());
     Parameters const& par = eventSetup.get<Parameters>();
     auto stream = ctx.stream();
-    PointsCloudAlpaka d_points(stream, pc.x.size());
+    PointsCloudAlpaka d_points(stream, pc.x.size(), pool_);
     if (!clueAlgo)
       clueAlgo = std::make_unique<CLUEAlgoAlpaka>(par.dc, par.rhoc, par.outlierDeltaFactor, stream);
     clueAlgo->makeClusters(pc, d_points, stream);
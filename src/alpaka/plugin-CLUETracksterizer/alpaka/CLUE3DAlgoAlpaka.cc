@@ -20,22 +20,7 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     followers_ = (*d_followers).data();
   }
 
-  void CLUE3DAlgoAlpaka::setup(ClusterCollection const &host_pc, ClusterCollectionAlpaka &d_clusters, Queue queue_) {
-    // copy input variables
-    alpaka::memcpy(queue_, d_clusters.x, cms::alpakatools::make_host_view(host_pc.x.data(), host_pc.x.size()));
-    alpaka::memcpy(queue_, d_clusters.y, cms::alpakatools::make_host_view(host_pc.y.data(), host_pc.x.size()));
-    alpaka::memcpy(queue_, d_clusters.z, cms::alpakatools::make_host_view(host_pc.z.data(), host_pc.x.size()));
-    alpaka::memcpy(queue_, d_clusters.eta, cms::alpakatools::make_host_view(host_pc.eta.data(), host_pc.x.size()));
-    alpaka::memcpy(queue_, d_clusters.phi, cms::alpakatools::make_host_view(host_pc.phi.data(), host_pc.x.size()));
-    alpaka::memcpy(
-        queue_, d_clusters.r_over_absz, cms::alpakatools::make_host_view(host_pc.r_over_absz.data(), host_pc.x.size()));
-    alpaka::memcpy(
-        queue_, d_clusters.radius, cms::alpakatools::make_host_view(host_pc.radius.data(), host_pc.x.size()));
-    alpaka::memcpy(queue_, d_clusters.layer, cms::alpakatools::make_host_view(host_pc.layer.data(), host_pc.x.size()));
-    alpaka::memcpy(
-        queue_, d_clusters.energy, cms::alpakatools::make_host_view(host_pc.energy.data(), host_pc.x.size()));
-    alpaka::memcpy(
-        queue_, d_clusters.isSilicon, cms::alpakatools::make_host_view(host_pc.isSilicon.data(), host_pc.x.size()));
+  void CLUE3DAlgoAlpaka::setup(Queue queue_) {
     // initialize result and internal variables
     // alpaka::memset(queue_, d_clusters.rho, 0x00, static_cast<uint32_t>(host_pc.x.size()));
     // alpaka::memset(queue_, d_clusters.delta, 0x00, static_cast<uint32_t>(host_pc.x.size()));
@@ -45,45 +30,42 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     // alpaka::memset(queue_, (*d_hist), 0x00, static_cast<uint32_t>(ticl::TileConstants::nLayers));
     alpaka::memset(queue_, (*d_seeds), 0x00);
     // alpaka::memset(queue_, (*d_followers), 0x00, static_cast<uint32_t>(host_pc.x.size()));
-    const Idx blockSize = 1024;
-    Idx gridSize = std::ceil(host_pc.x.size() / static_cast<float>(blockSize));
-    auto WorkDiv1D = cms::alpakatools::make_workdiv<Acc1D>(gridSize, blockSize);
-
-    alpaka::enqueue(queue_,
-                    alpaka::createTaskKernel<Acc1D>(WorkDiv1D, KernelResetFollowers(), followers_, host_pc.x.size()));
-
-    gridSize = std::ceil(ticl::TileConstants::nBins / static_cast<float>(blockSize));
-    WorkDiv1D = cms::alpakatools::make_workdiv<Acc1D>(gridSize, blockSize);
-    alpaka::enqueue(queue_, alpaka::createTaskKernel<Acc1D>(WorkDiv1D, KernelResetHist(), hist_));
   }
 
   void CLUE3DAlgoAlpaka::makeTracksters(ClusterCollection const &host_pc,
                                         ClusterCollectionAlpaka &d_clusters,
                                         Queue queue_) {
-    setup(host_pc, d_clusters, queue_);
-    // calculate rho, delta and find seeds
-    // 1 point per thread
-    const Idx blockSize = 1024;
-    const Idx gridSize = ceil(host_pc.x.size() / static_cast<float>(blockSize));
-    auto WorkDiv1D = cms::alpakatools::make_workdiv<Acc1D>(gridSize, blockSize);
-    alpaka::enqueue(queue_,
-                    alpaka::createTaskKernel<Acc1D>(
-                        WorkDiv1D, KernelComputeHistogram(), hist_, d_clusters.view(), host_pc.x.size()));
-    alpaka::enqueue(queue_,
-                    alpaka::createTaskKernel<Acc1D>(
-                        WorkDiv1D, KernelCalculateDensity(), hist_, d_clusters.view(), host_pc.x.size()));
-    alpaka::enqueue(queue_,
-                    alpaka::createTaskKernel<Acc1D>(
-                        WorkDiv1D, KernelComputeDistanceToHigher(), hist_, d_clusters.view(), host_pc.x.size()));
-    alpaka::enqueue(queue_,
-                    alpaka::createTaskKernel<Acc1D>(
-                        WorkDiv1D, KernelFindClusters(), seeds_, followers_, d_clusters.view(), host_pc.x.size()));
-
-    const Idx gridSize_seeds = ceil(ticl::maxNSeeds / static_cast<float>(blockSize));
-    auto WorkDiv1D_seeds = cms::alpakatools::make_workdiv<Acc1D>(gridSize_seeds, blockSize);
-    alpaka::enqueue(queue_,
-                    alpaka::createTaskKernel<Acc1D>(
-                        WorkDiv1D_seeds, KernelAssignClusters(), seeds_, followers_, d_clusters.view()));
+    setup(queue_);
+    uint32_t const nPoints = host_pc.x.size();
+    auto const &workDiv = graph_.pointsWorkDiv(nPoints);
+    // copy input variables, the device buffers may be larger, as they are reused across events;
+    // reset the tiles and the followers; then calculate rho, delta and find seeds, 1 point per thread
+    graph_.enqueue(
+        queue_,
+        alpaka::createTaskMemcpy(d_clusters.x, cms::alpakatools::make_host_view(host_pc.x.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(d_clusters.y, cms::alpakatools::make_host_view(host_pc.y.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(d_clusters.z, cms::alpakatools::make_host_view(host_pc.z.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(
+            d_clusters.eta, cms::alpakatools::make_host_view(host_pc.eta.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(
+            d_clusters.phi, cms::alpakatools::make_host_view(host_pc.phi.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(
+            d_clusters.r_over_absz, cms::alpakatools::make_host_view(host_pc.r_over_absz.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(
+            d_clusters.radius, cms::alpakatools::make_host_view(host_pc.radius.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(
+            d_clusters.layer, cms::alpakatools::make_host_view(host_pc.layer.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(
+            d_clusters.energy, cms::alpakatools::make_host_view(host_pc.energy.data(), nPoints), nPoints),
+        alpaka::createTaskMemcpy(
+            d_clusters.isSilicon, cms::alpakatools::make_host_view(host_pc.isSilicon.data(), nPoints), nPoints),
+        graph_.kernel(workDiv, KernelResetFollowers(), followers_, nPoints),
+        graph_.kernel(histWorkDiv_, KernelResetHist(), hist_),
+        graph_.kernel(workDiv, KernelComputeHistogram(), hist_, d_clusters.view(), nPoints),
+        graph_.kernel(workDiv, KernelCalculateDensity(), hist_, d_clusters.view(), nPoints),
+        graph_.kernel(workDiv, KernelComputeDistanceToHigher(), hist_, d_clusters.view(), nPoints),
+        graph_.kernel(workDiv, KernelFindClusters(), seeds_, followers_, d_clusters.view(), nPoints),
+        graph_.kernel(seedsWorkDiv_, KernelAssignClusters(), seeds_, followers_, d_clusters.view()));
 
     // To validate the number of Tracksters
     // auto WorkDivPrint = cms::alpakatools::make_workdiv<Acc1D>(1, 1);
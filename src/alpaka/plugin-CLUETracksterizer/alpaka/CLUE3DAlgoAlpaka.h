@@ -1,6 +1,7 @@
 #ifndef CLUE3DAlgo_Alpaka_h
 #define CLUE3DAlgo_Alpaka_h
 
+#include "AlpakaCore/KernelGraph.h"
 #include "AlpakaCore/alpakaConfig.h"
 #include "AlpakaCore/alpakaMemory.h"
 #include "AlpakaDataFormats/alpaka/ClusterCollectionAlpaka.h"
@@ -13,7 +14,10 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
   public:
     // constructor
     CLUE3DAlgoAlpaka() = delete;
-    explicit CLUE3DAlgoAlpaka(Queue stream) { init_device(stream); }
+    explicit CLUE3DAlgoAlpaka(Queue stream)
+        : histWorkDiv_{graph_.workDiv(ticl::TileConstants::nBins)}, seedsWorkDiv_{graph_.workDiv(ticl::maxNSeeds)} {
+      init_device(stream);
+    }
 
     ~CLUE3DAlgoAlpaka() = default;
 
@@ -24,6 +28,11 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     cms::alpakatools::VecArray<int, ticl::maxNFollowers> *followers_;
 
   private:
+    // the copies and kernels of each event, fused into a single task on the CPUs
+    cms::alpakatools::KernelGraph<Acc1D> graph_;
+    WorkDiv1D const histWorkDiv_;
+    WorkDiv1D const seedsWorkDiv_;
+
     std::optional<cms::alpakatools::device_buffer<Device, TICLLayerTilesAlpaka[]>> d_hist;
     std::optional<cms::alpakatools::device_buffer<Device, cms::alpakatools::VecArray<int, ticl::maxNSeeds>>> d_seeds;
     std::optional<cms::alpakatools::device_buffer<Device, cms::alpakatools::VecArray<int, ticl::maxNFollowers>[]>>
@@ -31,7 +40,7 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
 
     void init_device(Queue stream);
 
-    void setup(ClusterCollection const &host_pc, ClusterCollectionAlpaka &d_clusters, Queue stream);
+    void setup(Queue stream);
   };
 }  // namespace ALPAKA_ACCELERATOR_NAMESPACE
 
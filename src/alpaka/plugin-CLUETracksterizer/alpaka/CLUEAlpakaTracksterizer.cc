@@ -22,6 +22,7 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
 
     edm::EDGetTokenT<ClusterCollection> clusterCollectionToken_;
     edm::EDPutTokenT<cms::alpakatools::Product<Queue, ClusterCollectionAlpaka>> tracksterToken_;
+    ClusterCollectionAlpaka::Pool pool_;
     std::unique_ptr<CLUE3DAlgoAlpaka> algo_;
   };
 
@@ -33,7 +34,7 @@ namespace ALPAKA_ACCELERATOR_NAMESPACE {
     auto const& pc = event.get(clusterCollectionToken_);
     cms::alpakatools::ScopedContextProduce<Queue> ctx(event.streamID());
     auto stream = ctx.stream();
-    ClusterCollectionAlpaka d_clusters(stream, pc.x.size());
+    ClusterCollectionAlpaka d_clusters(stream, pc.x.size(), pool_);
     if (!algo_)
       algo_ = std::make_unique<CLUE3DAlgoAlpaka>(stream);
     algo_->makeTracksters(pc, d_clusters, stream);
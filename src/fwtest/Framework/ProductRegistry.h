@@ -1,12 +1,13 @@
 #ifndef ProductRegistry_h
 #define ProductRegistry_h
 
+#include <map>
 #include <memory>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <typeindex>
-#include <unordered_map>
+#include <utility>
 
 #include "Framework/EDGetToken.h"
 #include "Framework/EDPutToken.h"
@@ -18,23 +19,24 @@ namespace edm {
 
     ProductRegistry() = default;
 
-    // public interface
+    // public interface; the label tells apart several products of the same type
     template <typename T>
-    EDPutTokenT<T> produces() {
-      const std::type_index ti{typeid(T)};
+    EDPutTokenT<T> produces(std::string const& label = "") {
       const unsigned int ind = typeToIndex_.size();
-      auto succeeded = typeToIndex_.try_emplace(ti, currentModuleIndex_, ind);
+      auto succeeded = typeToIndex_.try_emplace(Key{typeid(T), label}, currentModuleIndex_, ind);
       if (not succeeded.second) {
-        throw std::runtime_error(std::string("Product of type ") + typeid(T).name() + " already exists");
+        throw std::runtime_error(std::string("Product of type ") + typeid(T).name() + " and label '" + label +
+                                 "' already exists");
       }
       return EDPutTokenT<T>{ind};
     }
 
     template <typename T>
-    EDGetTokenT<T> consumes() {
-      const auto found = typeToIndex_.find(std::type_index(typeid(T)));
+    EDGetTokenT<T> consumes(std::string const& label = "") {
+      const auto found = typeToIndex_.find(Key{typeid(T), label});
       if (found == typeToIndex_.end()) {
-        throw std::runtime_error(std::string("Product of type ") + typeid(T).name() + " is not produced");
+        throw std::runtime_error(std::string("Product of type ") + typeid(T).name() + " and label '" + label +
+                                 "' is not produced");
       }
       consumedModules_.insert(found->second.moduleIndex());
       return EDGetTokenT<T>{found->second.productIndex()};
@@ -51,6 +53,8 @@ namespace edm {
     std::set<unsigned> const& consumedModules() { return consumedModules_; }
 
   private:
+    using Key = std::pair<std::type_index, std::string>;
+
     class Indices {
     public:
       explicit Indices(unsigned int mi, unsigned int pi) : moduleIndex_(mi), productIndex_(pi) {}
@@ -66,7 +70,7 @@ namespace edm {
     unsigned int currentModuleIndex_ = kSourceIndex;
     std::set<unsigned int> consumedModules_;
 
-    std::unordered_map<std::type_index, Indices> typeToIndex_;
+    std::map<Key, Indices> typeToIndex_;
   };
 }  // namespace edm
 
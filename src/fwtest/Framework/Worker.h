@@ -2,6 +2,7 @@
 #define Worker_h
 
 #include <atomic>
+#include <utility>
 #include <vector>
 //#include <iostream>
 
@@ -48,7 +49,9 @@ namespace edm {
   template <typename T>
   class WorkerT : public Worker {
   public:
-    explicit WorkerT(ProductRegistry& reg) : producer_(reg) {}
+    // the extra arguments are passed to the constructor of the module
+    template <typename... Args>
+    explicit WorkerT(ProductRegistry& reg, Args&&... args) : producer_(reg, std::forward<Args>(args)...) {}
 
     void doWorkAsync(Event& event, EventSetup const& eventSetup, WaitingTaskHolder task) override {
       waitingTasksWork_.add(task);
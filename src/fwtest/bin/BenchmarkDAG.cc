@@ -0,0 +1,55 @@
+#include <string>
+
+#include "Framework/EDProducer.h"
+#include "Framework/Event.h"
+#include "Framework/Worker.h"
+
+#include "BenchmarkDAG.h"
+
+namespace {
+  struct BenchmarkProduct {
+    unsigned int value;
+  };
+
+  std::string label(int layer, int index) { return std::to_string(layer) + "_" + std::to_string(index); }
+
+  class BenchmarkProducer : public edm::EDProducer {
+  public:
+    explicit BenchmarkProducer(edm::ProductRegistry& reg, edm::BenchmarkDAG const& dag, int layer, int index)
+        : putToken_(reg.produces<BenchmarkProduct>(label(layer, index))) {
+      if (layer > 0) {
+        // spread the inputs over the previous layer, without repetitions
+        for (int i = 0; i < dag.fanIn; ++i) {
+          getTokens_.push_back(reg.consumes<BenchmarkProduct>(label(layer - 1, (index + i) % dag.width)));
+        }
+      }
+    }
+
+  private:
+    void produce(edm::Event& event, edm::EventSetup const& eventSetup) override {
+      unsigned int value = 1;
+      for (auto const& token : getTokens_) {
+        value += event.get(token).value;
+      }
+      event.emplace(putToken_, BenchmarkProduct{value});
+    }
+
+    std::vector<edm::EDGetTokenT<BenchmarkProduct>> getTokens_;
+    edm::EDPutTokenT<BenchmarkProduct> putToken_;
+  };
+}  // namespace
+
+namespace edm {
+  std::vector<StreamSchedule::WorkerMaker> BenchmarkDAG::makers() const {
+    std::vector<StreamSchedule::WorkerMaker> makers;
+    makers.reserve(modules());
+    for (int layer = 0; layer < depth; ++layer) {
+      for (int index = 0; index < width; ++index) {
+        makers.emplace_back([dag = *this, layer, index](ProductRegistry& reg) {
+          return std::make_unique<WorkerT<BenchmarkProducer>>(reg, dag, layer, index);
+        });
+      }
+    }
+    return makers;
+  }
+}  // namespace edm
@@ -0,0 +1,25 @@
+#ifndef BenchmarkDAG_h
+#define BenchmarkDAG_h
+
+#include <vector>
+
+#include "StreamSchedule.h"
+
+namespace edm {
+  // Trivial modules arranged in depth layers of width modules each; every
+  // module past the first layer consumes the products of fanIn modules of
+  // the previous one, so that the time per event is dominated by the
+  // scheduling of the modules instead of their work
+  struct BenchmarkDAG {
+    int width = 4;
+    int depth = 4;
+    int fanIn = 2;
+
+    int modules() const { return width * depth; }
+
+    // in layer order, so that each module follows those it consumes
+    std::vector<StreamSchedule::WorkerMaker> makers() const;
+  };
+}  // namespace edm
+
+#endif
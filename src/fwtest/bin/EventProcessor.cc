@@ -25,6 +25,14 @@ namespace edm {
     }
   }
 
+  EventProcessor::EventProcessor(int maxEvents, int numberOfStreams, BenchmarkDAG const& dag)
+      : source_(maxEvents, registry_) {
+    auto const path = dag.makers();
+    for (int i = 0; i < numberOfStreams; ++i) {
+      schedules_.emplace_back(registry_, &source_, &eventSetup_, i, path);
+    }
+  }
+
   void EventProcessor::runToCompletion() {
     source_.startProcessing();
     // The task that waits for all other work
@@ -7,6 +7,7 @@
 
 #include "Framework/EventSetup.h"
 
+#include "BenchmarkDAG.h"
 #include "PluginManager.h"
 #include "StreamSchedule.h"
 #include "Source.h"
@@ -21,6 +22,8 @@ namespace edm {
                             std::vector<std::string> const& esproducers,
                             std::filesystem::path const& datadir,
                             bool validation);
+    // runs the trivial modules of dag on empty events
+    explicit EventProcessor(int maxEvents, int numberOfStreams, BenchmarkDAG const& dag);
 
     int maxEvents() const { return source_.maxEvents(); }
     int processedEvents() const { return source_.processedEvents(); }
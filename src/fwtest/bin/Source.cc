@@ -83,6 +83,12 @@ namespace edm {
     }
   }
 
+  Source::Source(int maxEvents, ProductRegistry &reg)
+      : maxEvents_(maxEvents),
+        runForMinutes_(-1),
+        rawToken_(reg.produces<FEDRawDataCollection>()),
+        validation_(false) {}
+
   void Source::startProcessing() {
     if (runForMinutes_ >= 0) {
       startTime_ = std::chrono::steady_clock::now();
@@ -120,6 +126,9 @@ namespace edm {
       }
     }
     auto ev = std::make_unique<Event>(streamId, iev, reg);
+    if (raw_.empty()) {
+      return ev;
+    }
     const int index = old % raw_.size();
 
     ev->emplace(rawToken_, raw_[index]);
@@ -19,6 +19,8 @@ namespace edm {
   public:
     explicit Source(
         int maxEvents, int runForMinutes, ProductRegistry& reg, std::filesystem::path const& datadir, bool validation);
+    // empty events, without reading any input, for the framework benchmark
+    explicit Source(int maxEvents, ProductRegistry& reg);
 
     void startProcessing();
 
@@ -11,6 +11,21 @@
 #include "Source.h"
 #include "StreamSchedule.h"
 
+namespace {
+  std::vector<edm::StreamSchedule::WorkerMaker> pluginMakers(edmplugin::PluginManager& pluginManager,
+                                                             std::vector<std::string> const& path) {
+    std::vector<edm::StreamSchedule::WorkerMaker> makers;
+    makers.reserve(path.size());
+    for (auto const& name : path) {
+      makers.emplace_back([&pluginManager, name](edm::ProductRegistry& reg) {
+        pluginManager.load(name);
+        return edm::PluginFactory::create(name, reg);
+      });
+    }
+    return makers;
+  }
+}  // namespace
+
 namespace edm {
   StreamSchedule::StreamSchedule(ProductRegistry reg,
                                  edmplugin::PluginManager& pluginManager,
@@ -18,13 +33,19 @@ namespace edm {
                                  EventSetup const* eventSetup,
                                  int streamId,
                                  std::vector<std::string> const& path)
+      : StreamSchedule(std::move(reg), source, eventSetup, streamId, pluginMakers(pluginManager, path)) {}
+
+  StreamSchedule::StreamSchedule(ProductRegistry reg,
+                                 Source* source,
+                                 EventSetup const* eventSetup,
+                                 int streamId,
+                                 std::vector<WorkerMaker> const& path)
       : registry_(std::move(reg)), source_(source), eventSetup_(eventSetup), streamId_(streamId) {
     path_.reserve(path.size());
     int modInd = 1;
-    for (auto const& name : path) {
-      pluginManager.load(name);
+    for (auto const& maker : path) {
       registry_.beginModuleConstruction(modInd);
-      path_.emplace_back(PluginFactory::create(name, registry_));
+      path_.emplace_back(maker(registry_));
       //std::cout << "module " << modInd << " " << path_.back().get() << std::endl;
       std::vector<Worker*> consumes;
       for (unsigned int depInd : registry_.consumedModules()) {
@@ -44,18 +65,12 @@ namespace edm {
 
   void StreamSchedule::runToCompletionAsync(WaitingTaskHolder h) {
     auto task = make_functor_task([this, h]() mutable { processOneEventAsync(std::move(h)); });
-    if (streamId_ == 0) {
-      h.group()->run([task]() {
-        TaskSentry s{task};
-        task->execute();
-      });
-    } else {
-      tbb::task_arena arena{tbb::task_arena::attach()};
-      arena.enqueue([task]() {
-        TaskSentry s{task};
-        task->execute();
-      });
-    }
+    // all the streams start in the task group, so that waiting for the group
+    // waits for all of them; the idle threads steal them from there
+    h.group()->run([task]() {
+      TaskSentry s{task};
+      task->execute();
+    });
   }
 
   void StreamSchedule::processOneEventAsync(WaitingTaskHolder h) {
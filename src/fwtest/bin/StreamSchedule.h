@@ -1,6 +1,7 @@
 #ifndef StreamSchedule_h
 #define StreamSchedule_h
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -20,6 +21,9 @@ namespace edm {
   // Schedule of modules per stream (concurrent event)
   class StreamSchedule {
   public:
+    // constructs one module of the path, registering its products
+    using WorkerMaker = std::function<std::unique_ptr<Worker>(ProductRegistry&)>;
+
     // copy ProductRegistry per stream
     explicit StreamSchedule(ProductRegistry reg,
                             edmplugin::PluginManager& pluginManager,
@@ -27,6 +31,12 @@ namespace edm {
                             EventSetup const* eventSetup,
                             int streamId,
                             std::vector<std::string> const& path);
+    // for modules that are not plugins, e.g. the benchmark ones
+    explicit StreamSchedule(ProductRegistry reg,
+                            Source* source,
+                            EventSetup const* eventSetup,
+                            int streamId,
+                            std::vector<WorkerMaker> const& path);
     ~StreamSchedule();
     StreamSchedule(StreamSchedule const&) = delete;
     StreamSchedule& operator=(StreamSchedule const&) = delete;
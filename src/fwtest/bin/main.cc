@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
 #include <filesystem>
@@ -18,7 +19,7 @@ namespace {
     std::cout
         << name
         << ": [--numberOfThreads NT] [--numberOfStreams NS] [--maxEvents ME] [--data PATH] [--transfer] [--validation] "
-           "[--empty]\n\n"
+           "[--empty] [--benchmark] [--dagWidth W] [--dagDepth D] [--dagFanIn F]\n\n"
         << "Options\n"
         << " --numberOfThreads   Number of threads to use (default 1, use 0 to use all CPU cores)\n"
         << " --numberOfStreams   Number of concurrent events (default 0 = numberOfThreads)\n"
@@ -29,8 +30,70 @@ namespace {
         << " --transfer          Transfer results from GPU to CPU (default is to leave them on GPU)\n"
         << " --validation        Run (rudimentary) validation at the end (implies --transfer)\n"
         << " --empty             Ignore all producers (for testing only)\n"
+        << " --benchmark         Measure the overhead of the framework: run a DAG of trivial modules on empty events "
+           "with 1, 2, 4, ... up to NT threads (ignores --data, --transfer, --validation and --empty; --maxEvents "
+           "defaults to 100000)\n"
+        << " --dagWidth          Number of modules in each layer of the benchmark DAG (default 4)\n"
+        << " --dagDepth          Number of layers of the benchmark DAG (default 4)\n"
+        << " --dagFanIn          Number of modules of the previous layer consumed by each module of the benchmark DAG "
+           "(default 2)\n"
         << std::endl;
   }
+
+  struct Measurement {
+    int events;
+    double time;
+    double cpu;
+  };
+
+  Measurement measure(int maxEvents, int numberOfStreams, int numberOfThreads, edm::BenchmarkDAG const& dag) {
+    edm::EventProcessor processor(maxEvents, numberOfStreams, dag);
+    tbb::global_control tbb_max_threads{tbb::global_control::max_allowed_parallelism,
+                                        static_cast<std::size_t>(numberOfThreads)};
+    auto cpu_start = PosixClockGettime<CLOCK_PROCESS_CPUTIME_ID>::now();
+    auto start = std::chrono::high_resolution_clock::now();
+    tbb::task_arena arena(numberOfThreads);
+    arena.execute([&] { processor.runToCompletion(); });
+    auto cpu_stop = PosixClockGettime<CLOCK_PROCESS_CPUTIME_ID>::now();
+    auto stop = std::chrono::high_resolution_clock::now();
+    processor.endJob();
+    return {processor.processedEvents(),
+            std::chrono::duration<double>(stop - start).count(),
+            std::chrono::duration<double>(cpu_stop - cpu_start).count()};
+  }
+
+  // Runs the DAG, and the same number of empty events with no module, for
+  // each number of threads, and reports the CPU time per event of both; the
+  // CPU time per module is the difference of the two divided by the number
+  // of modules, only when the DAG costs measurably more than the empty events
+  void runBenchmark(int maxEvents, int numberOfStreams, int maxThreads, edm::BenchmarkDAG const& dag) {
+    edm::BenchmarkDAG const empty{0, 0, 0};
+    std::cout << "Benchmark of " << dag.depth << " layers of " << dag.width << " modules with fan-in " << dag.fanIn
+              << ", " << maxEvents << " events\n"
+              << " threads  streams    events/s  empty events/s  CPU us/event  empty CPU us/event  CPU ns/module"
+              << std::endl;
+    for (int threads = 1;; threads = std::min(2 * threads, maxThreads)) {
+      int const streams = numberOfStreams > 0 ? numberOfStreams : threads;
+      auto const base = measure(maxEvents, streams, threads, empty);
+      auto const full = measure(maxEvents, streams, threads, dag);
+      double const perEmptyEvent = base.cpu / base.events;
+      double const perEvent = full.cpu / full.events;
+      std::cout << std::setw(8) << threads << std::setw(9) << streams << std::fixed << std::setprecision(0)
+                << std::setw(12) << full.events / full.time << std::setw(16) << base.events / base.time
+                << std::setprecision(2) << std::setw(14) << perEvent * 1e6 << std::setw(20) << perEmptyEvent * 1e6
+                << std::setprecision(1) << std::setw(15);
+      if (perEvent > perEmptyEvent) {
+        std::cout << (perEvent - perEmptyEvent) / dag.modules() * 1e9;
+      } else {
+        // within the noise of the empty events
+        std::cout << "-";
+      }
+      std::cout << std::defaultfloat << std::endl;
+      if (threads == maxThreads) {
+        break;
+      }
+    }
+  }
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -44,6 +107,8 @@ int main(int argc, char** argv) {
   bool transfer = false;
   bool validation = false;
   bool empty = false;
+  bool benchmark = false;
+  edm::BenchmarkDAG dag;
   for (auto i = args.begin() + 1, e = args.end(); i != e; ++i) {
     if (*i == "-h" or *i == "--help") {
       print_help(args.front());
@@ -70,6 +135,17 @@ int main(int argc, char** argv) {
       validation = true;
     } else if (*i == "--empty") {
       empty = true;
+    } else if (*i == "--benchmark") {
+      benchmark = true;
+    } else if (*i == "--dagWidth") {
+      ++i;
+      dag.width = std::stoi(*i);
+    } else if (*i == "--dagDepth") {
+      ++i;
+      dag.depth = std::stoi(*i);
+    } else if (*i == "--dagFanIn") {
+      ++i;
+      dag.fanIn = std::stoi(*i);
     } else {
       std::cout << "Invalid parameter " << *i << std::endl << std::endl;
       print_help(args.front());
@@ -83,6 +159,25 @@ int main(int argc, char** argv) {
   if (numberOfThreads == 0) {
     numberOfThreads = tbb::info::default_concurrency();
   }
+  if (benchmark) {
+    if (runForMinutes >= 0) {
+      std::cout << "--runForMinutes is not supported with --benchmark, use --maxEvents" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (dag.width < 1 or dag.depth < 1 or dag.fanIn < 0 or dag.fanIn > dag.width) {
+      std::cout << "The benchmark DAG needs a width and a depth of at least 1, and a fan-in between 0 and the width"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    try {
+      runBenchmark(maxEvents >= 0 ? maxEvents : 100000, numberOfStreams, numberOfThreads, dag);
+    } catch (std::exception& e) {
+      std::cout << "\n----------\nCaught std::exception" << std::endl;
+      std::cout << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
   if (numberOfStreams == 0) {
     numberOfStreams = numberOfThreads;
   }
@@ -0,0 +1,88 @@
+#ifndef CLUE3D_CONFIG_H
+#define CLUE3D_CONFIG_H
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "DataFormats/DensityKernels.h"
+
+// Order in which CLUE3D computes the densities: cluster by cluster over its
+// sibling layers, by blocks of (layer, sibling layer) pairs, or by the same
+// blocks with the layers processed in parallel. All of them give the same
+// densities, bit by bit.
+enum class DensitySchedule { Cluster, Blocked, Parallel };
+
+// throws std::invalid_argument for anything but "cluster", "blocked" or "parallel"
+inline DensitySchedule parseDensitySchedule(std::string const& name) {
+  if (name == "cluster") {
+    return DensitySchedule::Cluster;
+  } else if (name == "blocked") {
+    return DensitySchedule::Blocked;
+  } else if (name == "parallel") {
+    return DensitySchedule::Parallel;
+  }
+  throw std::invalid_argument("Invalid density schedule '" + name + "', use 'cluster', 'blocked' or 'parallel'");
+}
+
+inline char const* densityScheduleName(DensitySchedule schedule) {
+  switch (schedule) {
+    case DensitySchedule::Cluster:
+      return "cluster";
+    case DensitySchedule::Parallel:
+      return "parallel";
+    default:
+      return "blocked";
+  }
+}
+
+struct Parameters3D {
+  DensitySchedule densitySchedule = DensitySchedule::Blocked;
+  // fixed point density sums, independent of the order of the neighbours
+  bool reproducible = false;
+  // walk the sibling layers once for the density and the nearest higher,
+  // unless there are more than this many pairs (0 walks them twice); the
+  // density schedule is then not used
+  std::size_t neighbourListSize = 0;
+  // profile of the contribution of the neighbours on the other layers to
+  // the density, and its scale in cm
+  densitykernels::Kernel kernel = densitykernels::Kernel::Flat;
+  float scale = 1.f;
+};
+
+// The optional config file of CLUE3D holds one line
+//   densitySchedule[,reproducible[,neighbourListSize[,kernel[,scale]]]]
+// where kernel is flat, gaussian or exponential, and the defaults are used
+// without a file
+inline Parameters3D readParameters3D(std::filesystem::path const& configFile) {
+  Parameters3D par;
+  std::ifstream iFile(configFile);
+  std::string line;
+  while (getline(iFile, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string value;
+    getline(fields, value, ',');
+    par.densitySchedule = parseDensitySchedule(value);
+    if (getline(fields, value, ',')) {
+      par.reproducible = static_cast<bool>(std::stoi(value));
+    }
+    if (getline(fields, value, ',')) {
+      par.neighbourListSize = std::stoul(value);
+    }
+    if (getline(fields, value, ',')) {
+      par.kernel = densitykernels::parseKernel(value);
+    }
+    if (getline(fields, value, ',')) {
+      par.scale = std::stof(value);
+    }
+  }
+  return par;
+}
+
+#endif
@@ -3,15 +3,93 @@
 
 #include <vector>
 #include <filesystem>
+#include <fstream>
 #include <regex>
+#include <sstream>
+#include <string>
+
+#include "DataFormats/DensityKernels.h"
 
 struct Parameters {
   float dc = 20.;
   float rhoc = 25.;
   float outlierDeltaFactor = 2.;
   bool produceOutput = false;
+  // approximate density from the tile weight sums, computed exactly only
+  // for the points whose estimate is within refineMargin * rhoc of rhoc
+  bool approximate = false;
+  float refineMargin = 0.25;
+  // feed the points of each event to an incremental clustering in this
+  // many slices of consecutive layers, as an online readout would
+  int slices = 0;
+  // profile of the density contributions of the neighbours within dc,
+  // and its width (dc / 2 when not given)
+  densitykernels::Kernel densityKernel = densitykernels::Kernel::Flat;
+  float kernelScale = 0.f;
+  // fixed point density sums, independent of the order of the neighbours
+  bool reproducible = false;
+  // enumerate the neighbours once for the density and the nearest higher,
+  // unless there are more than this many pairs (0 walks the tiles twice)
+  std::size_t neighbourListSize = 0;
+  // y periodic over the range of the tiles, e.g. the r * phi of a
+  // cylindrical detector slice (exact clustering only)
+  bool periodicY = false;
 };
 
+// The config file holds one line
+//   dc,rhoc,outlierDeltaFactor,produceOutput[,approximate[,refineMargin[,slices[,densityKernel[,kernelScale
+//     [,reproducible[,neighbourListSize[,periodicY]]]]]]]]
+// where densityKernel is flat, gaussian or exponential; throws
+// std::invalid_argument for an unknown kernel
+inline Parameters readParameters(std::filesystem::path const& configFile) {
+  Parameters par;
+  std::ifstream iFile(configFile);
+  std::string line;
+  while (getline(iFile, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string value;
+    getline(fields, value, ',');
+    par.dc = std::stof(value);
+    getline(fields, value, ',');
+    par.rhoc = std::stof(value);
+    getline(fields, value, ',');
+    par.outlierDeltaFactor = std::stof(value);
+    getline(fields, value, ',');
+    par.produceOutput = static_cast<bool>(std::stoi(value));
+    if (getline(fields, value, ',')) {
+      par.approximate = static_cast<bool>(std::stoi(value));
+    }
+    if (getline(fields, value, ',')) {
+      par.refineMargin = std::stof(value);
+    }
+    if (getline(fields, value, ',')) {
+      par.slices = std::stoi(value);
+    }
+    if (getline(fields, value, ',')) {
+      par.densityKernel = densitykernels::parseKernel(value);
+    }
+    if (getline(fields, value, ',')) {
+      par.kernelScale = std::stof(value);
+    }
+    if (getline(fields, value, ',')) {
+      par.reproducible = static_cast<bool>(std::stoi(value));
+    }
+    if (getline(fields, value, ',')) {
+      par.neighbourListSize = std::stoul(value);
+    }
+    if (getline(fields, value, ',')) {
+      par.periodicY = static_cast<bool>(std::stoi(value));
+    }
+  }
+  if (par.kernelScale <= 0.f) {
+    par.kernelScale = 0.5f * par.dc;
+  }
+  return par;
+}
+
 template <typename T>
 std::string to_string_with_precision(const T a_value, const int n = 6) {
   std::ostringstream out;
@@ -13,6 +13,8 @@ namespace ticl {
     static constexpr int nPhiBins = 126;
     static constexpr int nLayers = 94;
     static constexpr int nBins = nEtaBins * nPhiBins;
+    // ghost phi columns on each side of the tiles, see TICLLayerTileT
+    static constexpr int nPhiHalo = 2;
   };
 }  // namespace ticl
 
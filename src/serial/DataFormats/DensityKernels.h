@@ -0,0 +1,82 @@
+#ifndef DensityKernels_h
+#define DensityKernels_h
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+// Profiles of the contribution of a neighbour to the density of a point,
+// as a function of their squared distance; the algorithms multiply them
+// by their own neighbour factor (0.5 in CLUE 2D, kernelDensityFactor in
+// CLUE3D). The density steps are templated on the profile, so that it is
+// inlined in the loop over the neighbours; dispatch() turns the runtime
+// choice into the template argument once per event.
+namespace densitykernels {
+  enum class Kernel { Flat, Gaussian, Exponential };
+
+  // every neighbour within the search radius counts fully (the default)
+  struct Flat {
+    // the flat profile does not need the distance, the caller can skip it
+    static constexpr bool usesDistance = false;
+
+    float operator()(float) const { return 1.f; }
+  };
+
+  // exp(-d^2 / (2 scale^2))
+  struct Gaussian {
+    static constexpr bool usesDistance = true;
+
+    explicit Gaussian(float scale) : minusInverseTwoScale2(-0.5f / (scale * scale)) {}
+    float operator()(float distance2) const { return std::exp(distance2 * minusInverseTwoScale2); }
+
+    float minusInverseTwoScale2;
+  };
+
+  // exp(-d / scale)
+  struct Exponential {
+    static constexpr bool usesDistance = true;
+
+    explicit Exponential(float scale) : minusInverseScale(-1.f / scale) {}
+    float operator()(float distance2) const { return std::exp(std::sqrt(distance2) * minusInverseScale); }
+
+    float minusInverseScale;
+  };
+
+  // throws std::invalid_argument for anything but "flat", "gaussian" or "exponential"
+  inline Kernel parseKernel(std::string const& name) {
+    if (name == "flat") {
+      return Kernel::Flat;
+    } else if (name == "gaussian") {
+      return Kernel::Gaussian;
+    } else if (name == "exponential") {
+      return Kernel::Exponential;
+    }
+    throw std::invalid_argument("Invalid density kernel '" + name + "', use 'flat', 'gaussian' or 'exponential'");
+  }
+
+  inline char const* kernelName(Kernel kernel) {
+    switch (kernel) {
+      case Kernel::Gaussian:
+        return "gaussian";
+      case Kernel::Exponential:
+        return "exponential";
+      default:
+        return "flat";
+    }
+  }
+
+  // calls f with the profile of the given kind and scale
+  template <typename F>
+  decltype(auto) dispatch(Kernel kernel, float scale, F&& f) {
+    switch (kernel) {
+      case Kernel::Gaussian:
+        return f(Gaussian(scale));
+      case Kernel::Exponential:
+        return f(Exponential(scale));
+      default:
+        return f(Flat());
+    }
+  }
+}  // namespace densitykernels
+
+#endif
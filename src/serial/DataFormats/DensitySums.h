@@ -0,0 +1,43 @@
+#ifndef DensitySums_h
+#define DensitySums_h
+
+#include <cmath>
+#include <cstdint>
+
+// Accumulators of the density of a point. With float additions the
+// density depends on the order in which the neighbours are visited, so a
+// different tile layout, sorting or parallel split can change its last
+// bits and flip the comparisons of the nearest-higher search. The fixed
+// point sum does not depend on the order, so that all the variants of an
+// algorithm give bit-identical results. The density steps take the
+// accumulator as a template argument; dispatch() turns the runtime choice
+// into it once per event.
+namespace densitysums {
+  // float additions in the order of the neighbours (the default)
+  struct FloatSum {
+    void add(float x) { value += x; }
+    float result() const { return value; }
+
+    float value = 0.f;
+  };
+
+  // integer multiples of 2^-32, rounded per contribution: the sum is exact
+  // and independent of the order up to 2^31
+  struct FixedPointSum {
+    void add(float x) { value += std::llround(static_cast<double>(x) * 0x1p32); }
+    float result() const { return static_cast<float>(static_cast<double>(value) * 0x1p-32); }
+
+    std::int64_t value = 0;
+  };
+
+  // calls f with a fresh accumulator of the chosen kind
+  template <typename F>
+  decltype(auto) dispatch(bool reproducible, F&& f) {
+    if (reproducible) {
+      return f(FixedPointSum());
+    }
+    return f(FloatSum());
+  }
+}  // namespace densitysums
+
+#endif
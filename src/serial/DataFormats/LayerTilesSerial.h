@@ -5,21 +5,72 @@
 #include <cmath>
 #include <algorithm>
 #include <cstdint>
+#include <memory_resource>
+#include <vector>
 
 #include "DataFormats/LayerTilesConstants.h"
 
-class LayerTilesSerial {
+// With yHalo > 0, y is periodic over [minY, maxY), e.g. for the r * phi
+// coordinate of a cylindrical detector slice: yHalo ghost rows past each
+// end of the grid hold copies of the rows at the other end, so that a
+// search box reaching up to yHalo rows past the grid is still a plain
+// range of bins, without wraparound. The search boxes must then be at
+// most yHalo * tileSize wider than the point on each side, and the
+// distances along y taken with deltaY().
+template <int yHalo = 0>
+class LayerTilesSerialT {
 public:
-  LayerTilesSerial() { layerTiles_.resize(LayerTilesConstants::nColumns * LayerTilesConstants::nRows); }
+  static constexpr bool periodicY = yHalo > 0;
+  static constexpr int nRowsWithHalo = LayerTilesConstants::nRows + 2 * yHalo;
+  // widest reach of a search box past its point along a periodic y
+  static constexpr float yHaloReach = yHalo * LayerTilesConstants::tileSize;
+
+  // the bins and their content are allocated from the given resource,
+  // so that the tiles of all the layers can share a (huge page) arena
+  explicit LayerTilesSerialT(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : layerTiles_(resource), occupied_(resource) {
+    layerTiles_.resize(LayerTilesConstants::nColumns * nRowsWithHalo);
+  }
 
   void fill(const std::vector<float>& x, const std::vector<float>& y) {
     auto cellsSize = x.size();
     for (unsigned int i = 0; i < cellsSize; ++i) {
-      layerTiles_[getGlobalBin(x[i], y[i])].push_back(i);
+      fill(x[i], y[i], i);
     }
   }
 
-  void fill(float x, float y, int i) { layerTiles_[getGlobalBin(x, y)].push_back(i); }
+  void fill(float x, float y, int i) {
+    forEachCopy(x, y, [&](int bin) {
+      auto& tile = layerTiles_[bin];
+      if (tile.empty()) {
+        occupied_.push_back(bin);
+      }
+      tile.push_back(i);
+    });
+  }
+
+  // keeps the bin sorted by index, as if it had been filled in index order
+  void insert(float x, float y, int i) {
+    forEachCopy(x, y, [&](int bin) {
+      auto& tile = layerTiles_[bin];
+      if (tile.empty()) {
+        occupied_.push_back(bin);
+      }
+      tile.insert(std::upper_bound(tile.begin(), tile.end(), i), i);
+    });
+  }
+
+  void erase(float x, float y, int i) {
+    forEachCopy(x, y, [&](int bin) {
+      auto& tile = layerTiles_[bin];
+      tile.erase(std::lower_bound(tile.begin(), tile.end(), i));
+      if (tile.empty()) {
+        auto it = std::find(occupied_.begin(), occupied_.end(), bin);
+        *it = occupied_.back();
+        occupied_.pop_back();
+      }
+    });
+  }
 
   int getXBin(float x) const {
     constexpr float xRange = LayerTilesConstants::maxX - LayerTilesConstants::minX;
@@ -33,34 +84,84 @@ public:
   int getYBin(float y) const {
     constexpr float yRange = LayerTilesConstants::maxY - LayerTilesConstants::minY;
     static_assert(yRange >= 0.);
+    if constexpr (periodicY) {
+      y -= yRange * std::floor((y - LayerTilesConstants::minY) / yRange);
+    }
     int yBin = (y - LayerTilesConstants::minY) * LayerTilesConstants::rY;
     yBin = std::min(yBin, LayerTilesConstants::nRows - 1);
     yBin = std::max(yBin, 0);
     return yBin;
   }
 
-  int getGlobalBin(float x, float y) const { return getXBin(x) + getYBin(y) * LayerTilesConstants::nColumns; }
+  // y1 - y2, the shortest way around for a periodic y
+  float deltaY(float y1, float y2) const {
+    float dy = y1 - y2;
+    if constexpr (periodicY) {
+      constexpr float yRange = LayerTilesConstants::maxY - LayerTilesConstants::minY;
+      if (dy > 0.5f * yRange) {
+        dy -= yRange;
+      } else if (dy < -0.5f * yRange) {
+        dy += yRange;
+      }
+    }
+    return dy;
+  }
 
-  int getGlobalBinByBin(int xBin, int yBin) const { return xBin + yBin * LayerTilesConstants::nColumns; }
+  int getGlobalBin(float x, float y) const { return getGlobalBinByBin(getXBin(x), getYBin(y)); }
+
+  // yBin in [-yHalo, nRows + yHalo)
+  int getGlobalBinByBin(int xBin, int yBin) const { return xBin + (yBin + yHalo) * LayerTilesConstants::nColumns; }
 
   std::array<int, 4> searchBox(float xMin, float xMax, float yMin, float yMax) {
     int xBinMin = getXBin(xMin);
     int xBinMax = getXBin(xMax);
-    int yBinMin = getYBin(yMin);
-    int yBinMax = getYBin(yMax);
+    int yBinMin;
+    int yBinMax;
+    if constexpr (periodicY) {
+      // the window is not wrapped, the ghost rows hold the bins past the ends
+      yBinMin = std::floor((yMin - LayerTilesConstants::minY) * LayerTilesConstants::rY);
+      yBinMax = std::floor((yMax - LayerTilesConstants::minY) * LayerTilesConstants::rY);
+      yBinMin = std::max(yBinMin, -yHalo);
+      yBinMax = std::min({yBinMax, LayerTilesConstants::nRows - 1 + yHalo, yBinMin + LayerTilesConstants::nRows - 1});
+    } else {
+      yBinMin = getYBin(yMin);
+      yBinMax = getYBin(yMax);
+    }
     return std::array<int, 4>({{xBinMin, xBinMax, yBinMin, yBinMax}});
   }
 
+  // only the occupied bins, as an event fills a small fraction of them
   void clear() {
-    for (auto& t : layerTiles_) {
-      t.clear();
+    for (int bin : occupied_) {
+      layerTiles_[bin].clear();
     }
+    occupied_.clear();
   }
 
-  std::vector<int>& operator[](int globalBinId) { return layerTiles_[globalBinId]; }
+  std::pmr::vector<int>& operator[](int globalBinId) { return layerTiles_[globalBinId]; }
 
 private:
-  std::vector<std::vector<int>> layerTiles_;
+  // calls f with the bin of (x, y), and with its copy in a ghost row if any
+  template <typename F>
+  void forEachCopy(float x, float y, F&& f) {
+    int const xBin = getXBin(x);
+    int const yBin = getYBin(y);
+    f(getGlobalBinByBin(xBin, yBin));
+    if constexpr (periodicY) {
+      if (yBin < yHalo) {
+        f(getGlobalBinByBin(xBin, yBin + LayerTilesConstants::nRows));
+      } else if (yBin >= LayerTilesConstants::nRows - yHalo) {
+        f(getGlobalBinByBin(xBin, yBin - LayerTilesConstants::nRows));
+      }
+    }
+  }
+
+  std::pmr::vector<std::pmr::vector<int>> layerTiles_;
+  std::pmr::vector<int> occupied_;
 };
 
+using LayerTilesSerial = LayerTilesSerialT<>;
+// the tiles of the clusterings with a periodic y, see Parameters::periodicY
+using LayerTilesSerialPeriodicY = LayerTilesSerialT<2>;
+
 #endif  //LayerTiles_h
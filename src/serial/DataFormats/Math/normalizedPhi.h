@@ -9,6 +9,14 @@ constexpr T normalizedPhi(T phi) {
   return reco::reduceRange(phi);
 }
 
+// out[i] = normalizedPhi(phi[i]) for i in [0, n), without branches
+template <typename T>
+inline void normalizedPhi(T const* __restrict__ phi, T* __restrict__ out, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = reco::reduceRangeBranchless(phi[i]);
+  }
+}
+
 // cernlib V306
 template <typename T>
 constexpr T proxim(T b, T a) {
@@ -0,0 +1,38 @@
+#ifndef NeighbourList_h
+#define NeighbourList_h
+
+#include <cstddef>
+#include <vector>
+
+// Neighbours of each point, found by a single walk over the tiles and then
+// read by both the density and the nearest-higher steps, instead of each
+// of them walking the tiles again. The neighbours of point i are the
+// entries [offsets[i], offsets[i + 1]) of neighbours and distances, in the
+// order in which the walk found them, so that the densities summed over
+// them are bit-identical to the ones of the tile walks. The vectors keep
+// their capacity from one event to the next.
+struct NeighbourList {
+  std::vector<unsigned int> offsets;
+  std::vector<unsigned int> neighbours;
+  std::vector<float> distances;
+
+  void clear() {
+    offsets.assign(1, 0);
+    neighbours.clear();
+    distances.clear();
+  }
+
+  // adds j to the neighbours of the current point
+  void add(unsigned int j, float distance) {
+    neighbours.push_back(j);
+    distances.push_back(distance);
+  }
+
+  // closes the list of the current point and opens the next one
+  void close() { offsets.push_back(neighbours.size()); }
+
+  // number of neighbour pairs in the list
+  std::size_t size() const { return neighbours.size(); }
+};
+
+#endif
@@ -15,13 +15,29 @@ struct PointsCloud {
 struct PointsCloudSerial {
   PointsCloudSerial() = default;
 
-  void outResize() {
+  // bits of the columns, for edm::ProductRegistry::consumes()
+  enum Columns : unsigned int {
+    kInputs = 1u << 0,  // x, y, layer and weight
+    kRho = 1u << 1,
+    kDelta = 1u << 2,
+    kNearestHigher = 1u << 3,
+    kFollowers = 1u << 4,
+    kIsSeed = 1u << 5,
+    kClusterIndex = 1u << 6,
+    // every column but the followers, as the output and the validation need
+    kAllButFollowers = kInputs | kRho | kDelta | kNearestHigher | kIsSeed | kClusterIndex,
+  };
+
+  // without followers, the followers column is left empty
+  void outResize(bool withFollowers = true) {
     auto nPoints = x.size();
     rho.resize(nPoints);
     delta.resize(nPoints);
     nearestHigher.resize(nPoints);
     clusterIndex.resize(nPoints);
-    followers.resize(nPoints);
+    if (withFollowers) {
+      followers.resize(nPoints);
+    }
     isSeed.resize(nPoints);
   }
 
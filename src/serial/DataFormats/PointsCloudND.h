@@ -0,0 +1,49 @@
+#ifndef Points_Cloud_ND_h
+#define Points_Cloud_ND_h
+
+#include <array>
+#include <vector>
+
+// Points in N dimensions, with the same outputs as PointsCloudSerial.
+// The coordinates are expected in commensurate units (e.g. a time scaled
+// by a velocity), as a single dc applies to all of them.
+template <int N>
+struct PointsCloudND {
+  static_assert(N > 0, "PointsCloudND needs at least one coordinate");
+
+  PointsCloudND() = default;
+
+  // also resets the outputs of a previous clustering of the same points
+  void outResize() {
+    auto nPoints = weight.size();
+    rho.resize(nPoints);
+    delta.resize(nPoints);
+    nearestHigher.resize(nPoints);
+    clusterIndex.resize(nPoints);
+    followers.resize(nPoints);
+    for (auto& f : followers) {
+      f.clear();
+    }
+    isSeed.assign(nPoints, 0);
+  }
+
+  std::array<float, N> point(int i) const {
+    std::array<float, N> p;
+    for (int d = 0; d < N; ++d) {
+      p[d] = coords[d][i];
+    }
+    return p;
+  }
+
+  std::array<std::vector<float>, N> coords;
+  std::vector<float> weight;
+
+  std::vector<float> rho;
+  std::vector<float> delta;
+  std::vector<int> nearestHigher;
+  std::vector<std::vector<int>> followers;
+  std::vector<int> isSeed;
+  std::vector<int> clusterIndex;
+};
+
+#endif
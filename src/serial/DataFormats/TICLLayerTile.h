@@ -7,13 +7,31 @@
 #include "DataFormats/Common.h"
 #include "DataFormats/Math/normalizedPhi.h"
 
-template <typename T>
+// With phiHalo > 0, each eta row has phiHalo ghost phi columns past each
+// end, holding copies of the entries of the phiHalo bins at the other end
+// of the row; a search window reaching up to phiHalo bins outside of
+// [0, nPhiBins) is then a contiguous range of bins, without wraparound.
+template <typename T, int halo = 0>
 class TICLLayerTileT {
 public:
   typedef T type;
 
+  static constexpr int phiHalo = halo;
+  static constexpr int nPhiColumns = T::nPhiBins + 2 * phiHalo;
+  static constexpr int nBins = T::nEtaBins * nPhiColumns;
+
   void fill(double eta, double phi, unsigned int layerClusterId) {
-    tile_[globalBin(eta, phi)].push_back(layerClusterId);
+    int etaBin = this->etaBin(eta);
+    int phiBin = this->phiBin(phi);
+    tile_[globalBin(etaBin, phiBin)].push_back(layerClusterId);
+    if constexpr (phiHalo > 0) {
+      // replicate the border bins into the ghost columns at the other end
+      if (phiBin < phiHalo) {
+        tile_[globalBin(etaBin, phiBin + T::nPhiBins)].push_back(layerClusterId);
+      } else if (phiBin >= T::nPhiBins - phiHalo) {
+        tile_[globalBin(etaBin, phiBin - T::nPhiBins)].push_back(layerClusterId);
+      }
+    }
   }
 
   int etaBin(float eta) const {
@@ -49,12 +67,23 @@ public:
     return std::array<int, 4>({{etaBinMin, etaBinMax, phiBinMin, phiBinMax}});
   }
 
-  int globalBin(int etaBin, int phiBin) const { return phiBin + etaBin * T::nPhiBins; }
+  // phiBin in [-phiHalo, nPhiBins + phiHalo)
+  int globalBin(int etaBin, int phiBin) const { return phiBin + phiHalo + etaBin * nPhiColumns; }
 
-  int globalBin(double eta, double phi) const { return phiBin(phi) + etaBin(eta) * T::nPhiBins; }
+  int globalBin(double eta, double phi) const { return globalBin(etaBin(eta), phiBin(phi)); }
+
+  // bin to visit for a phi bin of a search window, which may be past
+  // either end of the row: by at most phiHalo bins with the ghost
+  // columns, or by any number of bins without them
+  int searchBin(int etaBin, int phiBin) const {
+    if constexpr (phiHalo > 0) {
+      return globalBin(etaBin, phiBin);
+    } else {
+      return globalBin(etaBin, (phiBin % T::nPhiBins + T::nPhiBins) % T::nPhiBins);
+    }
+  }
 
   void clear() {
-    auto nBins = T::nEtaBins * T::nPhiBins;
     for (int j = 0; j < nBins; ++j)
       tile_[j].clear();
   }
@@ -62,11 +91,11 @@ public:
   const std::vector<unsigned int>& operator[](int globalBinId) const { return tile_[globalBinId]; }
 
 private:
-  std::array<std::vector<unsigned int>, T::nBins> tile_;
+  std::array<std::vector<unsigned int>, nBins> tile_;
 };
 
 namespace ticl {
-  using TICLLayerTile = TICLLayerTileT<TileConstants>;
+  using TICLLayerTile = TICLLayerTileT<TileConstants, TileConstants::nPhiHalo>;
   using Tiles = std::array<TICLLayerTile, TileConstants::nLayers>;
 }  // namespace ticl
 
@@ -75,6 +104,7 @@ class TICLGenericTile {
 public:
   // value_type_t is the type of the type of the array used by the incoming <T> type.
   using constants_type_t = typename T::value_type::type;
+  using tile_type_t = typename T::value_type;
   // This class represents a generic collection of Tiles. The additional index
   // numbering is not handled internally. It is the user's responsibility to
   // properly use and consistently access it here.
@@ -0,0 +1,130 @@
+#ifndef TilesND_h
+#define TilesND_h
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+// Regular grid of tiles over N coordinates, holding the indices of the
+// points in each tile. Bit d of periodicMask makes coordinate d periodic
+// over [min[d], max[d]): its bins wrap around, and delta<d>() returns the
+// shortest signed difference. The loops over the dimensions are unrolled
+// at compile time; dimension 0 is the outermost one when visiting the
+// bins of a search box, as x is for LayerTilesSerial.
+template <int N, unsigned periodicMask = 0>
+class TilesND {
+public:
+  using Point = std::array<float, N>;
+  using Box = std::array<std::array<int, 2>, N>;
+
+  static constexpr bool isPeriodic(int d) { return (periodicMask >> d) & 1u; }
+
+  TilesND(Point const& min, Point const& max, Point const& tileSize) : min_(min), max_(max) {
+    int nTiles = 1;
+    for (int d = 0; d < N; ++d) {
+      nBins_[d] = std::max(1, static_cast<int>(std::ceil((max[d] - min[d]) / tileSize[d])));
+      r_[d] = nBins_[d] / (max[d] - min[d]);
+      stride_[d] = nTiles;
+      nTiles *= nBins_[d];
+    }
+    tiles_.resize(nTiles);
+  }
+
+  void fill(Point const& p, int i) {
+    int const bin = globalBin(p);
+    if (tiles_[bin].empty()) {
+      occupied_.push_back(bin);
+    }
+    tiles_[bin].push_back(i);
+  }
+
+  int bin(int d, float v) const {
+    if (isPeriodic(d)) {
+      float const period = max_[d] - min_[d];
+      v -= period * std::floor((v - min_[d]) / period);
+    }
+    int b = (v - min_[d]) * r_[d];
+    return std::clamp(b, 0, nBins_[d] - 1);
+  }
+
+  int globalBin(Point const& p) const {
+    int bin = 0;
+    for (int d = 0; d < N; ++d) {
+      bin += this->bin(d, p[d]) * stride_[d];
+    }
+    return bin;
+  }
+
+  // bins within radius of p along each coordinate; for the periodic ones
+  // the range may extend past the edges, and is wrapped by forEachBin()
+  Box searchBox(Point const& p, float radius) const {
+    Box box;
+    for (int d = 0; d < N; ++d) {
+      if (isPeriodic(d)) {
+        int const lo = std::floor((p[d] - radius - min_[d]) * r_[d]);
+        int const hi = std::floor((p[d] + radius - min_[d]) * r_[d]);
+        box[d] = (hi - lo + 1 >= nBins_[d]) ? std::array<int, 2>{{0, nBins_[d] - 1}} : std::array<int, 2>{{lo, hi}};
+      } else {
+        box[d] = {{bin(d, p[d] - radius), bin(d, p[d] + radius)}};
+      }
+    }
+    return box;
+  }
+
+  // calls f(globalBin) for each bin of the box
+  template <typename F>
+  void forEachBin(Box const& box, F&& f) const {
+    loop<0>(box, 0, f);
+  }
+
+  // signed difference a - b along coordinate D
+  template <int D>
+  float delta(float a, float b) const {
+    float d = a - b;
+    if constexpr (isPeriodic(D)) {
+      float const period = max_[D] - min_[D];
+      if (d > 0.5f * period) {
+        d -= period;
+      } else if (d < -0.5f * period) {
+        d += period;
+      }
+    }
+    return d;
+  }
+
+  void clear() {
+    for (int bin : occupied_) {
+      tiles_[bin].clear();
+    }
+    occupied_.clear();
+  }
+
+  std::vector<int> const& operator[](int globalBinId) const { return tiles_[globalBinId]; }
+
+private:
+  template <int D, typename F>
+  void loop(Box const& box, int offset, F& f) const {
+    for (int b = box[D][0]; b <= box[D][1]; ++b) {
+      int bin = b;
+      if constexpr (isPeriodic(D)) {
+        bin = ((b % nBins_[D]) + nBins_[D]) % nBins_[D];
+      }
+      if constexpr (D == N - 1) {
+        f(offset + bin * stride_[D]);
+      } else {
+        loop<D + 1>(box, offset + bin * stride_[D], f);
+      }
+    }
+  }
+
+  Point min_;
+  Point max_;
+  Point r_;
+  std::array<int, N> nBins_;
+  std::array<int, N> stride_;
+  std::vector<std::vector<int>> tiles_;
+  std::vector<int> occupied_;
+};
+
+#endif
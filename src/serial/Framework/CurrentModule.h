@@ -0,0 +1,35 @@
+#ifndef Framework_CurrentModule_h
+#define Framework_CurrentModule_h
+
+namespace edm {
+  // Module and stream on whose behalf a thread is running, for the
+  // tools that look at the threads from the outside, like the sampling
+  // profiler reading it from a signal handler.
+  struct ModuleTag {
+    char const* module;
+    int stream;
+  };
+
+  // nullptr while the thread is not running a module; the tag it points
+  // to lives as long as the module
+  extern thread_local ModuleTag const* currentModule;
+
+  // Sets the current module of this thread for its lifetime, restoring the
+  // previous one on destruction, so that a module run inline from within
+  // another one, e.g. by a nested TBB wait, is attributed correctly. The
+  // tag changes with a single pointer store, so that a signal interrupting
+  // the thread never sees half of it.
+  class CurrentModuleSentry {
+  public:
+    explicit CurrentModuleSentry(ModuleTag const* tag) : previous_{currentModule} { currentModule = tag; }
+    ~CurrentModuleSentry() { currentModule = previous_; }
+
+    CurrentModuleSentry(CurrentModuleSentry const&) = delete;
+    CurrentModuleSentry& operator=(CurrentModuleSentry const&) = delete;
+
+  private:
+    ModuleTag const* previous_;
+  };
+}  // namespace edm
+
+#endif  // Framework_CurrentModule_h
@@ -31,7 +31,7 @@ namespace edm {
   class Event {
   public:
     explicit Event(int streamId, int eventId, ProductRegistry const& reg)
-        : streamId_(streamId), eventId_(eventId), products_(reg.size()) {}
+        : streamId_(streamId), eventId_(eventId), products_(reg.size()), registry_(&reg) {}
 
     StreamID streamID() const { return streamId_; }
     int eventID() const { return eventId_; }
@@ -46,10 +46,17 @@ namespace edm {
       products_[token.index()] = std::make_unique<Wrapper<T>>(std::forward<Args>(args)...);
     }
 
+    // see ProductRegistry::consumes()
+    template <typename T>
+    unsigned int consumedColumns(EDPutTokenT<T> const& token) const {
+      return registry_->consumedColumns(token.index());
+    }
+
   private:
     StreamID streamId_;
     int eventId_;
     std::vector<std::unique_ptr<WrapperBase>> products_;
+    ProductRegistry const* registry_;
   };
 }  // namespace edm
 
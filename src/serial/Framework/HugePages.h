@@ -0,0 +1,77 @@
+#ifndef Framework_HugePages_h
+#define Framework_HugePages_h
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <string>
+
+namespace edm {
+  namespace hugepages {
+    // How the large, randomly accessed buffers (input store, algorithm
+    // scratch, host caching allocator) are backed:
+    //   None      regular pages
+    //   Advise    2 MB aligned anonymous mappings with madvise(MADV_HUGEPAGE),
+    //             served by transparent huge pages when the kernel allows it
+    //   Explicit  MAP_HUGETLB mappings of 2 MB pages from the pre-reserved pool
+    //             (vm.nr_hugepages), falling back to Advise when the pool is
+    //             empty
+    // The policy is process wide and must be set before the first
+    // allocation, i.e. at the beginning of main().
+    enum class Policy { None, Advise, Explicit };
+
+    constexpr std::size_t pageSize = 2 * 1024 * 1024;
+
+    // throws std::invalid_argument for anything but "none", "advise" or "explicit"
+    Policy parsePolicy(std::string const& name);
+    char const* policyName(Policy policy);
+
+    void setPolicy(Policy policy);
+    Policy policy();
+
+    // Allocations of at least one huge page are mapped according to the
+    // policy, smaller ones are forwarded to operator new. The same size
+    // has to be given back to deallocate().
+    void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+    void deallocate(void* ptr, std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) noexcept;
+
+    // Ask for transparent huge pages on the 2 MB aligned part of an
+    // existing buffer; does nothing for the None policy
+    void advise(void* ptr, std::size_t bytes) noexcept;
+
+    // totals since the start of the job
+    struct Statistics {
+      std::size_t hugeBytes;     // mapped with MAP_HUGETLB
+      std::size_t advisedBytes;  // mapped with MADV_HUGEPAGE
+      std::size_t fallbacks;     // MAP_HUGETLB attempts that fell back to MADV_HUGEPAGE
+    };
+    Statistics statistics();
+
+    // memory_resource view of allocate()/deallocate(), thread safe
+    std::pmr::memory_resource* resource();
+
+    // std-compatible allocator for containers that own a large buffer
+    template <typename T>
+    struct Allocator {
+      using value_type = T;
+
+      Allocator() = default;
+      template <typename U>
+      Allocator(Allocator<U> const&) noexcept {}
+
+      T* allocate(std::size_t n) { return static_cast<T*>(hugepages::allocate(n * sizeof(T), alignof(T))); }
+      void deallocate(T* ptr, std::size_t n) noexcept { hugepages::deallocate(ptr, n * sizeof(T), alignof(T)); }
+
+      template <typename U>
+      bool operator==(Allocator<U> const&) const noexcept {
+        return true;
+      }
+      template <typename U>
+      bool operator!=(Allocator<U> const&) const noexcept {
+        return false;
+      }
+    };
+  }  // namespace hugepages
+}  // namespace edm
+
+#endif
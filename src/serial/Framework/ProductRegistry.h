@@ -7,6 +7,7 @@
 #include <string>
 #include <typeindex>
 #include <unordered_map>
+#include <vector>
 
 #include "Framework/EDGetToken.h"
 #include "Framework/EDPutToken.h"
@@ -15,6 +16,8 @@ namespace edm {
   class ProductRegistry {
   public:
     constexpr static int kSourceIndex = 0;
+    // all the columns of a product, for the consumers that do not say which ones they read
+    constexpr static unsigned int kAllColumns = ~0u;
 
     ProductRegistry() = default;
 
@@ -27,21 +30,29 @@ namespace edm {
       if (not succeeded.second) {
         throw std::runtime_error(std::string("Product of type ") + typeid(T).name() + " already exists");
       }
+      consumedColumns_.push_back(0);
       return EDPutTokenT<T>{ind};
     }
 
+    // columns is a bit mask of the parts of the product that the module
+    // reads, with bits defined by the product type; the producer can skip
+    // filling the ones no module reads
     template <typename T>
-    EDGetTokenT<T> consumes() {
+    EDGetTokenT<T> consumes(unsigned int columns = kAllColumns) {
       const auto found = typeToIndex_.find(std::type_index(typeid(T)));
       if (found == typeToIndex_.end()) {
         throw std::runtime_error(std::string("Product of type ") + typeid(T).name() + " is not produced");
       }
       consumedModules_.insert(found->second.moduleIndex());
+      consumedColumns_[found->second.productIndex()] |= columns;
       return EDGetTokenT<T>{found->second.productIndex()};
     }
 
     auto size() const { return typeToIndex_.size(); }
 
+    // the columns of the product read by any module, 0 if no module consumes it
+    unsigned int consumedColumns(unsigned int productIndex) const { return consumedColumns_[productIndex]; }
+
     // internal interface
     void beginModuleConstruction(int i) {
       currentModuleIndex_ = i;
@@ -65,6 +76,7 @@ namespace edm {
 
     unsigned int currentModuleIndex_ = kSourceIndex;
     std::set<unsigned int> consumedModules_;
+    std::vector<unsigned int> consumedColumns_;
 
     std::unordered_map<std::type_index, Indices> typeToIndex_;
   };
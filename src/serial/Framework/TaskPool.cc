@@ -0,0 +1,49 @@
+#include <functional>
+
+#include "Framework/TaskPool.h"
+
+namespace edm {
+  TaskPool::TaskPool(unsigned int blocks)
+      : blocks_{new Block[blocks]}, next_{new std::atomic<std::uint32_t>[blocks]}, size_{blocks}, head_{0} {
+    for (unsigned int i = 0; i < size_; ++i) {
+      next_[i] = i + 1 < size_ ? i + 1 : kEnd;
+    }
+    head_ = size_ > 0 ? 0 : kEnd;
+  }
+
+  TaskPool::~TaskPool() = default;
+
+  bool TaskPool::owns(void const* ptr) const {
+    std::less_equal<void const*> lessEqual;
+    std::less<void const*> less;
+    return lessEqual(blocks_.get(), ptr) and less(ptr, blocks_.get() + size_);
+  }
+
+  void* TaskPool::allocate(std::size_t bytes) {
+    if (bytes <= kBlockSize) {
+      std::uint64_t head = head_.load(std::memory_order_acquire);
+      while (static_cast<std::uint32_t>(head) != kEnd) {
+        std::uint32_t const index = static_cast<std::uint32_t>(head);
+        std::uint64_t const next = ((head >> 32) + 1) << 32 | next_[index].load(std::memory_order_relaxed);
+        if (head_.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+          return blocks_[index].data;
+        }
+      }
+    }
+    return ::operator new(bytes);
+  }
+
+  void TaskPool::deallocate(void* ptr) noexcept {
+    if (not owns(ptr)) {
+      ::operator delete(ptr);
+      return;
+    }
+    std::uint32_t const index = static_cast<Block*>(ptr) - blocks_.get();
+    std::uint64_t head = head_.load(std::memory_order_relaxed);
+    std::uint64_t next;
+    do {
+      next_[index].store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+      next = ((head >> 32) + 1) << 32 | index;
+    } while (not head_.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+  }
+}  // namespace edm
@@ -25,6 +25,7 @@
 
 // user include files
 #include "Framework/TaskBase.h"
+#include "Framework/TaskPool.h"
 
 // forward declarations
 
@@ -102,6 +103,12 @@ namespace edm {
     return new FunctorWaitingTask<F>(std::move(f));
   }
 
+  ///Makes the task in the memory of pool, to which it returns once it has run
+  template <typename F>
+  PooledTask<FunctorWaitingTask<F>>* make_waiting_task(TaskPool& pool, F f) {
+    return make_pooled_task<FunctorWaitingTask<F>>(pool, std::move(f));
+  }
+
 }  // namespace edm
 
 #endif
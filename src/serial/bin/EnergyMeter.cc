@@ -0,0 +1,136 @@
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+
+#include "EnergyMeter.h"
+
+namespace {
+  // reads the single integer of a sysfs file, false if it can not be read
+  bool readValue(std::string const& file, std::uint64_t& value) {
+    std::ifstream in(file);
+    return static_cast<bool>(in >> value);
+  }
+}  // namespace
+
+namespace edm {
+  EnergyMeter::EnergyMeter(double intervalSeconds)
+      : interval_{std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(intervalSeconds))} {
+    std::error_code error;
+    // the packages are intel-rapl:N, and their DRAM, core and uncore parts intel-rapl:N:M
+    for (auto const& entry : std::filesystem::directory_iterator("/sys/class/powercap", error)) {
+      if (entry.path().filename().string().rfind("intel-rapl:", 0) != 0) {
+        continue;
+      }
+      std::string name;
+      std::ifstream(entry.path() / "name") >> name;
+      Counter counter;
+      if (name.rfind("package-", 0) == 0) {
+        counter.domain = Domain::Package;
+      } else if (name == "dram") {
+        counter.domain = Domain::DRAM;
+      } else {
+        continue;
+      }
+      counter.file = entry.path() / "energy_uj";
+      if (readValue(counter.file, counter.last) and readValue(entry.path() / "max_energy_range_uj", counter.range)) {
+        counters_.push_back(std::move(counter));
+      }
+    }
+  }
+
+  EnergyMeter::~EnergyMeter() { stop(); }
+
+  bool EnergyMeter::hasDomain(Domain domain) const {
+    for (auto const& counter : counters_) {
+      if (counter.domain == domain) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void EnergyMeter::start() {
+    if (not available()) {
+      return;
+    }
+    for (auto& counter : counters_) {
+      readValue(counter.file, counter.last);
+      counter.joules = 0.;
+    }
+    startTime_ = std::chrono::steady_clock::now();
+    stopRequested_ = false;
+    thread_ = std::thread([this]() { run(); });
+  }
+
+  void EnergyMeter::stop() {
+    if (not thread_.joinable()) {
+      return;
+    }
+    {
+      std::scoped_lock lock(mutex_);
+      stopRequested_ = true;
+    }
+    stopCondition_.notify_one();
+    thread_.join();
+    sample();
+    stopTime_ = std::chrono::steady_clock::now();
+  }
+
+  double EnergyMeter::joules(Domain domain) const {
+    double sum = 0.;
+    for (auto const& counter : counters_) {
+      if (counter.domain == domain) {
+        sum += counter.joules;
+      }
+    }
+    return sum;
+  }
+
+  double EnergyMeter::seconds() const { return std::chrono::duration<double>(stopTime_ - startTime_).count(); }
+
+  void EnergyMeter::run() {
+    std::unique_lock lock(mutex_);
+    auto next = startTime_ + interval_;
+    while (not stopCondition_.wait_until(lock, next, [this]() { return stopRequested_; })) {
+      lock.unlock();
+      sample();
+      lock.lock();
+      next += interval_;
+    }
+  }
+
+  void EnergyMeter::sample() {
+    for (auto& counter : counters_) {
+      std::uint64_t value;
+      if (not readValue(counter.file, value)) {
+        continue;
+      }
+      // the counters are monotonic, so a smaller value means they have wrapped around
+      std::uint64_t const delta = value >= counter.last ? value - counter.last : counter.range - counter.last + value;
+      counter.joules += delta * 1e-6;
+      counter.last = value;
+    }
+  }
+
+  void EnergyMeter::report(std::ostream& out, int events) const {
+    if (not available()) {
+      out << "Energy: not available (no readable RAPL counters in /sys/class/powercap)" << std::endl;
+      return;
+    }
+    double const time = seconds();
+    double const package = joules(Domain::Package);
+    out << "Energy: " << std::fixed << std::setprecision(1) << "package " << package << " J (" << package / time
+        << " W)";
+    double total = package;
+    if (hasDomain(Domain::DRAM)) {
+      double const dram = joules(Domain::DRAM);
+      out << ", DRAM " << dram << " J (" << dram / time << " W)";
+      total += dram;
+    }
+    if (total > 0.) {
+      out << ", " << std::setprecision(3) << events / total << " events/J";
+    }
+    out << std::endl;
+  }
+}  // namespace edm
@@ -0,0 +1,68 @@
+#ifndef EnergyMeter_h
+#define EnergyMeter_h
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace edm {
+  // Energy used by the CPU packages and their DRAM while the job runs,
+  // read from the RAPL counters exposed by the Linux powercap interface
+  // in /sys/class/powercap. The counters cover the whole sockets, not
+  // only this process. They are sampled at start(), at stop() and every
+  // interval in between, often enough not to miss a wrap around. Recent
+  // kernels let only root read them; without any readable counter the
+  // meter is not available and reports so.
+  class EnergyMeter {
+  public:
+    enum class Domain { Package, DRAM };
+
+    explicit EnergyMeter(double intervalSeconds = 1.);
+    ~EnergyMeter();
+
+    EnergyMeter(EnergyMeter const&) = delete;
+    EnergyMeter& operator=(EnergyMeter const&) = delete;
+
+    bool available() const { return not counters_.empty(); }
+    bool hasDomain(Domain domain) const;
+
+    void start();
+    void stop();
+
+    // between start() and stop(), summed over the sockets
+    double joules(Domain domain) const;
+    double seconds() const;
+
+    // prints the joules and average watts of each domain, and the events per joule
+    void report(std::ostream& out, int events) const;
+
+  private:
+    struct Counter {
+      std::string file;  // energy_uj
+      Domain domain;
+      std::uint64_t range;  // the counter wraps around at this value
+      std::uint64_t last = 0;
+      double joules = 0.;
+    };
+
+    void run();
+    void sample();
+
+    std::chrono::steady_clock::duration const interval_;
+    std::vector<Counter> counters_;
+    std::chrono::steady_clock::time_point startTime_;
+    std::chrono::steady_clock::time_point stopTime_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable stopCondition_;
+    bool stopRequested_ = false;
+  };
+}  // namespace edm
+
+#endif
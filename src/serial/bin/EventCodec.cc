@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+#include <tbb/parallel_pipeline.h>
+#include <tbb/task_arena.h>
+
+#include "EventCodec.h"
+
+namespace {
+  constexpr char kMagic[4] = {'C', 'L', 'Z', '1'};
+
+  void putVarint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+      out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+  }
+
+  std::uint64_t getVarint(char const*& p, char const* end) {
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (p == end) {
+        throw std::runtime_error("Truncated block in the compressed input");
+      }
+      auto const byte = static_cast<std::uint8_t>(*p++);
+      value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      if (byte < 0x80) {
+        return value;
+      }
+    }
+    throw std::runtime_error("Invalid varint in the compressed input");
+  }
+
+  std::uint64_t zigzag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+  }
+
+  std::int64_t unzigzag(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+  }
+
+  std::uint32_t bits(float value) {
+    std::uint32_t b;
+    std::memcpy(&b, &value, sizeof(b));
+    return b;
+  }
+
+  float fromBits(std::uint32_t b) {
+    float value;
+    std::memcpy(&value, &b, sizeof(value));
+    return value;
+  }
+
+  // the integers that the values are, bit for bit; false if any is not
+  bool toIntegers(std::vector<float> const& column, std::vector<std::int64_t>& integers) {
+    integers.clear();
+    for (float value : column) {
+      if (not(std::abs(value) < 0x1p53f)) {
+        return false;
+      }
+      auto const n = static_cast<std::int64_t>(value);
+      if (bits(static_cast<float>(n)) != bits(value)) {
+        return false;
+      }
+      integers.push_back(n);
+    }
+    return true;
+  }
+
+  // the multiples of quantum closest to the values; false if any is out of range
+  bool toQuanta(std::vector<float> const& column, float quantum, std::vector<std::int64_t>& integers) {
+    integers.clear();
+    for (float value : column) {
+      double const n = std::nearbyint(static_cast<double>(value) / quantum);
+      if (not(std::abs(n) < 0x1p53)) {
+        return false;
+      }
+      integers.push_back(static_cast<std::int64_t>(n));
+    }
+    return true;
+  }
+
+  void encodeDelta(std::vector<std::int64_t> const& integers, std::string& out) {
+    std::int64_t previous = 0;
+    for (auto n : integers) {
+      putVarint(out, zigzag(n - previous));
+      previous = n;
+    }
+  }
+
+  void encodeRunLength(std::vector<std::int64_t> const& integers, std::string& out) {
+    std::int64_t previous = 0;
+    for (std::size_t i = 0; i < integers.size();) {
+      std::size_t j = i + 1;
+      while (j < integers.size() and integers[j] == integers[i]) {
+        ++j;
+      }
+      putVarint(out, zigzag(integers[i] - previous));
+      putVarint(out, j - i - 1);
+      previous = integers[i];
+      i = j;
+    }
+  }
+
+  void encodeColumn(std::vector<float> const& column, float quantum, std::string& out, eventcodec::Statistics* stats) {
+    using eventcodec::Mode;
+    std::string best;
+    auto consider = [&best](std::string&& candidate) {
+      if (best.empty() or candidate.size() < best.size()) {
+        best = std::move(candidate);
+      }
+    };
+
+    std::string raw(1, static_cast<char>(Mode::Raw));
+    raw.append(reinterpret_cast<char const*>(column.data()), column.size() * sizeof(float));
+    consider(std::move(raw));
+
+    std::string xored(1, static_cast<char>(Mode::Xor));
+    std::uint32_t previous = 0;
+    for (float value : column) {
+      putVarint(xored, bits(value) ^ previous);
+      previous = bits(value);
+    }
+    consider(std::move(xored));
+
+    std::vector<std::int64_t> integers;
+    integers.reserve(column.size());
+    std::string prefix;
+    bool integral = toIntegers(column, integers);
+    if (integral) {
+      prefix.push_back(static_cast<char>(Mode::Delta));
+    } else if (quantum > 0.f and toQuanta(column, quantum, integers)) {
+      integral = true;
+      prefix.push_back(static_cast<char>(Mode::QuantisedDelta));
+      prefix.append(reinterpret_cast<char const*>(&quantum), sizeof(float));
+    }
+    if (integral) {
+      std::string delta = prefix;
+      encodeDelta(integers, delta);
+      consider(std::move(delta));
+      // the run length modes follow the delta ones
+      std::string runLength = prefix;
+      runLength[0] = static_cast<char>(static_cast<std::uint8_t>(prefix[0]) + 1);
+      encodeRunLength(integers, runLength);
+      consider(std::move(runLength));
+    }
+
+    if (stats) {
+      ++stats->modes[static_cast<std::uint8_t>(best[0])];
+    }
+    out += best;
+  }
+
+  void decodeColumn(char const*& p, char const* end, std::size_t nPoints, std::vector<float>& column) {
+    using eventcodec::Mode;
+    if (p == end) {
+      throw std::runtime_error("Truncated block in the compressed input");
+    }
+    auto const mode = static_cast<Mode>(*p++);
+    column.resize(nPoints);
+    switch (mode) {
+      case Mode::Raw:
+        if (static_cast<std::size_t>(end - p) < nPoints * sizeof(float)) {
+          throw std::runtime_error("Truncated block in the compressed input");
+        }
+        std::memcpy(column.data(), p, nPoints * sizeof(float));
+        p += nPoints * sizeof(float);
+        break;
+      case Mode::Xor: {
+        std::uint32_t previous = 0;
+        for (auto& value : column) {
+          previous ^= static_cast<std::uint32_t>(getVarint(p, end));
+          value = fromBits(previous);
+        }
+        break;
+      }
+      case Mode::Delta:
+      case Mode::RunLength:
+      case Mode::QuantisedDelta:
+      case Mode::QuantisedRunLength: {
+        bool const quantised = mode == Mode::QuantisedDelta or mode == Mode::QuantisedRunLength;
+        bool const runLength = mode == Mode::RunLength or mode == Mode::QuantisedRunLength;
+        double quantum = 1.;
+        if (quantised) {
+          float q;
+          if (static_cast<std::size_t>(end - p) < sizeof(q)) {
+            throw std::runtime_error("Truncated block in the compressed input");
+          }
+          std::memcpy(&q, p, sizeof(q));
+          p += sizeof(q);
+          quantum = q;
+        }
+        std::int64_t n = 0;
+        for (std::size_t i = 0; i < nPoints;) {
+          n += unzigzag(getVarint(p, end));
+          std::uint64_t const repeat = runLength ? getVarint(p, end) + 1 : 1;
+          if (repeat > nPoints - i) {
+            throw std::runtime_error("Invalid run length in the compressed input");
+          }
+          float const value = quantised ? static_cast<float>(n * quantum) : static_cast<float>(n);
+          std::fill_n(column.begin() + i, repeat, value);
+          i += repeat;
+        }
+        break;
+      }
+      default:
+        throw std::runtime_error("Unknown column mode " + std::to_string(static_cast<int>(mode)) +
+                                 " in the compressed input");
+    }
+  }
+
+  struct Block {
+    std::size_t nPoints = 0;
+    std::string bytes;
+  };
+}  // namespace
+
+namespace eventcodec {
+  bool isCompressed(std::filesystem::path const& file) {
+    std::ifstream in(file, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    return in.read(magic, sizeof(magic)) and std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+  }
+
+  std::string encode(Columns const& event, float quantum, Statistics* statistics) {
+    std::string out;
+    for (auto const& column : event) {
+      encodeColumn(column, quantum, out, statistics);
+    }
+    return out;
+  }
+
+  Columns decode(char const* data, std::size_t size, unsigned int nColumns, std::size_t nPoints) {
+    Columns event(nColumns);
+    char const* end = data + size;
+    for (auto& column : event) {
+      decodeColumn(data, end, nPoints, column);
+    }
+    if (data != end) {
+      throw std::runtime_error("Unexpected bytes at the end of a block in the compressed input");
+    }
+    return event;
+  }
+
+  void readRaw(std::filesystem::path const& file, unsigned int nColumns, std::function<void(Columns&&)> const& f) {
+    std::ifstream in(file, std::ios::binary);
+    std::uint32_t nPoints;
+    std::vector<float> rows;
+    in.exceptions(std::ifstream::badbit);
+    in.read(reinterpret_cast<char*>(&nPoints), sizeof(std::uint32_t));
+    while (not in.eof()) {
+      in.exceptions(std::ifstream::badbit | std::ifstream::failbit | std::ifstream::eofbit);
+      rows.resize(static_cast<std::size_t>(nPoints) * nColumns);
+      in.read(reinterpret_cast<char*>(rows.data()), rows.size() * sizeof(float));
+      Columns event(nColumns, std::vector<float>(nPoints));
+      for (std::size_t i = 0; i < nPoints; ++i) {
+        for (unsigned int c = 0; c < nColumns; ++c) {
+          event[c][i] = rows[i * nColumns + c];
+        }
+      }
+      f(std::move(event));
+
+      // next event
+      in.exceptions(std::ifstream::badbit);
+      in.read(reinterpret_cast<char*>(&nPoints), sizeof(std::uint32_t));
+    }
+  }
+
+  void read(std::filesystem::path const& file, unsigned int nColumns, std::function<void(Columns&&)> const& f) {
+    std::ifstream in(file, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    std::uint32_t columns = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&columns), sizeof(columns));
+    if (not in or std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+      throw std::runtime_error("Input file " + file.string() + " is not a compressed event file");
+    }
+    if (columns != nColumns) {
+      throw std::runtime_error("Input file " + file.string() + " holds " + std::to_string(columns) +
+                               " columns per point instead of " + std::to_string(nColumns));
+    }
+
+    // reading is sequential, the decoding of the blocks is not
+    tbb::parallel_pipeline(
+        4 * tbb::this_task_arena::max_concurrency(),
+        tbb::make_filter<void, std::shared_ptr<Block>>(
+            tbb::filter_mode::serial_in_order,
+            [&in, &file](tbb::flow_control& fc) -> std::shared_ptr<Block> {
+              std::uint32_t header[2];
+              if (not in.read(reinterpret_cast<char*>(header), sizeof(header))) {
+                if (in.gcount() != 0) {
+                  throw std::runtime_error("Truncated block header in " + file.string());
+                }
+                fc.stop();
+                return nullptr;
+              }
+              auto block = std::make_shared<Block>();
+              block->nPoints = header[0];
+              block->bytes.resize(header[1]);
+              if (not in.read(block->bytes.data(), header[1])) {
+                throw std::runtime_error("Truncated block in " + file.string());
+              }
+              return block;
+            }) &
+            tbb::make_filter<std::shared_ptr<Block>, std::shared_ptr<Columns>>(
+                tbb::filter_mode::parallel,
+                [nColumns](std::shared_ptr<Block> const& block) {
+                  return std::make_shared<Columns>(
+                      decode(block->bytes.data(), block->bytes.size(), nColumns, block->nPoints));
+                }) &
+            tbb::make_filter<std::shared_ptr<Columns>, void>(
+                tbb::filter_mode::serial_in_order,
+                [&f](std::shared_ptr<Columns> const& event) { f(std::move(*event)); }));
+  }
+
+  Statistics convert(std::filesystem::path const& input,
+                     std::filesystem::path const& output,
+                     unsigned int nColumns,
+                     float quantum) {
+    std::ofstream out(output, std::ios::binary);
+    out.exceptions(std::ofstream::badbit | std::ofstream::failbit);
+    std::uint32_t const columns = nColumns;
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<char const*>(&columns), sizeof(columns));
+
+    Statistics stats;
+    stats.compressedBytes = sizeof(kMagic) + sizeof(columns);
+    readRaw(input, nColumns, [&](Columns&& event) {
+      std::uint32_t const nPoints = event.empty() ? 0 : event.front().size();
+      std::string const bytes = encode(event, quantum, &stats);
+      std::uint32_t const header[2] = {nPoints, static_cast<std::uint32_t>(bytes.size())};
+      out.write(reinterpret_cast<char const*>(header), sizeof(header));
+      out.write(bytes.data(), bytes.size());
+
+      ++stats.events;
+      stats.points += nPoints;
+      stats.rawBytes += sizeof(std::uint32_t) + nPoints * nColumns * sizeof(float);
+      stats.compressedBytes += sizeof(header) + bytes.size();
+    });
+    return stats;
+  }
+}  // namespace eventcodec
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+#include "EventDispatcher.h"
+
+namespace edm {
+  EventDispatcher::EventDispatcher(DispatchOrder order) : order_{order} {}
+
+  bool EventDispatcher::parse(std::string const& name, DispatchOrder& order) {
+    for (auto candidate :
+         {DispatchOrder::File, DispatchOrder::LargestFirst, DispatchOrder::Interleaved, DispatchOrder::Learned}) {
+      if (name == EventDispatcher::name(candidate)) {
+        order = candidate;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  char const* EventDispatcher::name(DispatchOrder order) {
+    switch (order) {
+      case DispatchOrder::LargestFirst:
+        return "largest";
+      case DispatchOrder::Interleaved:
+        return "interleaved";
+      case DispatchOrder::Learned:
+        return "learned";
+      default:
+        return "file";
+    }
+  }
+
+  void EventDispatcher::setup(std::vector<std::size_t> sizes, int maxEvents) {
+    sizes_ = std::move(sizes);
+    events_ = sizes_.size();
+    if (order_ == DispatchOrder::File or events_ == 0) {
+      return;
+    }
+    int const rest = maxEvents >= 0 ? maxEvents % events_ : 0;
+    firstPass_ = maxEvents >= 0 ? maxEvents / events_ : 0;
+    first_ = arrange(sortBySize(rest));
+    full_ = arrange(sortBySize(events_));
+    seconds_.assign(events_, -1.);
+  }
+
+  void EventDispatcher::start() {
+    std::scoped_lock lock(mutex_);
+    start_ = Clock::now();
+    idle_.clear();
+    inFlight_.clear();
+    passes_.clear();
+  }
+
+  std::vector<int> EventDispatcher::sortBySize(int n) const {
+    std::vector<int> sorted(n);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::stable_sort(sorted.begin(), sorted.end(), [this](int a, int b) { return sizes_[a] > sizes_[b]; });
+    return sorted;
+  }
+
+  std::vector<int> EventDispatcher::sortByTime() const {
+    std::vector<double> predicted(events_);
+    for (int i = 0; i < events_; ++i) {
+      if (seconds_[i] >= 0.) {
+        predicted[i] = seconds_[i];
+      } else if (measuredPoints_ > 0.) {
+        predicted[i] = sizes_[i] * (measuredSeconds_ / measuredPoints_);
+      } else {
+        predicted[i] = sizes_[i];
+      }
+    }
+    std::vector<int> sorted(events_);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::stable_sort(
+        sorted.begin(), sorted.end(), [&predicted](int a, int b) { return predicted[a] > predicted[b]; });
+    return sorted;
+  }
+
+  std::vector<int> EventDispatcher::arrange(std::vector<int> sorted) const {
+    if (order_ != DispatchOrder::Interleaved) {
+      return sorted;
+    }
+    std::vector<int> interleaved;
+    interleaved.reserve(sorted.size());
+    for (std::size_t front = 0, back = sorted.size(); front < back;) {
+      interleaved.push_back(sorted[front++]);
+      if (front < back) {
+        interleaved.push_back(sorted[--back]);
+      }
+    }
+    return interleaved;
+  }
+
+  void EventDispatcher::measure(int streamId, Clock::time_point now) {
+    if (streamId >= static_cast<int>(inFlight_.size()) or inFlight_[streamId].first < 0) {
+      return;
+    }
+    auto const [index, since] = inFlight_[streamId];
+    double const seconds = std::chrono::duration<double>(now - since).count();
+    seconds_[index] = seconds_[index] < 0. ? seconds : 0.5 * (seconds_[index] + seconds);
+    measuredSeconds_ += seconds;
+    measuredPoints_ += sizes_[index];
+    inFlight_[streamId].first = -1;
+  }
+
+  int EventDispatcher::eventNumber(int streamId, int position) {
+    if (order_ == DispatchOrder::File or events_ == 0) {
+      return position + 1;
+    }
+    int const firstSize = first_.size();
+    if (order_ != DispatchOrder::Learned) {
+      if (position < firstSize) {
+        return firstPass_ * events_ + first_[position] + 1;
+      }
+      int const offset = position - firstSize;
+      return offset / events_ * events_ + full_[offset % events_] + 1;
+    }
+
+    auto const now = Clock::now();
+    std::scoped_lock lock(mutex_);
+    measure(streamId, now);
+    int pass = firstPass_;
+    int index;
+    if (position < firstSize) {
+      index = first_[position];
+    } else {
+      int const offset = position - firstSize;
+      pass = offset / events_;
+      auto found = passes_.find(pass);
+      if (found == passes_.end()) {
+        found = passes_.emplace(pass, Pass{sortByTime(), events_}).first;
+      }
+      index = found->second.order[offset % events_];
+      if (--found->second.left == 0) {
+        passes_.erase(found);
+      }
+    }
+    if (streamId >= static_cast<int>(inFlight_.size())) {
+      inFlight_.resize(streamId + 1, {-1, now});
+    }
+    inFlight_[streamId] = {index, now};
+    return pass * events_ + index + 1;
+  }
+
+  void EventDispatcher::outOfEvents(int streamId) {
+    auto const now = Clock::now();
+    std::scoped_lock lock(mutex_);
+    if (order_ == DispatchOrder::Learned) {
+      measure(streamId, now);
+    }
+    if (streamId >= static_cast<int>(idle_.size())) {
+      idle_.resize(streamId + 1, Clock::time_point());
+    }
+    // only the first time counts, a stream may ask again
+    if (idle_[streamId] == Clock::time_point()) {
+      idle_[streamId] = now;
+    }
+  }
+
+  double EventDispatcher::tailSeconds() const {
+    std::scoped_lock lock(mutex_);
+    Clock::time_point first = Clock::time_point::max(), last;
+    for (auto idle : idle_) {
+      if (idle != Clock::time_point()) {
+        first = std::min(first, idle);
+        last = std::max(last, idle);
+      }
+    }
+    return last > first ? std::chrono::duration<double>(last - first).count() : 0.;
+  }
+
+  double EventDispatcher::tailIdleSeconds() const {
+    std::scoped_lock lock(mutex_);
+    Clock::time_point last;
+    for (auto idle : idle_) {
+      last = std::max(last, idle);
+    }
+    double seconds = 0.;
+    for (auto idle : idle_) {
+      if (idle != Clock::time_point()) {
+        seconds += std::chrono::duration<double>(last - idle).count();
+      }
+    }
+    return seconds;
+  }
+
+  void EventDispatcher::report(std::ostream& out) const {
+    int streams = 0;
+    Clock::time_point start, last;
+    {
+      std::scoped_lock lock(mutex_);
+      start = start_;
+      for (auto idle : idle_) {
+        if (idle != Clock::time_point()) {
+          ++streams;
+          last = std::max(last, idle);
+        }
+      }
+    }
+    if (streams == 0) {
+      return;
+    }
+    double const idle = tailIdleSeconds();
+    double const run = std::chrono::duration<double>(last - start).count();
+    auto const flags = out.flags();
+    auto const precision = out.precision();
+    out << "Tail with the " << name(order_) << " dispatch order: the " << streams
+        << " streams ran out of events within the last " << std::scientific << std::setprecision(3) << tailSeconds()
+        << " seconds, and waited idle for " << idle << " seconds in total, " << std::fixed << std::setprecision(1)
+        << (run > 0. ? 100. * idle / (streams * run) : 0.) << "% of their time" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+}  // namespace edm
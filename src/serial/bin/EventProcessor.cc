@@ -13,11 +13,18 @@ namespace edm {
                                  std::vector<std::string> const& esproducers,
                                  std::filesystem::path const& inputFile,
                                  std::filesystem::path const& configFile,
-                                 bool validation) {
+                                 bool validation,
+                                 PileupOverlay const& pileup,
+                                 ColdReplay const& coldReplay,
+                                 DispatchOrder dispatchOrder,
+                                 RunMonitor* monitor,
+                                 bool unscheduled) {
     if (dims == 2)
-      source_ = new Source2D(maxEvents, runForMinutes, registry_, inputFile, validation);
+      source_ = new Source2D(
+          maxEvents, runForMinutes, registry_, inputFile, validation, pileup, coldReplay, dispatchOrder);
     else if (dims == 3)
-      source_ = new Source3D(maxEvents, runForMinutes, registry_, inputFile, validation);
+      source_ = new Source3D(
+          maxEvents, runForMinutes, registry_, inputFile, validation, pileup, coldReplay, dispatchOrder);
     for (auto const& name : esproducers) {
       pluginManager_.load(name);
       if (name == "CLUESerialClusterizerESProducer" or name == "CLUESerialTracksterizerESProducer") {
@@ -31,7 +38,7 @@ namespace edm {
 
     //schedules_.reserve(numberOfStreams);
     for (int i = 0; i < numberOfStreams; ++i) {
-      schedules_.emplace_back(registry_, pluginManager_, source_, &eventSetup_, i, path);
+      schedules_.emplace_back(registry_, pluginManager_, source_, &eventSetup_, i, path, monitor, unscheduled);
     }
   }
 
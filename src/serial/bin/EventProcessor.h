@@ -12,6 +12,8 @@
 #include "Source.h"
 
 namespace edm {
+  class RunMonitor;
+
   class EventProcessor {
   public:
     explicit EventProcessor(int dims,
@@ -22,10 +24,18 @@ namespace edm {
                             std::vector<std::string> const& esproducers,
                             std::filesystem::path const& inputFile,
                             std::filesystem::path const& configFile,
-                            bool validation);
+                            bool validation,
+                            PileupOverlay const& pileup = PileupOverlay(),
+                            ColdReplay const& coldReplay = ColdReplay(),
+                            DispatchOrder dispatchOrder = DispatchOrder::File,
+                            RunMonitor* monitor = nullptr,
+                            bool unscheduled = false);
 
     int maxEvents() const { return source_->maxEvents(); }
     int processedEvents() const { return source_->processedEvents(); }
+    int inputEvents() const { return source_->inputEvents(); }
+    double flushSeconds() const { return source_->flushSeconds(); }
+    EventDispatcher const& dispatcher() const { return source_->dispatcher(); }
 
     void runToCompletion();
 
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
 
 #include "PluginManager.h"
 
@@ -10,6 +11,35 @@
 #define STR_EXPAND(x) #x
 #define STR(x) STR_EXPAND(x)
 
+#ifdef EDM_STATIC_PLUGINS
+namespace edmplugin {
+  // null-terminated list of the plugins linked into the executable,
+  // generated at build time from their DEFINE_FWK_* declarations
+  extern char const* const staticPlugins[];
+
+  PluginManager::PluginManager() {
+    for (auto plugin = staticPlugins; *plugin != nullptr; ++plugin) {
+      pluginToLibrary_[*plugin] = "";
+    }
+  }
+
+  SharedLibrary const& PluginManager::load(std::string const& pluginName) {
+    std::lock_guard<std::recursive_mutex> guard(mutex_);
+
+    if (pluginToLibrary_.find(pluginName) == pluginToLibrary_.end()) {
+      throw std::runtime_error("Plugin " + pluginName + " is not linked into this executable");
+    }
+    // the plugins are already registered, the "library" is the executable itself
+    auto found = loadedPlugins_.find("");
+    if (found == loadedPlugins_.end()) {
+      auto ptr = std::make_shared<SharedLibrary>("");
+      loadedPlugins_[""] = ptr;
+      return *ptr;
+    }
+    return *(found->second);
+  }
+}  // namespace edmplugin
+#else
 namespace edmplugin {
   PluginManager::PluginManager() {
     std::ifstream pluginMap(STR(LIB_DIR) "/plugins.txt");
@@ -34,3 +64,4 @@ namespace edmplugin {
     return *(found->second);
   }
 }  // namespace edmplugin
+#endif
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <malloc.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "RunMonitor.h"
+
+namespace {
+  double residentMegaBytes() {
+    std::ifstream statm("/proc/self/statm");
+    long size = 0, resident = 0;
+    if (not(statm >> size >> resident)) {
+      return 0.;
+    }
+    return static_cast<double>(resident) * sysconf(_SC_PAGESIZE) / (1024. * 1024.);
+  }
+
+  float percentile(std::vector<float> const& sorted, float fraction) {
+    if (sorted.empty()) {
+      return 0.f;
+    }
+    auto index = static_cast<std::size_t>(std::ceil(fraction * sorted.size())) - 1;
+    return sorted[std::min(index, sorted.size() - 1)];
+  }
+}  // namespace
+
+namespace edm {
+  RunMonitor::RunMonitor(double intervalSeconds, std::string const& output, int numberOfStreams)
+      : interval_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(intervalSeconds))),
+        streams_(std::make_unique<StreamStats[]>(numberOfStreams)),
+        numberOfStreams_(numberOfStreams) {
+    if (intervalSeconds <= 0.) {
+      throw std::runtime_error("RunMonitor: the reporting interval must be positive");
+    }
+    if (output.empty() or output == "stderr") {
+      file_ = stderr;
+    } else if (output.rfind("file:", 0) == 0) {
+      auto path = output.substr(5);
+      file_ = std::fopen(path.c_str(), "w");
+      if (file_ == nullptr) {
+        throw std::runtime_error("RunMonitor: cannot open '" + path + "': " + std::strerror(errno));
+      }
+    } else if (output.rfind("unix:", 0) == 0) {
+      auto path = output.substr(5);
+      sockaddr_un address{};
+      if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("RunMonitor: socket path '" + path + "' is too long");
+      }
+      address.sun_family = AF_UNIX;
+      std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+      socket_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (socket_ < 0 or ::connect(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        auto error = std::string(std::strerror(errno));
+        if (socket_ >= 0) {
+          ::close(socket_);
+        }
+        throw std::runtime_error("RunMonitor: cannot connect to '" + path + "': " + error);
+      }
+    } else {
+      throw std::runtime_error("RunMonitor: unknown output '" + output +
+                               "', expected 'stderr', 'file:PATH' or 'unix:PATH'");
+    }
+  }
+
+  RunMonitor::~RunMonitor() {
+    stop();
+    if (file_ != nullptr and file_ != stderr) {
+      std::fclose(file_);
+    }
+    if (socket_ >= 0) {
+      ::close(socket_);
+    }
+  }
+
+  void RunMonitor::start() {
+    startTime_ = std::chrono::steady_clock::now();
+    lastReport_ = startTime_;
+    thread_ = std::thread([this]() { run(); });
+  }
+
+  void RunMonitor::stop() {
+    if (not thread_.joinable()) {
+      return;
+    }
+    {
+      std::scoped_lock lock(stopMutex_);
+      stopRequested_ = true;
+    }
+    stopCondition_.notify_one();
+    thread_.join();
+    // report the last, partial, interval
+    report(std::chrono::steady_clock::now());
+  }
+
+  void RunMonitor::beginEvent(int streamId) { ++streams_[streamId].inFlight; }
+
+  void RunMonitor::endEvent(int streamId, std::chrono::steady_clock::duration latency) {
+    auto& stream = streams_[streamId];
+    {
+      std::scoped_lock lock(stream.latencyMutex);
+      stream.latencies.push_back(std::chrono::duration<float, std::milli>(latency).count());
+    }
+    ++stream.events;
+    --stream.inFlight;
+  }
+
+  void RunMonitor::run() {
+    std::unique_lock lock(stopMutex_);
+    auto next = startTime_ + interval_;
+    while (not stopCondition_.wait_until(lock, next, [this]() { return stopRequested_; })) {
+      lock.unlock();
+      report(std::chrono::steady_clock::now());
+      lock.lock();
+      next += interval_;
+    }
+  }
+
+  void RunMonitor::report(std::chrono::steady_clock::time_point now) {
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(3);
+
+    latencies_.clear();
+    long events = 0;
+    line << "{\"time\": " << std::chrono::duration<double>(now - startTime_).count();
+    line << ", \"interval\": " << std::chrono::duration<double>(now - lastReport_).count();
+    std::ostringstream inFlight, streamEvents;
+    for (int i = 0; i < numberOfStreams_; ++i) {
+      auto& stream = streams_[i];
+      {
+        std::scoped_lock lock(stream.latencyMutex);
+        latencies_.insert(latencies_.end(), stream.latencies.begin(), stream.latencies.end());
+        stream.latencies.clear();
+      }
+      auto streamEventsSoFar = stream.events.load();
+      events += streamEventsSoFar;
+      inFlight << (i == 0 ? "" : ", ") << stream.inFlight.load();
+      streamEvents << (i == 0 ? "" : ", ") << streamEventsSoFar;
+    }
+    auto seconds = std::chrono::duration<double>(now - lastReport_).count();
+    line << ", \"events\": " << (events - lastEvents_);
+    line << ", \"throughput\": " << (seconds > 0. ? (events - lastEvents_) / seconds : 0.);
+    line << ", \"inFlight\": [" << inFlight.str() << "]";
+    line << ", \"streamEvents\": [" << streamEvents.str() << "]";
+
+    std::sort(latencies_.begin(), latencies_.end());
+    line << ", \"latency_ms\": {\"p50\": " << percentile(latencies_, 0.50f)
+         << ", \"p90\": " << percentile(latencies_, 0.90f) << ", \"p99\": " << percentile(latencies_, 0.99f)
+         << ", \"max\": " << (latencies_.empty() ? 0.f : latencies_.back()) << "}";
+
+    line << ", \"rss_mb\": " << residentMegaBytes();
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    // allocator statistics of the glibc malloc
+    auto heap = mallinfo2();
+    constexpr double mb = 1024. * 1024.;
+    line << ", \"heap_mb\": {\"arena\": " << heap.arena / mb << ", \"mmap\": " << heap.hblkhd / mb
+         << ", \"inuse\": " << heap.uordblks / mb << ", \"free\": " << heap.fordblks / mb << "}";
+#endif
+    line << "}\n";
+
+    lastEvents_ = events;
+    lastReport_ = now;
+    write(line.str());
+  }
+
+  void RunMonitor::write(std::string const& line) {
+    if (file_ != nullptr) {
+      std::fputs(line.c_str(), file_);
+      std::fflush(file_);
+    } else if (socket_ >= 0) {
+      // a reader going away must not bring the job down
+      ::send(socket_, line.data(), line.size(), MSG_NOSIGNAL);
+    }
+  }
+}  // namespace edm
@@ -0,0 +1,70 @@
+#ifndef RunMonitor_h
+#define RunMonitor_h
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace edm {
+  // Periodic reporter of the throughput, the in-flight events per
+  // stream, the event latency percentiles, and the process memory
+  // while the job is running.
+  //
+  // Every interval one JSON object is written as a single line to the
+  // output, which is given as
+  //   "stderr"     (default)
+  //   "file:PATH"  JSON-lines file
+  //   "unix:PATH"  connected stream Unix socket
+  class RunMonitor {
+  public:
+    explicit RunMonitor(double intervalSeconds, std::string const& output, int numberOfStreams);
+    ~RunMonitor();
+
+    RunMonitor(RunMonitor const&) = delete;
+    RunMonitor& operator=(RunMonitor const&) = delete;
+
+    void start();
+    void stop();
+
+    // thread safe, called by the StreamSchedule of the stream
+    void beginEvent(int streamId);
+    void endEvent(int streamId, std::chrono::steady_clock::duration latency);
+
+  private:
+    struct alignas(64) StreamStats {
+      std::atomic<int> inFlight = 0;
+      std::atomic<long> events = 0;
+      std::mutex latencyMutex;
+      std::vector<float> latencies;  // ms, since the last report
+    };
+
+    void run();
+    void report(std::chrono::steady_clock::time_point now);
+    void write(std::string const& line);
+
+    std::chrono::steady_clock::duration const interval_;
+    std::unique_ptr<StreamStats[]> streams_;
+    int const numberOfStreams_;
+
+    FILE* file_ = nullptr;
+    int socket_ = -1;
+
+    std::chrono::steady_clock::time_point startTime_;
+    std::chrono::steady_clock::time_point lastReport_;
+    long lastEvents_ = 0;
+    std::vector<float> latencies_;  // scratch for the percentiles
+
+    std::thread thread_;
+    std::mutex stopMutex_;
+    std::condition_variable stopCondition_;
+    bool stopRequested_ = false;
+  };
+}  // namespace edm
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SamplingProfiler_h
+#define SamplingProfiler_h
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+
+struct backtrace_state;
+
+namespace edm {
+  struct ModuleTag;
+
+  // In-process sampling profiler. Between start() and stop() a SIGPROF,
+  // driven by the CPU time of the process (setitimer(ITIMER_PROF)), is
+  // delivered at the given frequency to the thread that is running; its
+  // handler records the call stack of that thread with libbacktrace,
+  // together with the module and stream the thread works for (see
+  // Framework/CurrentModule.h). The samples go into a buffer allocated at
+  // start(), and the ones that do not fit are counted and dropped, so that
+  // the handler never allocates nor locks. The stacks are symbolised only
+  // at the end, from the debug information of the executable and of the
+  // plugins, which must all still be loaded.
+  class SamplingProfiler {
+  public:
+    static constexpr unsigned int kMaxDepth = 48;
+
+    // the buffer of the default size holds about 9 minutes of CPU time
+    explicit SamplingProfiler(int frequency = 250, std::size_t maxSamples = 1 << 17);
+    ~SamplingProfiler();
+
+    SamplingProfiler(SamplingProfiler const&) = delete;
+    SamplingProfiler& operator=(SamplingProfiler const&) = delete;
+
+    // only one profiler can run at a time; throws std::runtime_error if
+    // the timer or the signal handler can not be set up
+    void start();
+    void stop();
+
+    std::size_t samples() const;
+    std::size_t dropped() const { return dropped_; }
+
+    // Writes the stacks in the folded format of flamegraph.pl, one line
+    // per distinct stack with the number of its samples, rooted at the
+    // module ("(framework)" for the samples taken outside of the modules)
+    void writeFolded(std::string const& file) const;
+
+    // prints the share of the samples of each module, and of each stream
+    void report(std::ostream& out) const;
+
+  private:
+    struct Sample {
+      std::atomic<bool> complete;
+      char const* module;
+      int stream;
+      unsigned int depth;
+      std::uintptr_t pcs[kMaxDepth];
+    };
+
+    static void handler(int signal);
+    static int collect(void* data, std::uintptr_t pc);
+    static void error(void* data, char const* message, int errnum);
+
+    // symbolises the samples once, at the first writeFolded() or report()
+    void symbolise() const;
+
+    int const frequency_;
+    std::size_t const maxSamples_;
+    backtrace_state* state_ = nullptr;
+    std::unique_ptr<Sample[]> samples_;
+    std::atomic<std::size_t> next_ = 0;
+    std::atomic<std::size_t> dropped_ = 0;
+    bool running_ = false;
+
+    mutable bool symbolised_ = false;
+    mutable std::map<std::string, std::size_t> folded_;
+    mutable std::map<std::string, std::size_t> modules_;
+    mutable std::map<int, std::size_t> streams_;
+  };
+}  // namespace edm
+
+#endif
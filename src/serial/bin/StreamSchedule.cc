@@ -1,13 +1,16 @@
 //#include <iostream>
+#include <chrono>
 
 #include <tbb/task.h>
 
 #include "Framework/FunctorTask.h"
 #include "Framework/PluginFactory.h"
+#include "Framework/TaskPool.h"
 #include "Framework/WaitingTask.h"
 #include "Framework/Worker.h"
 
 #include "PluginManager.h"
+#include "RunMonitor.h"
 #include "Source.h"
 #include "StreamSchedule.h"
 
@@ -17,25 +20,50 @@ namespace edm {
                                  Source* source,
                                  EventSetup const* eventSetup,
                                  int streamId,
-                                 std::vector<std::string> const& path)
-      : registry_(std::move(reg)), source_(source), eventSetup_(eventSetup), streamId_(streamId) {
+                                 std::vector<std::string> const& path,
+                                 RunMonitor* monitor,
+                                 bool unscheduled)
+      : registry_(std::move(reg)),
+        source_(source),
+        eventSetup_(eventSetup),
+        monitor_(monitor),
+        streamId_(streamId) {
     path_.reserve(path.size());
+    // up to two tasks per module (acquire and produce) and the end of the
+    // event, for the event being processed and the previous one, whose
+    // tasks may not all have been recycled yet, and the task starting the
+    // stream
+    taskPool_ = std::make_unique<TaskPool>(2 * (2 * path.size() + 1) + 1);
+    // the number of doWorkAsync() calls each worker receives per event
+    std::vector<unsigned int> callers(path.size(), 0);
     int modInd = 1;
     for (auto const& name : path) {
       pluginManager.load(name);
       registry_.beginModuleConstruction(modInd);
+      auto const nProducts = registry_.size();
       path_.emplace_back(PluginFactory::create(name, registry_));
+      path_.back()->setTag(name, streamId_);
+      path_.back()->setTaskPool(taskPool_.get());
       //std::cout << "module " << modInd << " " << path_.back().get() << std::endl;
       std::vector<Worker*> consumes;
       for (unsigned int depInd : registry_.consumedModules()) {
         if (depInd != ProductRegistry::kSourceIndex) {
           //std::cout << "module " << modInd << " depends on " << (depInd-1) << " " << path_[depInd-1].get() << std::endl;
           consumes.push_back(path_[depInd - 1].get());
+          ++callers[depInd - 1];
         }
       }
       path_.back()->setItemsToGet(std::move(consumes));
+      bool const producesNothing = registry_.size() == nProducts;
+      if (not unscheduled or producesNothing or modInd == static_cast<int>(path.size())) {
+        scheduled_.push_back(path_.back().get());
+        ++callers[modInd - 1];
+      }
       ++modInd;
     }
+    for (std::size_t i = 0; i < path_.size(); ++i) {
+      path_[i]->reserveWaitingTasks(callers[i]);
+    }
   }
 
   StreamSchedule::~StreamSchedule() = default;
@@ -43,7 +71,7 @@ namespace edm {
   StreamSchedule& StreamSchedule::operator=(StreamSchedule&&) = default;
 
   void StreamSchedule::runToCompletionAsync(WaitingTaskHolder h) {
-    auto task = make_functor_task([this, h]() mutable { processOneEventAsync(std::move(h)); });
+    auto task = make_functor_task(*taskPool_, [this, h]() mutable { processOneEventAsync(std::move(h)); });
     if (streamId_ == 0) {
       h.group()->run([task]() {
         TaskSentry s{task};
@@ -66,9 +94,17 @@ namespace edm {
       //std::cout << "Begin processing event " << event->eventID() << std::endl;
       auto eventPtr = event.get();
       auto* group = h.group();
-      auto nextEventTask =
-          make_waiting_task([this, h = std::move(h), ev = std::move(event)](std::exception_ptr const* iPtr) mutable {
+      std::chrono::steady_clock::time_point begin;
+      if (monitor_) {
+        begin = std::chrono::steady_clock::now();
+        monitor_->beginEvent(streamId_);
+      }
+      auto nextEventTask = make_waiting_task(
+          *taskPool_, [this, h = std::move(h), ev = std::move(event), begin](std::exception_ptr const* iPtr) mutable {
             ev.reset();
+            if (monitor_) {
+              monitor_->endEvent(streamId_, std::chrono::steady_clock::now() - begin);
+            }
             if (iPtr) {
               h.doneWaiting(*iPtr);
             } else {
@@ -83,8 +119,8 @@ namespace edm {
       // all workers have been processed (should not happen though)
       auto nextEventTaskHolder = WaitingTaskHolder(*group, nextEventTask);
 
-      for (auto iWorker = path_.rbegin(); iWorker != path_.rend(); ++iWorker) {
-        //std::cout << "calling doWorkAsync for " << iWorker->get() << " with nextEventTask " << nextEventTask << std::endl;
+      for (auto iWorker = scheduled_.rbegin(); iWorker != scheduled_.rend(); ++iWorker) {
+        //std::cout << "calling doWorkAsync for " << *iWorker << " with nextEventTask " << nextEventTask << std::endl;
         (*iWorker)->doWorkAsync(*eventPtr, *eventSetup_, nextEventTaskHolder);
       }
     } else {
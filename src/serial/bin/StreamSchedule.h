@@ -14,10 +14,16 @@ namespace edmplugin {
 
 namespace edm {
   class EventSetup;
+  class RunMonitor;
   class Source;
+  class TaskPool;
   class Worker;
 
-  // Schedule of modules per stream (concurrent event)
+  // Schedule of modules per stream (concurrent event). When unscheduled,
+  // only the modules that produce nothing (e.g. the output and the
+  // validation) and the last module of the path are started for each
+  // event, and the other ones run only when a started module consumes
+  // their products.
   class StreamSchedule {
   public:
     // copy ProductRegistry per stream
@@ -26,7 +32,9 @@ namespace edm {
                             Source* source,
                             EventSetup const* eventSetup,
                             int streamId,
-                            std::vector<std::string> const& path);
+                            std::vector<std::string> const& path,
+                            RunMonitor* monitor = nullptr,
+                            bool unscheduled = false);
     ~StreamSchedule();
     StreamSchedule(StreamSchedule const&) = delete;
     StreamSchedule& operator=(StreamSchedule const&) = delete;
@@ -44,6 +52,11 @@ namespace edm {
     Source* source_;
     EventSetup const* eventSetup_;
     std::vector<std::unique_ptr<Worker>> path_;
+    // for the tasks of each event, shared by the workers
+    std::unique_ptr<TaskPool> taskPool_;
+    // the workers started for each event
+    std::vector<Worker*> scheduled_;
+    RunMonitor* monitor_;
     int streamId_;
   };
 }  // namespace edm
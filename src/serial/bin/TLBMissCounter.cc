@@ -0,0 +1,92 @@
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "Framework/HugePages.h"
+#include "TLBMissCounter.h"
+
+namespace {
+  // memory of the process backed by transparent huge pages, in kB
+  long anonHugePages() {
+    std::ifstream rollup("/proc/self/smaps_rollup");
+    std::string line;
+    while (std::getline(rollup, line)) {
+      if (line.rfind("AnonHugePages:", 0) == 0) {
+        return std::stol(line.substr(14));
+      }
+    }
+    return -1;
+  }
+}  // namespace
+
+namespace edm {
+  TLBMissCounter::TLBMissCounter() {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+
+  TLBMissCounter::~TLBMissCounter() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  void TLBMissCounter::start() {
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  void TLBMissCounter::stop() {
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+
+  std::uint64_t TLBMissCounter::misses() const {
+    std::uint64_t value = 0;
+    if (fd_ < 0 or read(fd_, &value, sizeof(value)) != sizeof(value)) {
+      return 0;
+    }
+    return value;
+  }
+
+  void TLBMissCounter::report(std::ostream& out, int events) const {
+    auto stats = hugepages::statistics();
+    constexpr double mb = 1024. * 1024.;
+    out << "Huge pages: policy " << hugepages::policyName(hugepages::policy()) << ", " << stats.hugeBytes / mb
+        << " MB explicit, " << stats.advisedBytes / mb << " MB advised";
+    if (stats.fallbacks > 0) {
+      out << " (" << stats.fallbacks << " explicit allocations fell back to advise)";
+    }
+    if (auto thp = anonHugePages(); thp >= 0) {
+      out << ", " << thp / 1024. << " MB backed by transparent huge pages";
+    }
+    out << "\n";
+    if (available()) {
+      auto count = misses();
+      out << "dTLB load misses: " << count;
+      if (events > 0) {
+        out << " (" << static_cast<double>(count) / events << " per event)";
+      }
+    } else {
+      out << "dTLB load misses: not available";
+    }
+    out << std::endl;
+  }
+}  // namespace edm
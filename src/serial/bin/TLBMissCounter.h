@@ -0,0 +1,35 @@
+#ifndef TLBMissCounter_h
+#define TLBMissCounter_h
+
+#include <cstdint>
+#include <ostream>
+
+namespace edm {
+  // Counts the data TLB load misses of the whole process, including the
+  // threads started after its construction, through perf_event_open().
+  // The counter is not available on machines (or VMs) that do not expose
+  // the hardware cache events, or when perf_event_paranoid forbids it.
+  class TLBMissCounter {
+  public:
+    TLBMissCounter();
+    ~TLBMissCounter();
+
+    TLBMissCounter(TLBMissCounter const&) = delete;
+    TLBMissCounter& operator=(TLBMissCounter const&) = delete;
+
+    bool available() const { return fd_ >= 0; }
+
+    void start();
+    void stop();
+    std::uint64_t misses() const;
+
+    // prints the misses per event, and the memory actually backed by
+    // transparent huge pages and the huge page allocation statistics
+    void report(std::ostream& out, int events) const;
+
+  private:
+    int fd_ = -1;
+  };
+}  // namespace edm
+
+#endif
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -12,16 +13,27 @@
 #include <tbb/info.h>
 #include <tbb/task_arena.h>
 
+#include "DataFormats/CLUE3D_config.h"
 #include "DataFormats/CLUE_config.h"
+#include "DataFormats/LayerTilesSerial.h"
+#include "EnergyMeter.h"
+#include "EventCodec.h"
 #include "EventProcessor.h"
+#include "Framework/HugePages.h"
 #include "PosixClockGettime.h"
+#include "RunMonitor.h"
+#include "SamplingProfiler.h"
+#include "TLBMissCounter.h"
 
 namespace {
   void print_help(std::string const& name) {
     std::cout << name
               << "[--dim D] [--numberOfThreads NT] [--numberOfStreams NS] [--maxEvents ME] [--inputFile "
                  "PATH] [--configFile] [--validation] "
-                 "[--empty]\n\n"
+                 "[--empty] [--pileup K] [--pileupDistribution D] [--pileupRotation R] [--pileupSeed S] [--monitorInterval S] "
+                 "[--monitorOutput OUT] [--hugePages P] [--unscheduled] [--compressTo PATH] [--quantum Q] "
+                 "[--coldCache MB] [--coldCacheJitter J] [--coldCacheFlush] [--energy] [--profile PATH] "
+                 "[--profileFrequency HZ] [--dispatchOrder O]\n\n"
               << "Options\n"
               << " --dim   Dimensioinality of the algorithm (default 2 to run CLUE 2D, use 3 to run CLUE 3D)\n"
               << " --numberOfThreads   Number of threads to use (default 1, use 0 to use all CPU cores)\n"
@@ -32,12 +44,101 @@ namespace {
               << " --inputFile         Path to the input file to cluster with CLUE (default is set to "
                  "data/input/raw2D.bin for CLUE 2D and data/input/raw3D.bin for CLUE 3D)'\n"
               << " --configFile        Path to the config file with the parameters (dc, rhoc, outlierDeltaFactor, "
-                 "produceOutput) to run CLUE 2D (default 'config/hgcal_config.csv' in the directory "
-                 "of the executable); not necessary for CLUE 3D\n"
+                 "produceOutput, and optionally approximate, refineMargin, slices, densityKernel, kernelScale, "
+                 "reproducible, neighbourListSize and periodicY) to run CLUE 2D (default 'config/hgcal_config.csv' "
+                 "in the directory of the executable); optional for CLUE 3D, where it holds the densitySchedule "
+                 "('cluster', 'blocked' by default or 'parallel') and optionally reproducible, neighbourListSize, "
+                 "kernel and scale\n"
               << " --validation        Run (rudimentary) validation at the end (CLUE 2D only)\n"
               << " --empty             Ignore all producers (for testing only)\n"
+              << " --unscheduled       Run a producer only when another module consumes its products; the modules "
+                 "that produce nothing and the last one are always run\n"
+              << " --pileup            Overlay K randomly chosen input events in each event, to emulate a higher "
+                 "occupancy (default 0 for disabled; conflicts with --validation)\n"
+              << " --pileupDistribution  Number of overlaid events: 'fixed' K (default), 'poisson' with mean K, or "
+                 "'uniform' between 1 and 2K-1\n"
+              << " --pileupRotation    Randomise each overlaid event: 'none' (default), 'phi' for a rotation around the "
+                 "beam axis, or 'xy' for mirroring in x and y\n"
+              << " --pileupSeed        Seed of the choice of the overlaid events (default 12345)\n"
+              << " --monitorInterval   Report throughput, in-flight events, event latency and memory every S seconds "
+                 "while running (default -1 for disabled)\n"
+              << " --monitorOutput     Where to write the monitoring reports as JSON lines: 'stderr' (default), "
+                 "'file:PATH' or 'unix:PATH' for a listening Unix socket\n"
+              << " --hugePages         Back the input store and the clustering scratch buffers with huge pages: "
+                 "'none', 'advise' for transparent huge pages, or 'explicit' for pre-reserved 2 MB pages falling back "
+                 "to 'advise' (default: not set, same as 'none'); when given, the data TLB misses are reported at the "
+                 "end\n"
+              << " --compressTo        Convert the input file to the compressed format in PATH, report the compression "
+                 "ratio and the decoding throughput, and exit; the compressed files are recognised as inputs\n"
+              << " --quantum           With --compressTo, allow rounding the non-integral values to multiples of Q "
+                 "when it compresses better (default 0 for lossless)\n"
+              << " --coldCache         Replay a pool of MB megabytes ('auto' for twice the last level cache) of replicas "
+                 "of the input events with jittered coordinates, after a reference run replaying the input events "
+                 "alone, and compare the throughputs (default 0 for disabled; conflicts with --validation)\n"
+              << " --coldCacheJitter   Standard deviation of the jitter of the replicas, in cm (default 0.01)\n"
+              << " --coldCacheFlush    With --coldCache, also evict the caches before each event\n"
+              << " --energy            Measure the energy used by the CPU packages and their DRAM with the RAPL "
+                 "counters, and report it with the throughput\n"
+              << " --profile           Sample the call stacks of the threads while running, write them to PATH in the "
+                 "folded format of flamegraph.pl, rooted at the module that was running, and report the share of "
+                 "each module\n"
+              << " --profileFrequency  Samples per second of CPU time with --profile (default 250)\n"
+              << " --dispatchOrder     Order in which the events are handed out to the streams: 'file' (default), "
+                 "'largest' for the events with the most points first, 'interleaved' for the largest events "
+                 "alternated with the smallest, or 'learned' for the longest first, from the time measured on the "
+                 "previous passes over the input (conflicts with --pileup)\n"
               << std::endl;
   }
+
+  double seconds(std::chrono::steady_clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+  // converts input to output, then times reading both back
+  int compress(std::filesystem::path const& input, std::filesystem::path const& output, int dim, float quantum) {
+    unsigned int const nColumns = dim == 2 ? edm::Source2D::kColumns : edm::Source3D::kColumns;
+    eventcodec::Statistics stats;
+    std::vector<eventcodec::Columns> raw;
+    std::chrono::steady_clock::duration rawTime, decodeTime;
+    std::size_t differentEvents = 0;
+    try {
+      stats = eventcodec::convert(input, output, nColumns, quantum);
+      auto start = std::chrono::steady_clock::now();
+      eventcodec::readRaw(input, nColumns, [&raw](eventcodec::Columns&& event) { raw.push_back(std::move(event)); });
+      rawTime = std::chrono::steady_clock::now() - start;
+      std::size_t index = 0;
+      start = std::chrono::steady_clock::now();
+      eventcodec::read(output, nColumns, [&](eventcodec::Columns&& event) {
+        if (event != raw[index++]) {
+          ++differentEvents;
+        }
+      });
+      decodeTime = std::chrono::steady_clock::now() - start;
+    } catch (std::exception& e) {
+      std::cout << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    double const mb = stats.rawBytes / 1e6;
+    std::cout << "Compressed " << stats.events << " events, " << stats.points << " points, from " << stats.rawBytes
+              << " to " << stats.compressedBytes << " bytes (ratio " << std::fixed << std::setprecision(2)
+              << static_cast<double>(stats.rawBytes) / stats.compressedBytes << ")" << std::endl;
+    char const* const modeNames[] = {"raw", "xor", "delta", "run length", "quantised delta", "quantised run length"};
+    std::cout << "Columns stored as";
+    for (std::size_t m = 0; m < stats.modes.size(); ++m) {
+      if (stats.modes[m] > 0) {
+        std::cout << " " << modeNames[m] << " " << stats.modes[m];
+      }
+    }
+    std::cout << std::endl;
+    std::cout << "Reading back: raw " << std::setprecision(1) << mb / seconds(rawTime) << " MB/s, compressed "
+              << mb / seconds(decodeTime) << " MB/s of decoded data" << std::endl;
+    if (differentEvents > 0) {
+      std::cout << differentEvents << " of " << stats.events << " events differ from the input"
+                << (quantum > 0.f ? ", as allowed by the quantum" : "") << std::endl;
+    } else {
+      std::cout << "All the events are identical to the input" << std::endl;
+    }
+    return quantum > 0.f or differentEvents == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -52,6 +153,18 @@ int main(int argc, char** argv) {
   std::filesystem::path configFile;
   bool validation = false;
   bool empty = false;
+  bool unscheduled = false;
+  edm::PileupOverlay pileup;
+  double monitorInterval = -1.;
+  std::string monitorOutput = "stderr";
+  std::unique_ptr<edm::TLBMissCounter> tlbMisses;
+  std::unique_ptr<edm::EnergyMeter> energy;
+  std::string profileFile;
+  int profileFrequency = 250;
+  std::filesystem::path compressTo;
+  float quantum = 0.f;
+  edm::ColdReplay coldReplay;
+  edm::DispatchOrder dispatchOrder = edm::DispatchOrder::File;
   for (auto i = args.begin() + 1, e = args.end(); i != e; ++i) {
     if (*i == "-h" or *i == "--help") {
       print_help(args.front());
@@ -83,8 +196,84 @@ int main(int argc, char** argv) {
       if (fileName.find("toyDetector") != std::string::npos) {
         configFile = std::filesystem::path(args[0]).parent_path() / "config" / "toyDetector_config.csv";
       }
+    } else if (*i == "--unscheduled") {
+      unscheduled = true;
     } else if (*i == "--empty") {
       empty = true;
+    } else if (*i == "--pileup") {
+      ++i;
+      pileup.k = std::stoi(*i);
+    } else if (*i == "--pileupDistribution") {
+      ++i;
+      if (*i == "fixed") {
+        pileup.distribution = edm::PileupOverlay::Distribution::Fixed;
+      } else if (*i == "poisson") {
+        pileup.distribution = edm::PileupOverlay::Distribution::Poisson;
+      } else if (*i == "uniform") {
+        pileup.distribution = edm::PileupOverlay::Distribution::Uniform;
+      } else {
+        std::cout << "Invalid pileup distribution " << *i << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (*i == "--pileupRotation") {
+      ++i;
+      if (*i == "none") {
+        pileup.rotation = edm::PileupOverlay::Rotation::None;
+      } else if (*i == "phi") {
+        pileup.rotation = edm::PileupOverlay::Rotation::Phi;
+      } else if (*i == "xy") {
+        pileup.rotation = edm::PileupOverlay::Rotation::XY;
+      } else {
+        std::cout << "Invalid pileup rotation " << *i << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (*i == "--pileupSeed") {
+      ++i;
+      pileup.seed = std::stoul(*i);
+    } else if (*i == "--monitorInterval") {
+      ++i;
+      monitorInterval = std::stod(*i);
+    } else if (*i == "--monitorOutput") {
+      ++i;
+      monitorOutput = *i;
+    } else if (*i == "--compressTo") {
+      ++i;
+      compressTo = *i;
+    } else if (*i == "--quantum") {
+      ++i;
+      quantum = std::stof(*i);
+    } else if (*i == "--coldCache") {
+      ++i;
+      coldReplay.poolBytes = *i == "auto" ? 2 * edm::ColdReplay::lastLevelCacheBytes() : std::stoul(*i) << 20;
+    } else if (*i == "--coldCacheJitter") {
+      ++i;
+      coldReplay.jitter = std::stof(*i);
+    } else if (*i == "--coldCacheFlush") {
+      coldReplay.flush = true;
+    } else if (*i == "--energy") {
+      energy = std::make_unique<edm::EnergyMeter>();
+    } else if (*i == "--profile") {
+      ++i;
+      profileFile = *i;
+    } else if (*i == "--profileFrequency") {
+      ++i;
+      profileFrequency = std::stoi(*i);
+    } else if (*i == "--dispatchOrder") {
+      ++i;
+      if (not edm::EventDispatcher::parse(*i, dispatchOrder)) {
+        std::cout << "Invalid dispatch order " << *i << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (*i == "--hugePages") {
+      ++i;
+      try {
+        edm::hugepages::setPolicy(edm::hugepages::parsePolicy(*i));
+      } catch (std::invalid_argument& e) {
+        std::cout << e.what() << std::endl;
+        return EXIT_FAILURE;
+      }
+      // before any thread is started, so that all of them are counted
+      tlbMisses = std::make_unique<edm::TLBMissCounter>();
     } else {
       std::cout << "Invalid parameter " << *i << std::endl << std::endl;
       print_help(args.front());
@@ -99,6 +288,23 @@ int main(int argc, char** argv) {
     std::cout << "Got both --maxEvents and --runForMinutes, please give only one of them" << std::endl;
     return EXIT_FAILURE;
   }
+  if (pileup.enabled() and validation) {
+    std::cout << "Got both --pileup and --validation, the overlaid events can not be validated" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (pileup.enabled() and dispatchOrder != edm::DispatchOrder::File) {
+    std::cout << "Got both --pileup and --dispatchOrder, the overlaid events are always handed out in order"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (coldReplay.enabled() and validation) {
+    std::cout << "Got both --coldCache and --validation, the replicas can not be validated" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (coldReplay.flush and not coldReplay.enabled()) {
+    std::cout << "--coldCacheFlush requires --coldCache" << std::endl;
+    return EXIT_FAILURE;
+  }
   if (numberOfThreads == 0) {
     numberOfThreads = tbb::info::default_concurrency();
   }
@@ -115,10 +321,16 @@ int main(int argc, char** argv) {
     std::cout << "Input file '" << inputFile << "' does not exist" << std::endl;
     return EXIT_FAILURE;
   }
+  // Initialize the TBB thread pool, also used to decode compressed inputs
+  tbb::global_control tbb_max_threads{tbb::global_control::max_allowed_parallelism,
+                                      static_cast<std::size_t>(numberOfThreads)};
+  if (not compressTo.empty()) {
+    return compress(inputFile, compressTo, dim, quantum);
+  }
   if ((configFile.empty()) and (dim == 2)) {
     configFile = std::filesystem::path(args[0]).parent_path() / "config" / "hgcal_config.csv";
   }
-  if ((not std::filesystem::exists(configFile)) and (dim == 2)) {
+  if ((not std::filesystem::exists(configFile)) and (dim == 2 or not configFile.empty())) {
     std::cout << "Config file '" << configFile << "' does not exist" << std::endl;
     return EXIT_FAILURE;
   }
@@ -128,22 +340,62 @@ int main(int argc, char** argv) {
   std::vector<std::string> esmodules;
   if (dim == 2) {
     Parameters par;
-    std::ifstream iFile(configFile);
-    std::string value = "";
-    while (getline(iFile, value, ',')) {
-      par.dc = std::stof(value);
-      getline(iFile, value, ',');
-      par.rhoc = std::stof(value);
-      getline(iFile, value, ',');
-      par.outlierDeltaFactor = std::stof(value);
-      getline(iFile, value);
-      par.produceOutput = static_cast<bool>(std::stoi(value));
-    }
-    iFile.close();
+    try {
+      par = readParameters(configFile);
+    } catch (std::invalid_argument& e) {
+      std::cout << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    if ((par.approximate or par.slices > 0) and par.densityKernel != densitykernels::Kernel::Flat) {
+      std::cout << "The approximate and the incremental clustering support only the flat density kernel" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if ((par.approximate or par.slices > 0) and par.neighbourListSize > 0) {
+      std::cout << "The neighbour list is used only by the exact clustering, please unset neighbourListSize in the "
+                   "config file"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    if ((par.approximate or par.slices > 0) and par.periodicY) {
+      std::cout << "The approximate and the incremental clustering support only a non-periodic y" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (par.periodicY and
+        std::max(par.dc, par.outlierDeltaFactor * par.dc) > LayerTilesSerialPeriodicY::yHaloReach) {
+      std::cout << "With a periodic y, dc and outlierDeltaFactor * dc can be at most "
+                << LayerTilesSerialPeriodicY::yHaloReach << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (par.approximate and par.slices > 0) {
+      std::cout << "The approximate and the incremental clustering can not be combined, please set only one of "
+                   "approximate and slices in the config file"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
     std::cerr << "Running CLUE 2D algorithm with the following parameters: \n";
     std::cerr << "dc = " << par.dc << '\n';
     std::cerr << "rhoc = " << par.rhoc << '\n';
     std::cerr << "outlierDeltaFactor = " << par.outlierDeltaFactor << std::endl;
+    if (par.approximate) {
+      std::cerr << "Approximate density, refined within " << par.refineMargin << " * rhoc of rhoc" << std::endl;
+    }
+    if (par.densityKernel != densitykernels::Kernel::Flat) {
+      std::cerr << "Density kernel " << densitykernels::kernelName(par.densityKernel) << " with scale "
+                << par.kernelScale << std::endl;
+    }
+    if (par.reproducible) {
+      std::cerr << "Reproducible (fixed point) density sums" << std::endl;
+    }
+    if (par.neighbourListSize > 0) {
+      std::cerr << "Neighbour list of up to " << par.neighbourListSize << " pairs" << std::endl;
+    }
+    if (par.periodicY) {
+      std::cerr << "Periodic y over [" << LayerTilesConstants::minY << ", " << LayerTilesConstants::maxY << ")"
+                << std::endl;
+    }
+    if (par.slices > 0) {
+      std::cerr << "Incremental clustering of the events fed in " << par.slices << " slices of layers" << std::endl;
+    }
     if (par.produceOutput) {
       std::cerr << "Producing output at the end" << std::endl;
     }
@@ -160,81 +412,217 @@ int main(int argc, char** argv) {
       }
     }
   } else {
-    std::cerr << "Running CLUE 3D algorithm with default parameters\n";
+    Parameters3D par;
+    try {
+      par = readParameters3D(configFile);
+    } catch (std::invalid_argument& e) {
+      std::cout << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cerr << "Running CLUE 3D algorithm with the following parameters: \n";
+    std::cerr << "densitySchedule = " << densityScheduleName(par.densitySchedule) << std::endl;
+    if (par.reproducible) {
+      std::cerr << "Reproducible (fixed point) density sums" << std::endl;
+    }
+    if (par.neighbourListSize > 0) {
+      std::cerr << "Neighbour lists of up to " << par.neighbourListSize << " pairs" << std::endl;
+    }
+    if (par.kernel != densitykernels::Kernel::Flat) {
+      std::cerr << "Density kernel " << densitykernels::kernelName(par.kernel) << " with scale " << par.scale
+                << std::endl;
+    }
     if (not empty) {
       edmodules = {"CLUESerialTracksterizer"};
+      esmodules = {"CLUESerialTracksterizerESProducer"};
       if (validation) {
         std::cerr << "Validation not available for CLUE 3D" << std::endl;
       }
     }
   }
 
+  std::unique_ptr<edm::RunMonitor> monitor;
+  if (monitorInterval > 0.) {
+    try {
+      monitor = std::make_unique<edm::RunMonitor>(monitorInterval, monitorOutput, numberOfStreams);
+    } catch (std::runtime_error& e) {
+      std::cout << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::unique_ptr<edm::SamplingProfiler> profiler;
+  if (not profileFile.empty()) {
+    try {
+      profiler = std::make_unique<edm::SamplingProfiler>(profileFrequency);
+    } catch (std::invalid_argument& e) {
+      std::cout << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Runs the events and the endJob of processor and reports the timing;
+  // returns the wall clock time, or a negative value after an exception.
+  // The monitor, the TLB misses, the energy and the profile follow only
+  // the main run.
+  auto process = [&](edm::EventProcessor& processor, bool main) -> double {
+    if (runForMinutes < 0) {
+      std::cout << "Processing " << processor.maxEvents() << " events, of which " << numberOfStreams
+                << " concurrently, with " << numberOfThreads << " threads." << std::endl;
+    } else {
+      std::cout << "Processing for about " << runForMinutes << " minutes with " << numberOfStreams
+                << " concurrent events and " << numberOfThreads << " threads." << std::endl;
+    }
+
+    // Run work
+    auto cpu_start = PosixClockGettime<CLOCK_PROCESS_CPUTIME_ID>::now();
+    auto start = std::chrono::high_resolution_clock::now();
+    try {
+      tbb::task_arena arena(numberOfThreads);
+      if (main and monitor) {
+        monitor->start();
+      }
+      if (main and tlbMisses) {
+        tlbMisses->start();
+      }
+      if (main and energy) {
+        energy->start();
+      }
+      if (main and profiler) {
+        profiler->start();
+      }
+      arena.execute([&] { processor.runToCompletion(); });
+      if (main and profiler) {
+        profiler->stop();
+      }
+      if (main and energy) {
+        energy->stop();
+      }
+      if (main and tlbMisses) {
+        tlbMisses->stop();
+      }
+      if (main and monitor) {
+        monitor->stop();
+      }
+    } catch (std::runtime_error& e) {
+      std::cout << "\n----------\nCaught std::runtime_error" << std::endl;
+      std::cout << e.what() << std::endl;
+      return -1.;
+    } catch (std::exception& e) {
+      std::cout << "\n----------\nCaught std::exception" << std::endl;
+      std::cout << e.what() << std::endl;
+      return -1.;
+    } catch (...) {
+      std::cout << "\n----------\nCaught exception of unknown type" << std::endl;
+      return -1.;
+    }
+    auto cpu_stop = PosixClockGettime<CLOCK_PROCESS_CPUTIME_ID>::now();
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    // Run endJob
+    try {
+      processor.endJob();
+    } catch (std::runtime_error& e) {
+      std::cout << "\n----------\nCaught std::runtime_error" << std::endl;
+      std::cout << e.what() << std::endl;
+      return -1.;
+    } catch (std::exception& e) {
+      std::cout << "\n----------\nCaught std::exception" << std::endl;
+      std::cout << e.what() << std::endl;
+      return -1.;
+    } catch (...) {
+      std::cout << "\n----------\nCaught exception of unknown type" << std::endl;
+      return -1.;
+    }
+
+    // Work done, report timing
+    auto diff = stop - start;
+    auto time = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(diff).count()) / 1e6;
+    auto cpu_diff = cpu_stop - cpu_start;
+    auto cpu = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(cpu_diff).count()) / 1e6;
+    int const events = processor.processedEvents();
+    // before the throughput, which the scripts read from the last line
+    if (numberOfStreams > 1) {
+      processor.dispatcher().report(std::cout);
+    }
+    std::cout << "Processed " << events << " events in " << std::scientific << std::setprecision(6) << time
+              << " seconds, throughput " << std::defaultfloat << (events / time) << " events/s, CPU usage per thread: "
+              << std::fixed << std::setprecision(1) << (cpu / time / numberOfThreads * 100) << "%" << std::endl;
+    if (main and energy) {
+      energy->report(std::cout, events);
+    }
+    if (main and tlbMisses) {
+      tlbMisses->report(std::cout, events);
+    }
+    if (main and profiler) {
+      profiler->report(std::cout);
+      try {
+        profiler->writeFolded(profileFile);
+      } catch (std::runtime_error& e) {
+        std::cout << e.what() << std::endl;
+        return -1.;
+      }
+    }
+    return time;
+  };
+
   edm::EventProcessor processor(dim,
                                 maxEvents,
                                 runForMinutes,
                                 numberOfStreams,
-                                std::move(edmodules),
-                                std::move(esmodules),
+                                edmodules,
+                                esmodules,
                                 inputFile,
                                 configFile,
-                                validation);
-  if (runForMinutes < 0) {
-    std::cout << "Processing " << processor.maxEvents() << " events, of which " << numberOfStreams
-              << " concurrently, with " << numberOfThreads << " threads." << std::endl;
-  } else {
-    std::cout << "Processing for about " << runForMinutes << " minutes with " << numberOfStreams
-              << " concurrent events and " << numberOfThreads << " threads." << std::endl;
+                                validation,
+                                pileup,
+                                coldReplay,
+                                dispatchOrder,
+                                monitor.get(),
+                                unscheduled);
+  if (pileup.enabled()) {
+    std::cout << "Overlaying " << pileup.k << " input events per event" << std::endl;
   }
-
-  // Initialize he TBB thread pool
-  tbb::global_control tbb_max_threads{tbb::global_control::max_allowed_parallelism,
-                                      static_cast<std::size_t>(numberOfThreads)};
-
-  // Run work
-  auto cpu_start = PosixClockGettime<CLOCK_PROCESS_CPUTIME_ID>::now();
-  auto start = std::chrono::high_resolution_clock::now();
-  try {
-    tbb::task_arena arena(numberOfThreads);
-    arena.execute([&] { processor.runToCompletion(); });
-  } catch (std::runtime_error& e) {
-    std::cout << "\n----------\nCaught std::runtime_error" << std::endl;
-    std::cout << e.what() << std::endl;
-    return EXIT_FAILURE;
-  } catch (std::exception& e) {
-    std::cout << "\n----------\nCaught std::exception" << std::endl;
-    std::cout << e.what() << std::endl;
-    return EXIT_FAILURE;
-  } catch (...) {
-    std::cout << "\n----------\nCaught exception of unknown type" << std::endl;
-    return EXIT_FAILURE;
+  double hotThroughput = 0.;
+  if (coldReplay.enabled()) {
+    // reference run over as many events, replaying the input events alone
+    edm::EventProcessor reference(dim,
+                                  runForMinutes < 0 ? processor.maxEvents() : -1,
+                                  runForMinutes,
+                                  numberOfStreams,
+                                  edmodules,
+                                  esmodules,
+                                  inputFile,
+                                  configFile,
+                                  validation,
+                                  pileup,
+                                  edm::ColdReplay(),
+                                  dispatchOrder,
+                                  nullptr,
+                                  unscheduled);
+    std::cout << "Hot cache reference run" << std::endl;
+    double const time = process(reference, false);
+    if (time < 0.) {
+      return EXIT_FAILURE;
+    }
+    hotThroughput = reference.processedEvents() / time;
+    std::cout << "Cold cache run, replaying a pool of " << processor.inputEvents() << " events" << std::endl;
   }
-  auto cpu_stop = PosixClockGettime<CLOCK_PROCESS_CPUTIME_ID>::now();
-  auto stop = std::chrono::high_resolution_clock::now();
-
-  // Run endJob
-  try {
-    processor.endJob();
-  } catch (std::runtime_error& e) {
-    std::cout << "\n----------\nCaught std::runtime_error" << std::endl;
-    std::cout << e.what() << std::endl;
-    return EXIT_FAILURE;
-  } catch (std::exception& e) {
-    std::cout << "\n----------\nCaught std::exception" << std::endl;
-    std::cout << e.what() << std::endl;
-    return EXIT_FAILURE;
-  } catch (...) {
-    std::cout << "\n----------\nCaught exception of unknown type" << std::endl;
+  double const time = process(processor, true);
+  if (time < 0.) {
     return EXIT_FAILURE;
   }
-
-  // Work done, report timing
-  auto diff = stop - start;
-  auto time = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(diff).count()) / 1e6;
-  auto cpu_diff = cpu_stop - cpu_start;
-  auto cpu = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(cpu_diff).count()) / 1e6;
-  maxEvents = processor.processedEvents();
-  std::cout << "Processed " << maxEvents << " events in " << std::scientific << time << " seconds, throughput "
-            << std::defaultfloat << (maxEvents / time) << " events/s, CPU usage per thread: " << std::fixed
-            << std::setprecision(1) << (cpu / time / numberOfThreads * 100) << "%" << std::endl;
+  if (coldReplay.enabled()) {
+    double const coldThroughput = processor.processedEvents() / time;
+    std::cout << std::fixed << std::setprecision(1) << "Cold cache throughput " << coldThroughput << " events/s, "
+              << 100. * coldThroughput / hotThroughput << "% of the hot cache throughput of " << hotThroughput
+              << " events/s";
+    if (coldReplay.flush) {
+      // the streams flush concurrently, on at most one thread each
+      double const flushTime = processor.flushSeconds() / std::min(numberOfStreams, numberOfThreads);
+      double const throughput = processor.processedEvents() / (time - flushTime);
+      std::cout << "; excluding the " << flushTime << " s spent flushing the caches, " << throughput << " events/s, "
+                << 100. * throughput / hotThroughput << "%";
+    }
+    std::cout << std::endl;
+  }
   return EXIT_SUCCESS;
 }
@@ -1,8 +1,12 @@
 #ifndef CLUEAlgo_Serial_Kernels_h
 #define CLUEAlgo_Serial_Kernels_h
 
+#include "DataFormats/DensityKernels.h"
+#include "DataFormats/DensitySums.h"
 #include "DataFormats/LayerTilesSerial.h"
+#include "DataFormats/NeighbourList.h"
 #include "DataFormats/PointsCloud.h"
+#include "LayerTileSummary.h"
 
 inline float distance(PointsCloudSerial &points, int i, int j) {
   // 2-d distance on the layer
@@ -15,49 +19,208 @@ inline float distance(PointsCloudSerial &points, int i, int j) {
   }
 }
 
-void kernel_compute_histogram(std::array<LayerTilesSerial, NLAYERS> &d_hist, PointsCloudSerial &points) {
+// the same along y as the tiles take it, the shortest way around when y is periodic
+template <int yHalo>
+inline float distance(LayerTilesSerialT<yHalo> const &lt, PointsCloudSerial &points, int i, int j) {
+  if (points.layer[i] == points.layer[j]) {
+    const float dx = points.x[i] - points.x[j];
+    const float dy = lt.deltaY(points.y[i], points.y[j]);
+    return std::sqrt(dx * dx + dy * dy);
+  } else {
+    return std::numeric_limits<float>::max();
+  }
+}
+
+template <int yHalo>
+inline void kernel_compute_histogram(std::array<LayerTilesSerialT<yHalo>, NLAYERS> &d_hist,
+                                     PointsCloudSerial &points) {
   for (unsigned int i = 0; i < points.x.size(); i++) {
     // push index of points into tiles
     d_hist[points.layer[i]].fill(points.x[i], points.y[i], i);
   }
 };
 
-void kernel_calculate_density(std::array<LayerTilesSerial, NLAYERS> &d_hist, PointsCloudSerial &points, float dc) {
+// exact density of point i: weights of its neighbours within dc, itself
+// included, the neighbours' scaled by the density kernel profile, added up
+// in rho_i
+template <int yHalo, typename Kernel = densitykernels::Flat, typename Sum = densitysums::FloatSum>
+inline float density(LayerTilesSerialT<yHalo> &lt,
+                     PointsCloudSerial &points,
+                     unsigned int i,
+                     float dc,
+                     Kernel const &kernel = Kernel(),
+                     Sum rho_i = Sum()) {
+  // get search box
+  std::array<int, 4> search_box = lt.searchBox(points.x[i] - dc, points.x[i] + dc, points.y[i] - dc, points.y[i] + dc);
+
+  // loop over bins in the search box
+  for (int xBin = search_box[0]; xBin < search_box[1] + 1; ++xBin) {
+    for (int yBin = search_box[2]; yBin < search_box[3] + 1; ++yBin) {
+      // get the id of this bin
+      int binId = lt.getGlobalBinByBin(xBin, yBin);
+      // get the size of this bin
+      int binSize = lt[binId].size();
+
+      // iterate inside this bin
+      for (int binIter = 0; binIter < binSize; binIter++) {
+        unsigned int j = lt[binId][binIter];
+        // query N_{dc}(i)
+        float dist_ij = distance(lt, points, i, j);
+        if (dist_ij <= dc) {
+          // sum weights within N_{dc}(i)
+          rho_i.add((i == j ? 1.f : 0.5f * kernel(dist_ij * dist_ij)) * points.weight[j]);
+        }
+      }  // end of interate inside this bin
+    }
+  }  // end of loop over bins in search box
+  return rho_i.result();
+}
+
+template <int yHalo, typename Kernel = densitykernels::Flat, typename Sum = densitysums::FloatSum>
+inline void kernel_calculate_density(std::array<LayerTilesSerialT<yHalo>, NLAYERS> &d_hist,
+                                     PointsCloudSerial &points,
+                                     float dc,
+                                     Kernel const &kernel = Kernel(),
+                                     Sum const &sum = Sum()) {
   // loop over all points
   for (unsigned int i = 0; i < points.x.size(); i++) {
-    LayerTilesSerial &lt = d_hist[points.layer[i]];
+    points.rho[i] = density(d_hist[points.layer[i]], points, i, dc, kernel, sum);
+  }  // end of loop over points
+};
 
-    // get search box
+// Neighbour list stage: the points within radius of each point, on its
+// layer, with their distance, in the order of the tile walks. With radius
+// at least dc and outlierDeltaFactor * dc, the density and the nearest
+// higher can be computed from the list alone. Returns false, leaving the
+// list incomplete, as soon as it would hold more than maxPairs pairs.
+template <int yHalo>
+inline bool kernel_build_neighbour_list(std::array<LayerTilesSerialT<yHalo>, NLAYERS> &d_hist,
+                                        PointsCloudSerial &points,
+                                        float radius,
+                                        std::size_t maxPairs,
+                                        NeighbourList &list) {
+  list.clear();
+  for (unsigned int i = 0; i < points.x.size(); i++) {
+    auto &lt = d_hist[points.layer[i]];
     std::array<int, 4> search_box =
-        lt.searchBox(points.x[i] - dc, points.x[i] + dc, points.y[i] - dc, points.y[i] + dc);
-
-    // loop over bins in the search box
+        lt.searchBox(points.x[i] - radius, points.x[i] + radius, points.y[i] - radius, points.y[i] + radius);
     for (int xBin = search_box[0]; xBin < search_box[1] + 1; ++xBin) {
       for (int yBin = search_box[2]; yBin < search_box[3] + 1; ++yBin) {
-        // get the id of this bin
-        int binId = lt.getGlobalBinByBin(xBin, yBin);
-        // get the size of this bin
-        int binSize = lt[binId].size();
-
-        // iterate inside this bin
-        for (int binIter = 0; binIter < binSize; binIter++) {
-          unsigned int j = lt[binId][binIter];
-          // query N_{dc}(i)
-          float dist_ij = distance(points, i, j);
-          if (dist_ij <= dc) {
-            // sum weights within N_{dc}(i)
-            points.rho[i] += (i == j ? 1.f : 0.5f) * points.weight[j];
+        for (unsigned int j : lt[lt.getGlobalBinByBin(xBin, yBin)]) {
+          float dist_ij = distance(lt, points, i, j);
+          if (dist_ij <= radius) {
+            list.add(j, dist_ij);
           }
-        }  // end of interate inside this bin
+        }
       }
-    }  // end of loop over bins in search box
-  }    // end of loop over points
+    }
+    if (list.size() > maxPairs) {
+      return false;
+    }
+    list.close();
+  }
+  return true;
+};
+
+// same as kernel_calculate_density(), from the neighbour list
+template <typename Kernel = densitykernels::Flat, typename Sum = densitysums::FloatSum>
+inline void kernel_calculate_density_neighbours(NeighbourList const &list,
+                                                PointsCloudSerial &points,
+                                                float dc,
+                                                Kernel const &kernel = Kernel(),
+                                                Sum const &sum = Sum()) {
+  for (unsigned int i = 0; i < points.x.size(); i++) {
+    Sum rho_i = sum;
+    for (unsigned int k = list.offsets[i]; k < list.offsets[i + 1]; ++k) {
+      float dist_ij = list.distances[k];
+      if (dist_ij <= dc) {
+        unsigned int j = list.neighbours[k];
+        rho_i.add((i == j ? 1.f : 0.5f * kernel(dist_ij * dist_ij)) * points.weight[j]);
+      }
+    }
+    points.rho[i] = rho_i.result();
+  }
+};
+
+// same as kernel_calculate_distanceToHigher(), from the neighbour list
+inline void kernel_calculate_distanceToHigher_neighbours(NeighbourList const &list,
+                                                         PointsCloudSerial &points,
+                                                         float outlierDeltaFactor,
+                                                         float dc) {
+  float dm = outlierDeltaFactor * dc;
+  for (unsigned int i = 0; i < points.x.size(); i++) {
+    float delta_i = std::numeric_limits<float>::max();
+    int nearestHigher_i = -1;
+    float rho_i = points.rho[i];
+    for (unsigned int k = list.offsets[i]; k < list.offsets[i + 1]; ++k) {
+      unsigned int j = list.neighbours[k];
+      float dist_ij = list.distances[k];
+      // in the rare case where rho is the same, use detid
+      bool foundHigher = (points.rho[j] > rho_i) || ((points.rho[j] == rho_i) && (j > i));
+      if (foundHigher && dist_ij <= dm && dist_ij < delta_i) {
+        delta_i = dist_ij;
+        nearestHigher_i = j;
+      }
+    }
+    points.delta[i] = delta_i;
+    points.nearestHigher[i] = nearestHigher_i;
+  }
+};
+
+inline void kernel_compute_tile_summary(std::array<LayerTilesSerial, NLAYERS> &d_hist,
+                                        LayerTileSummary &summary,
+                                        PointsCloudSerial &points,
+                                        float dc) {
+  for (unsigned int i = 0; i < points.x.size(); i++) {
+    auto const &lt = d_hist[points.layer[i]];
+    summary.fill(points.layer[i], lt.getXBin(points.x[i]), lt.getYBin(points.y[i]), points.weight[i]);
+  }
+  // up to 3x3 tiles per neighbourhood are cheaper to add up directly
+  if (dc >= LayerTilesConstants::tileSize) {
+    summary.buildSums();
+  }
+};
+
+// Approximate density: the weight of the tiles overlapping the
+// neighbourhood, scaled by the fraction of their area covered by the
+// circle of radius dc, i.e. assuming a uniform density inside the tiles.
+// Since the tiles contain the whole neighbourhood, their weight also
+// bounds the exact density from above. The exact density is computed
+// only for the points whose estimate is within refineMargin * rhoc of
+// rhoc, where the approximation could change the seeds.
+template <typename Sum = densitysums::FloatSum>
+inline void kernel_calculate_density_approx(std::array<LayerTilesSerial, NLAYERS> &d_hist,
+                                            LayerTileSummary &summary,
+                                            PointsCloudSerial &points,
+                                            float dc,
+                                            float rhoc,
+                                            float refineMargin,
+                                            Sum const &sum = Sum()) {
+  constexpr float tileArea = 1.f / (LayerTilesConstants::rX * LayerTilesConstants::rY);
+  float const circleArea = static_cast<float>(M_PI) * dc * dc;
+  for (unsigned int i = 0; i < points.x.size(); i++) {
+    LayerTilesSerial &lt = d_hist[points.layer[i]];
+    std::array<int, 4> search_box =
+        lt.searchBox(points.x[i] - dc, points.x[i] + dc, points.y[i] - dc, points.y[i] + dc);
+    int const nTiles = (search_box[1] - search_box[0] + 1) * (search_box[3] - search_box[2] + 1);
+    float const others = summary.weightInBox(points.layer[i], search_box) - points.weight[i];
+    float const upper = points.weight[i] + 0.5f * others;
+    float const estimate =
+        points.weight[i] + 0.5f * others * std::min(1.f, circleArea / (nTiles * tileArea));
+    if (upper >= rhoc and std::abs(estimate - rhoc) <= refineMargin * rhoc) {
+      points.rho[i] = density(lt, points, i, dc, densitykernels::Flat(), sum);
+    } else {
+      points.rho[i] = estimate;
+    }
+    summary.updateMaxRho(points.layer[i], lt.getGlobalBin(points.x[i], points.y[i]), points.rho[i]);
+  }
 };
 
-void kernel_calculate_distanceToHigher(std::array<LayerTilesSerial, NLAYERS> &d_hist,
-                                       PointsCloudSerial &points,
-                                       float outlierDeltaFactor,
-                                       float dc) {
+template <int yHalo>
+inline void kernel_calculate_distanceToHigher(std::array<LayerTilesSerialT<yHalo>, NLAYERS> &d_hist,
+                                              PointsCloudSerial &points,
+                                              float outlierDeltaFactor,
+                                              float dc) {
   // loop over all points
   float dm = outlierDeltaFactor * dc;
   for (unsigned int i = 0; i < points.x.size(); i++) {
@@ -69,7 +232,7 @@ void kernel_calculate_distanceToHigher(std::array<LayerTilesSerial, NLAYERS> &d_
     float rho_i = points.rho[i];
 
     // get search box
-    LayerTilesSerial &lt = d_hist[points.layer[i]];
+    auto &lt = d_hist[points.layer[i]];
     std::array<int, 4> search_box = lt.searchBox(xi - dm, xi + dm, yi - dm, yi + dm);
 
     // loop over all bins in the search box
@@ -87,7 +250,7 @@ void kernel_calculate_distanceToHigher(std::array<LayerTilesSerial, NLAYERS> &d_
           bool foundHigher = (points.rho[j] > rho_i);
           // in the rare case where rho is the same, use detid
           foundHigher = foundHigher || ((points.rho[j] == rho_i) && (j > i));
-          float dist_ij = distance(points, i, j);
+          float dist_ij = distance(lt, points, i, j);
           if (foundHigher && dist_ij <= dm) {  // definition of N'_{dm}(i)
             // find the nearest point within N'_{dm}(i)
             if (dist_ij < delta_i) {
@@ -105,7 +268,100 @@ void kernel_calculate_distanceToHigher(std::array<LayerTilesSerial, NLAYERS> &d_
   }  // end of loop over points
 };
 
-void kernel_findAndAssign_clusters(PointsCloudSerial &points, float outlierDeltaFactor, float dc, float rhoc) {
+// nearest point of higher density than i in one bin, if nearer than delta_i
+inline void searchHigherInBin(std::pmr::vector<int> const &bin,
+                              PointsCloudSerial &points,
+                              unsigned int i,
+                              float dm,
+                              float &delta_i,
+                              int &nearestHigher_i) {
+  float const rho_i = points.rho[i];
+  for (unsigned int j : bin) {
+    // in the rare case where rho is the same, use detid
+    bool foundHigher = (points.rho[j] > rho_i) || ((points.rho[j] == rho_i) && (j > i));
+    float dist_ij = distance(points, i, j);
+    if (foundHigher && dist_ij <= dm && dist_ij < delta_i) {
+      delta_i = dist_ij;
+      nearestHigher_i = j;
+    }
+  }
+}
+
+// Approximate nearest higher: besides the tile of point i, only the
+// nearest tile whose highest density can make it hold a higher point is
+// searched, instead of all the tiles within outlierDeltaFactor * dc. A
+// nearer higher point can be missed only if it is in a tile that is
+// farther from point i than the searched one.
+inline void kernel_calculate_distanceToHigher_tiled(std::array<LayerTilesSerial, NLAYERS> &d_hist,
+                                                    LayerTileSummary const &summary,
+                                                    PointsCloudSerial &points,
+                                                    float outlierDeltaFactor,
+                                                    float dc) {
+  constexpr float tileWidth = 1.f / LayerTilesConstants::rX;
+  constexpr float tileHeight = 1.f / LayerTilesConstants::rY;
+  // distance from x to the tile bin along one axis; the first and last
+  // tiles also hold the points beyond the edges of the grid
+  auto axisDistance = [](float x, int bin, int nBins, float min, float width) {
+    float const low = bin == 0 ? -std::numeric_limits<float>::max() : min + bin * width;
+    float const high = bin == nBins - 1 ? std::numeric_limits<float>::max() : min + (bin + 1) * width;
+    return std::max({0.f, low - x, x - high});
+  };
+
+  float dm = outlierDeltaFactor * dc;
+  for (unsigned int i = 0; i < points.x.size(); i++) {
+    // default values of delta and nearest higher for i
+    float delta_i = std::numeric_limits<float>::max();
+    int nearestHigher_i = -1;
+    float xi = points.x[i];
+    float yi = points.y[i];
+    float rho_i = points.rho[i];
+    int const layer = points.layer[i];
+
+    // get search box
+    LayerTilesSerial &lt = d_hist[layer];
+    std::array<int, 4> search_box = lt.searchBox(xi - dm, xi + dm, yi - dm, yi + dm);
+
+    // exact search in the tile of i, which most often holds the nearest higher
+    int const ownBin = lt.getGlobalBin(xi, yi);
+    if (summary.maxRho(layer, ownBin) >= rho_i) {
+      searchHigherInBin(lt[ownBin], points, i, dm, delta_i, nearestHigher_i);
+    }
+    // at tile granularity, the nearest other tile that may hold a nearer
+    // higher point, then an exact search only in that tile
+    int nearestBin = -1;
+    float nearestDistance2 = std::min(dm, delta_i) * std::min(dm, delta_i);
+    for (int xBin = search_box[0]; xBin < search_box[1] + 1; ++xBin) {
+      float const dx = axisDistance(xi, xBin, LayerTilesConstants::nColumns, LayerTilesConstants::minX, tileWidth);
+      for (int yBin = search_box[2]; yBin < search_box[3] + 1; ++yBin) {
+        int binId = lt.getGlobalBinByBin(xBin, yBin);
+        // empty tiles have a highest density of 0
+        if (summary.maxRho(layer, binId) < rho_i or binId == ownBin) {
+          continue;
+        }
+        float const dy = axisDistance(yi, yBin, LayerTilesConstants::nRows, LayerTilesConstants::minY, tileHeight);
+        float const dist2 = dx * dx + dy * dy;
+        if (dist2 < nearestDistance2) {
+          nearestDistance2 = dist2;
+          nearestBin = binId;
+        }
+      }
+    }
+    if (nearestBin >= 0) {
+      searchHigherInBin(lt[nearestBin], points, i, dm, delta_i, nearestHigher_i);
+    }
+
+    points.delta[i] = delta_i;
+    points.nearestHigher[i] = nearestHigher_i;
+  }  // end of loop over points
+};
+
+// the followers are collected in the given lists, either the column of the
+// points or a scratch buffer when no consumer reads them
+inline void kernel_findAndAssign_clusters(PointsCloudSerial &points,
+                                          std::vector<std::vector<int>> &followers,
+                                          float outlierDeltaFactor,
+                                          float dc,
+                                          float rhoc) {
   int nClusters = 0;
 
   // find cluster seeds and outlier
@@ -132,18 +388,18 @@ void kernel_findAndAssign_clusters(PointsCloudSerial &points, float outlierDelta
       localStack.push_back(i);
     } else if (!isOutlier) {
       // register as follower at its nearest higher
-      points.followers[points.nearestHigher[i]].push_back(i);
+      followers[points.nearestHigher[i]].push_back(i);
     }
   }
 
   // expend clusters from seeds
   while (!localStack.empty()) {
     int i = localStack.back();
-    auto &followers = points.followers[i];
+    auto &followersOfI = followers[i];
     localStack.pop_back();
 
     // loop over followers
-    for (int j : followers) {
+    for (int j : followersOfI) {
       // pass id from i to a i's follower
       points.clusterIndex[j] = points.clusterIndex[i];
       // push this follower to localStack
@@ -0,0 +1,6 @@
+#include "CLUEAlgoND.h"
+
+template class CLUEAlgoND<1>;
+template class CLUEAlgoND<2>;
+template class CLUEAlgoND<3>;
+template class CLUEAlgoND<4>;
@@ -0,0 +1,55 @@
+#ifndef CLUEAlgo_ND_h
+#define CLUEAlgo_ND_h
+
+#include <array>
+
+#include "DataFormats/PointsCloudND.h"
+#include "DataFormats/TilesND.h"
+#include "CLUEAlgoNDKernels.h"
+
+// CLUE on points in N dimensions, with the same four steps as
+// CLUEAlgoSerial over an N-dimensional grid of tiles instead of a grid
+// per layer; e.g. CLUEAlgoND<3> clusters (x, y, t) points. Bit d of
+// periodicMask makes coordinate d periodic, see TilesND. The tiles
+// should be at least dc wide, and cover the range of the coordinates.
+template <int N, unsigned periodicMask = 0>
+class CLUEAlgoND {
+public:
+  using Point = std::array<float, N>;
+
+  CLUEAlgoND(Point const &min, Point const &max, Point const &tileSize) : hist_(min, max, tileSize) {}
+
+  void makeClusters(PointsCloudND<N> &d_points,
+                    float const &dc,
+                    float const &rhoc,
+                    float const &outlierDeltaFactor,
+                    densitykernels::Kernel const &densityKernel = densitykernels::Kernel::Flat,
+                    float const &kernelScale = 1.f,
+                    bool reproducible = false) {
+    d_points.outResize();
+    kernel_compute_histogram(hist_, d_points);
+    densitykernels::dispatch(densityKernel, kernelScale, [&](auto const &kernel) {
+      densitysums::dispatch(
+          reproducible, [&](auto const &sum) { kernel_calculate_density(hist_, d_points, dc, kernel, sum); });
+    });
+    kernel_calculate_distanceToHigher(hist_, d_points, outlierDeltaFactor, dc);
+    kernel_findAndAssign_clusters(d_points, outlierDeltaFactor, dc, rhoc);
+    hist_.clear();
+  }
+
+private:
+  TilesND<N, periodicMask> hist_;
+};
+
+// compiled once in CLUEAlgoND.cc; the periodic variants are instantiated where used
+extern template class CLUEAlgoND<1>;
+extern template class CLUEAlgoND<2>;
+extern template class CLUEAlgoND<3>;
+extern template class CLUEAlgoND<4>;
+
+using CLUEAlgo1D = CLUEAlgoND<1>;
+using CLUEAlgo2D = CLUEAlgoND<2>;
+using CLUEAlgo3D = CLUEAlgoND<3>;
+using CLUEAlgo4D = CLUEAlgoND<4>;
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef CLUEAlgo_ND_Kernels_h
+#define CLUEAlgo_ND_Kernels_h
+
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "DataFormats/DensityKernels.h"
+#include "DataFormats/DensitySums.h"
+#include "DataFormats/PointsCloudND.h"
+#include "DataFormats/TilesND.h"
+
+template <std::size_t D, int N, unsigned periodicMask>
+inline float squaredDelta(TilesND<N, periodicMask> const &tiles, PointsCloudND<N> const &points, int i, int j) {
+  float const d = tiles.template delta<D>(points.coords[D][i], points.coords[D][j]);
+  return d * d;
+}
+
+template <int N, unsigned periodicMask, std::size_t... D>
+inline float distanceND(TilesND<N, periodicMask> const &tiles,
+                        PointsCloudND<N> const &points,
+                        int i,
+                        int j,
+                        std::index_sequence<D...>) {
+  // unrolled sum of the squared differences, in the order of the coordinates
+  return std::sqrt((... + squaredDelta<D>(tiles, points, i, j)));
+}
+
+template <int N, unsigned periodicMask>
+inline float distanceND(TilesND<N, periodicMask> const &tiles, PointsCloudND<N> const &points, int i, int j) {
+  return distanceND(tiles, points, i, j, std::make_index_sequence<N>{});
+}
+
+template <int N, unsigned periodicMask>
+inline void kernel_compute_histogram(TilesND<N, periodicMask> &d_hist, PointsCloudND<N> const &points) {
+  for (unsigned int i = 0; i < points.weight.size(); i++) {
+    // push index of points into tiles
+    d_hist.fill(points.point(i), i);
+  }
+};
+
+template <int N, unsigned periodicMask, typename Kernel = densitykernels::Flat, typename Sum = densitysums::FloatSum>
+inline void kernel_calculate_density(TilesND<N, periodicMask> const &d_hist,
+                                     PointsCloudND<N> &points,
+                                     float dc,
+                                     Kernel const &kernel = Kernel(),
+                                     Sum const &sum = Sum()) {
+  // loop over all points
+  for (unsigned int i = 0; i < points.weight.size(); i++) {
+    Sum rho_i = sum;
+    // loop over bins in the search box
+    d_hist.forEachBin(d_hist.searchBox(points.point(i), dc), [&](int binId) {
+      for (unsigned int j : d_hist[binId]) {
+        // query N_{dc}(i)
+        float dist_ij = distanceND(d_hist, points, i, j);
+        if (dist_ij <= dc) {
+          // sum weights within N_{dc}(i)
+          rho_i.add((i == j ? 1.f : 0.5f * kernel(dist_ij * dist_ij)) * points.weight[j]);
+        }
+      }
+    });
+    points.rho[i] = rho_i.result();
+  }  // end of loop over points
+};
+
+template <int N, unsigned periodicMask>
+inline void kernel_calculate_distanceToHigher(TilesND<N, periodicMask> const &d_hist,
+                                              PointsCloudND<N> &points,
+                                              float outlierDeltaFactor,
+                                              float dc) {
+  // loop over all points
+  float dm = outlierDeltaFactor * dc;
+  for (unsigned int i = 0; i < points.weight.size(); i++) {
+    // default values of delta and nearest higher for i
+    float delta_i = std::numeric_limits<float>::max();
+    int nearestHigher_i = -1;
+    float rho_i = points.rho[i];
+
+    // loop over all bins in the search box
+    d_hist.forEachBin(d_hist.searchBox(points.point(i), dm), [&](int binId) {
+      for (unsigned int j : d_hist[binId]) {
+        // query N'_{dm}(i); in the rare case where rho is the same, use detid
+        bool foundHigher = (points.rho[j] > rho_i) || ((points.rho[j] == rho_i) && (j > i));
+        float dist_ij = distanceND(d_hist, points, i, j);
+        // find the nearest point within N'_{dm}(i)
+        if (foundHigher && dist_ij <= dm && dist_ij < delta_i) {
+          delta_i = dist_ij;
+          nearestHigher_i = j;
+        }
+      }
+    });
+
+    points.delta[i] = delta_i;
+    points.nearestHigher[i] = nearestHigher_i;
+  }  // end of loop over points
+};
+
+template <int N>
+inline void kernel_findAndAssign_clusters(PointsCloudND<N> &points, float outlierDeltaFactor, float dc, float rhoc) {
+  int nClusters = 0;
+
+  // find cluster seeds and outlier
+  std::vector<int> localStack;
+  // loop over all points
+  for (unsigned int i = 0; i < points.weight.size(); i++) {
+    // initialize clusterIndex
+    points.clusterIndex[i] = -1;
+
+    float deltai = points.delta[i];
+    float rhoi = points.rho[i];
+
+    // determine seed or outlier
+    bool isSeed = (deltai > dc) and (rhoi >= rhoc);
+    bool isOutlier = (deltai > outlierDeltaFactor * dc) and (rhoi < rhoc);
+    if (isSeed) {
+      points.isSeed[i] = 1;
+      points.clusterIndex[i] = nClusters;
+      nClusters++;
+      localStack.push_back(i);
+    } else if (!isOutlier) {
+      // register as follower at its nearest higher
+      points.followers[points.nearestHigher[i]].push_back(i);
+    }
+  }
+
+  // expend clusters from seeds
+  while (!localStack.empty()) {
+    int i = localStack.back();
+    auto &followers = points.followers[i];
+    localStack.pop_back();
+
+    // loop over followers
+    for (int j : followers) {
+      // pass id from i to a i's follower
+      points.clusterIndex[j] = points.clusterIndex[i];
+      // push this follower to localStack
+      localStack.push_back(j);
+    }
+  }
+};
+
+#endif
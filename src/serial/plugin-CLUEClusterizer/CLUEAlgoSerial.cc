@@ -1,10 +1,11 @@
-#include <iostream>
+#include <algorithm>
+
 #include "DataFormats/PointsCloud.h"
 
 #include "CLUEAlgoSerial.h"
 #include "CLUEAlgoKernels.h"
 
-void CLUEAlgoSerial::setup(PointsCloud const &host_pc, PointsCloudSerial &d_points) {
+void CLUEAlgoSerial::setup(PointsCloud const &host_pc, PointsCloudSerial &d_points, bool storeFollowers) {
   // copy input variables
   d_points.x = host_pc.x;
   d_points.y = host_pc.y;
@@ -12,23 +13,127 @@ void CLUEAlgoSerial::setup(PointsCloud const &host_pc, PointsCloudSerial &d_poin
   d_points.weight = host_pc.weight;
 
   // resize output variables
-  d_points.outResize();
+  d_points.outResize(storeFollowers);
+}
+
+std::vector<std::vector<int>> &CLUEAlgoSerial::followers(PointsCloudSerial &d_points, bool storeFollowers) {
+  if (storeFollowers) {
+    return d_points.followers;
+  }
+  // keep the capacity of the lists from the previous events
+  auto const nPoints = d_points.x.size();
+  for (std::size_t i = 0; i < std::min(nPoints, followers_.size()); ++i) {
+    followers_[i].clear();
+  }
+  if (followers_.size() < nPoints) {
+    followers_.resize(nPoints);
+  }
+  return followers_;
+}
+
+template <typename Tiles>
+void CLUEAlgoSerial::makeClustersOn(std::array<Tiles, NLAYERS> &hist,
+                                    PointsCloudSerial &d_points,
+                                    float dc,
+                                    float rhoc,
+                                    float outlierDeltaFactor,
+                                    densitykernels::Kernel densityKernel,
+                                    float kernelScale,
+                                    bool reproducible,
+                                    bool storeFollowers,
+                                    std::size_t neighbourListSize) {
+  kernel_compute_histogram(hist, d_points);
+  // otherwise, or when the list would exceed its size, both steps walk the tiles
+  bool const useNeighbourList =
+      neighbourListSize > 0 and
+      kernel_build_neighbour_list(
+          hist, d_points, std::max(dc, outlierDeltaFactor * dc), neighbourListSize, neighbours_);
+  densitykernels::dispatch(densityKernel, kernelScale, [&](auto const &kernel) {
+    densitysums::dispatch(reproducible, [&](auto const &sum) {
+      if (useNeighbourList) {
+        kernel_calculate_density_neighbours(neighbours_, d_points, dc, kernel, sum);
+      } else {
+        kernel_calculate_density(hist, d_points, dc, kernel, sum);
+      }
+    });
+  });
+  if (useNeighbourList) {
+    kernel_calculate_distanceToHigher_neighbours(neighbours_, d_points, outlierDeltaFactor, dc);
+  } else {
+    kernel_calculate_distanceToHigher(hist, d_points, outlierDeltaFactor, dc);
+  }
+  kernel_findAndAssign_clusters(d_points, followers(d_points, storeFollowers), outlierDeltaFactor, dc, rhoc);
+  for (auto &tiles : hist) {
+    tiles.clear();
+  }
 }
 
 void CLUEAlgoSerial::makeClusters(PointsCloud const &host_pc,
                                   PointsCloudSerial &d_points,
                                   float const &dc,
                                   float const &rhoc,
-                                  float const &outlierDeltaFactor) {
-  setup(host_pc, d_points);
-
-  // calculate rho, delta and find seeds
+                                  float const &outlierDeltaFactor,
+                                  densitykernels::Kernel const &densityKernel,
+                                  float const &kernelScale,
+                                  bool reproducible,
+                                  bool storeFollowers,
+                                  std::size_t neighbourListSize,
+                                  bool periodicY) {
+  setup(host_pc, d_points, storeFollowers);
+  if (periodicY) {
+    if (not periodicHist_) {
+      periodicHist_.reset(makeTiles<LayerTilesSerialPeriodicY>(&pool_, std::make_index_sequence<NLAYERS>{}));
+    }
+    makeClustersOn(*periodicHist_,
+                   d_points,
+                   dc,
+                   rhoc,
+                   outlierDeltaFactor,
+                   densityKernel,
+                   kernelScale,
+                   reproducible,
+                   storeFollowers,
+                   neighbourListSize);
+  } else {
+    makeClustersOn(*hist_,
+                   d_points,
+                   dc,
+                   rhoc,
+                   outlierDeltaFactor,
+                   densityKernel,
+                   kernelScale,
+                   reproducible,
+                   storeFollowers,
+                   neighbourListSize);
+  }
+}
 
+void CLUEAlgoSerial::makeClustersApproximate(PointsCloud const &host_pc,
+                                             PointsCloudSerial &d_points,
+                                             float const &dc,
+                                             float const &rhoc,
+                                             float const &outlierDeltaFactor,
+                                             float const &refineMargin,
+                                             bool reproducible,
+                                             bool storeFollowers) {
+  if (not summary_) {
+    summary_.emplace(&pool_);
+  }
+  auto &summary = *summary_;
+  setup(host_pc, d_points, storeFollowers);
   kernel_compute_histogram(*hist_, d_points);
-  kernel_calculate_density(*hist_, d_points, dc);
-  kernel_calculate_distanceToHigher(*hist_, d_points, outlierDeltaFactor, dc);
-  kernel_findAndAssign_clusters(d_points, outlierDeltaFactor, dc, rhoc);
-
+  kernel_compute_tile_summary(*hist_, summary, d_points, dc);
+  densitysums::dispatch(reproducible, [&](auto const &sum) {
+    kernel_calculate_density_approx(*hist_, summary, d_points, dc, rhoc, refineMargin, sum);
+  });
+  // when the search box spans at most 2x2 tiles, walking all of them is as cheap
+  if (outlierDeltaFactor * dc < LayerTilesConstants::tileSize) {
+    kernel_calculate_distanceToHigher(*hist_, d_points, outlierDeltaFactor, dc);
+  } else {
+    kernel_calculate_distanceToHigher_tiled(*hist_, summary, d_points, outlierDeltaFactor, dc);
+  }
+  kernel_findAndAssign_clusters(d_points, followers(d_points, storeFollowers), outlierDeltaFactor, dc, rhoc);
+  summary.clear();
   for (unsigned int index = 0; index < hist_->size(); ++index) {
     (*hist_)[index].clear();
   }
@@ -1,21 +1,92 @@
 #ifndef CLUEAlgo_Serial_h
 #define CLUEAlgo_Serial_h
 
+#include <array>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "DataFormats/DensityKernels.h"
+#include "DataFormats/NeighbourList.h"
 #include "DataFormats/PointsCloud.h"
 #include "DataFormats/LayerTilesSerial.h"
+#include "Framework/HugePages.h"
+#include "LayerTileSummary.h"
 
 class CLUEAlgoSerial {
 public:
   // constructor
-  CLUEAlgoSerial() { hist_ = new std::array<LayerTilesSerial, NLAYERS>; };
+  CLUEAlgoSerial() : arena_(arenaChunk, edm::hugepages::resource()), pool_(&arena_) {
+    hist_ = makeTiles<LayerTilesSerial>(&pool_, std::make_index_sequence<NLAYERS>{});
+  };
   ~CLUEAlgoSerial() { delete hist_; };
 
-  void makeClusters(PointsCloud const &host_pc, PointsCloudSerial &d_points, float const &dc, float const &rhoc, float const &outlierDeltaFactor);
+  // the density kernel and accumulation are chosen once per event, see
+  // densitykernels::dispatch() and densitysums::dispatch(); without
+  // storeFollowers the followers column of d_points is left empty. With
+  // neighbourListSize > 0 the neighbours are enumerated once for both the
+  // density and the nearest higher, unless there are more pairs than that,
+  // see kernel_build_neighbour_list(). With periodicY, the points are
+  // clustered on the tiles with a periodic y, see LayerTilesSerialT
+  void makeClusters(PointsCloud const &host_pc,
+                    PointsCloudSerial &d_points,
+                    float const &dc,
+                    float const &rhoc,
+                    float const &outlierDeltaFactor,
+                    densitykernels::Kernel const &densityKernel = densitykernels::Kernel::Flat,
+                    float const &kernelScale = 1.f,
+                    bool reproducible = false,
+                    bool storeFollowers = true,
+                    std::size_t neighbourListSize = 0,
+                    bool periodicY = false);
+
+  // approximate density, see kernel_calculate_density_approx()
+  void makeClustersApproximate(PointsCloud const &host_pc,
+                               PointsCloudSerial &d_points,
+                               float const &dc,
+                               float const &rhoc,
+                               float const &outlierDeltaFactor,
+                               float const &refineMargin,
+                               bool reproducible = false,
+                               bool storeFollowers = true);
 
   std::array<LayerTilesSerial, NLAYERS> *hist_;
 
 private:
-  void setup(PointsCloud const &host_pc, PointsCloudSerial &d_points);
+  // the tiles of all the layers live in one arena, grown in chunks of
+  // huge pages; the pool recycles the bin contents between events
+  static constexpr std::size_t arenaChunk = 16 * edm::hugepages::pageSize;
+
+  template <typename Tiles, std::size_t... I>
+  static std::array<Tiles, NLAYERS> *makeTiles(std::pmr::memory_resource *resource, std::index_sequence<I...>) {
+    return new std::array<Tiles, NLAYERS>{{((void)I, Tiles(resource))...}};
+  }
+
+  std::pmr::monotonic_buffer_resource arena_;
+  std::pmr::unsynchronized_pool_resource pool_;
+  // built on the first approximate clustering, as it takes about 12 MB
+  std::optional<LayerTileSummary> summary_;
+  // built on the first clustering with a periodic y
+  std::unique_ptr<std::array<LayerTilesSerialPeriodicY, NLAYERS>> periodicHist_;
+  // reused between events when the followers are not stored in the product
+  std::vector<std::vector<int>> followers_;
+  NeighbourList neighbours_;
+
+  void setup(PointsCloud const &host_pc, PointsCloudSerial &d_points, bool storeFollowers);
+  std::vector<std::vector<int>> &followers(PointsCloudSerial &d_points, bool storeFollowers);
+  template <typename Tiles>
+  void makeClustersOn(std::array<Tiles, NLAYERS> &hist,
+                      PointsCloudSerial &d_points,
+                      float dc,
+                      float rhoc,
+                      float outlierDeltaFactor,
+                      densitykernels::Kernel densityKernel,
+                      float kernelScale,
+                      bool reproducible,
+                      bool storeFollowers,
+                      std::size_t neighbourListSize);
 };
 
 #endif
\ No newline at end of file
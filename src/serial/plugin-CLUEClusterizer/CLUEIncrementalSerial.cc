@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "CLUEIncrementalSerial.h"
+#include "CLUEAlgoKernels.h"
+
+CLUEIncrementalSerial::CLUEIncrementalSerial(float dc, float rhoc, float outlierDeltaFactor, bool reproducible)
+    : dc_(dc),
+      rhoc_(rhoc),
+      outlierDeltaFactor_(outlierDeltaFactor),
+      reproducible_(reproducible),
+      hist_(new std::array<LayerTilesSerial, NLAYERS>) {}
+
+CLUEIncrementalSerial::~CLUEIncrementalSerial() { delete hist_; }
+
+void CLUEIncrementalSerial::reset(float dc, float rhoc, float outlierDeltaFactor, bool reproducible) {
+  dc_ = dc;
+  rhoc_ = rhoc;
+  outlierDeltaFactor_ = outlierDeltaFactor;
+  reproducible_ = reproducible;
+  for (auto &lt : *hist_) {
+    lt.clear();
+  }
+  for (int id = 0; id < static_cast<int>(alive_.size()); ++id) {
+    alive_[id] = 0;
+    parent_[id] = -1;
+    points_.followers[id].clear();
+  }
+  nPoints_ = 0;
+  pending_.clear();
+}
+
+void CLUEIncrementalSerial::insert(int id, float x, float y, int layer, float weight) {
+  if (id >= static_cast<int>(alive_.size())) {
+    auto const size = std::max<std::size_t>(id + 1, 2 * alive_.size());
+    points_.x.resize(size);
+    points_.y.resize(size);
+    points_.layer.resize(size);
+    points_.weight.resize(size);
+    points_.rho.resize(size);
+    points_.delta.resize(size);
+    points_.nearestHigher.resize(size);
+    points_.followers.resize(size);
+    points_.isSeed.resize(size);
+    points_.clusterIndex.resize(size);
+    parent_.resize(size, -1);
+    alive_.resize(size, 0);
+    mark_.resize(size, 0);
+  }
+  pending_.push_back({id, true, x, y, layer, weight});
+}
+
+void CLUEIncrementalSerial::remove(int id) { pending_.push_back({id, false, 0.f, 0.f, 0, 0.f}); }
+
+void CLUEIncrementalSerial::collectNeighbours(int layer, float x, float y, float radius, std::vector<int> &list) {
+  LayerTilesSerial &lt = (*hist_)[layer];
+  std::array<int, 4> search_box = lt.searchBox(x - radius, x + radius, y - radius, y + radius);
+  for (int xBin = search_box[0]; xBin < search_box[1] + 1; ++xBin) {
+    for (int yBin = search_box[2]; yBin < search_box[3] + 1; ++yBin) {
+      for (int j : lt[lt.getGlobalBinByBin(xBin, yBin)]) {
+        // same expression as distance(), so that the neighbourhoods match exactly
+        const float dx = points_.x[j] - x;
+        const float dy = points_.y[j] - y;
+        if (mark_[j] != epoch_ and std::sqrt(dx * dx + dy * dy) <= radius) {
+          mark_[j] = epoch_;
+          list.push_back(j);
+        }
+      }
+    }
+  }
+}
+
+void CLUEIncrementalSerial::update() {
+  if (pending_.empty()) {
+    return;
+  }
+  float const dm = outlierDeltaFactor_ * dc_;
+
+  // apply the changes to the tiles and to the links of the removed points;
+  // the densities within dc of each of them have to be recomputed
+  ++epoch_;
+  densityCandidates_.clear();
+  removed_.clear();
+  for (auto const &change : pending_) {
+    int const id = change.id;
+    if (change.inserted) {
+      points_.x[id] = change.x;
+      points_.y[id] = change.y;
+      points_.layer[id] = change.layer;
+      points_.weight[id] = change.weight;
+      // never equal to a computed density, so that it counts as changed
+      points_.rho[id] = -1.f;
+      points_.delta[id] = std::numeric_limits<float>::max();
+      points_.nearestHigher[id] = -1;
+      points_.isSeed[id] = 0;
+      points_.clusterIndex[id] = -1;
+      alive_[id] = 1;
+      ++nPoints_;
+      (*hist_)[change.layer].insert(change.x, change.y, id);
+      collectNeighbours(change.layer, change.x, change.y, dc_, densityCandidates_);
+    } else if (alive(id)) {
+      Change const position{id, false, points_.x[id], points_.y[id], points_.layer[id], points_.weight[id]};
+      (*hist_)[position.layer].erase(position.x, position.y, id);
+      alive_[id] = 0;
+      --nPoints_;
+      if (parent_[id] >= 0) {
+        auto &siblings = points_.followers[parent_[id]];
+        siblings.erase(std::lower_bound(siblings.begin(), siblings.end(), id));
+        parent_[id] = -1;
+      }
+      // the followers are within dm, so their nearest higher is recomputed
+      for (int j : points_.followers[id]) {
+        parent_[j] = -1;
+      }
+      points_.followers[id].clear();
+      // kept aside, as the id may be inserted again in the same update
+      removed_.push_back(position);
+      collectNeighbours(position.layer, position.x, position.y, dc_, densityCandidates_);
+    }
+  }
+  pending_.clear();
+
+  rhoChanged_.clear();
+  for (int i : densityCandidates_) {
+    if (not alive(i)) {
+      continue;
+    }
+    LayerTilesSerial &lt = (*hist_)[points_.layer[i]];
+    float const rho = reproducible_ ? density(lt, points_, i, dc_, densitykernels::Flat(), densitysums::FixedPointSum())
+                                    : density(lt, points_, i, dc_);
+    if (rho != points_.rho[i]) {
+      points_.rho[i] = rho;
+      rhoChanged_.push_back(i);
+    }
+  }
+
+  // the nearest higher of a point depends on the densities within dm
+  ++epoch_;
+  deltaCandidates_.clear();
+  for (int i : rhoChanged_) {
+    collectNeighbours(points_.layer[i], points_.x[i], points_.y[i], dm, deltaCandidates_);
+  }
+  for (auto const &position : removed_) {
+    collectNeighbours(position.layer, position.x, position.y, dm, deltaCandidates_);
+  }
+  for (int i : deltaCandidates_) {
+    float delta_i = std::numeric_limits<float>::max();
+    int nearestHigher_i = -1;
+    LayerTilesSerial &lt = (*hist_)[points_.layer[i]];
+    float const xi = points_.x[i];
+    float const yi = points_.y[i];
+    std::array<int, 4> search_box = lt.searchBox(xi - dm, xi + dm, yi - dm, yi + dm);
+    for (int xBin = search_box[0]; xBin < search_box[1] + 1; ++xBin) {
+      for (int yBin = search_box[2]; yBin < search_box[3] + 1; ++yBin) {
+        searchHigherInBin(lt[lt.getGlobalBinByBin(xBin, yBin)], points_, i, dm, delta_i, nearestHigher_i);
+      }
+    }
+    points_.delta[i] = delta_i;
+    points_.nearestHigher[i] = nearestHigher_i;
+  }
+
+  // relink the points whose role may have changed, then relabel the
+  // clusters they belong to now; the points they left keep their labels
+  for (int i : deltaCandidates_) {
+    updateRole(i);
+  }
+  ++epoch_;
+  seeds_.clear();
+  for (int i : deltaCandidates_) {
+    int const r = root(i);
+    if (mark_[r] != epoch_) {
+      mark_[r] = epoch_;
+      seeds_.push_back(r);
+    }
+  }
+  for (int r : seeds_) {
+    relabel(r);
+  }
+}
+
+void CLUEIncrementalSerial::updateRole(int i) {
+  float const delta = points_.delta[i];
+  float const rho = points_.rho[i];
+  bool const isSeed = (delta > dc_) and (rho >= rhoc_);
+  bool const isOutlier = (delta > outlierDeltaFactor_ * dc_) and (rho < rhoc_);
+  points_.isSeed[i] = isSeed ? 1 : 0;
+  int const parent = (isSeed or isOutlier) ? -1 : points_.nearestHigher[i];
+  if (parent == parent_[i]) {
+    return;
+  }
+  // the followers are kept sorted, as if they had been registered in id order
+  if (parent_[i] >= 0) {
+    auto &siblings = points_.followers[parent_[i]];
+    siblings.erase(std::lower_bound(siblings.begin(), siblings.end(), i));
+  }
+  if (parent >= 0) {
+    auto &siblings = points_.followers[parent];
+    siblings.insert(std::upper_bound(siblings.begin(), siblings.end(), i), i);
+  }
+  parent_[i] = parent;
+}
+
+int CLUEIncrementalSerial::root(int i) const {
+  // the nearest higher has a higher (density, id), so there are no cycles
+  while (parent_[i] >= 0) {
+    i = parent_[i];
+  }
+  return i;
+}
+
+void CLUEIncrementalSerial::relabel(int r) {
+  int const label = points_.isSeed[r] ? r : -1;
+  stack_.clear();
+  stack_.push_back(r);
+  while (not stack_.empty()) {
+    int const i = stack_.back();
+    stack_.pop_back();
+    points_.clusterIndex[i] = label;
+    for (int j : points_.followers[i]) {
+      stack_.push_back(j);
+    }
+  }
+}
+
+void CLUEIncrementalSerial::fill(PointsCloudSerial &out, bool withFollowers) const {
+  // the position of each point in out, and the number of each seed
+  std::vector<int> index(alive_.size(), -1);
+  std::vector<int> cluster(alive_.size(), -1);
+  int n = 0;
+  int nClusters = 0;
+  for (int id = 0; id < static_cast<int>(alive_.size()); ++id) {
+    if (alive_[id]) {
+      index[id] = n++;
+      if (points_.isSeed[id]) {
+        cluster[id] = nClusters++;
+      }
+    }
+  }
+
+  out.x.clear();
+  out.y.clear();
+  out.layer.clear();
+  out.weight.clear();
+  for (int id = 0; id < static_cast<int>(alive_.size()); ++id) {
+    if (alive_[id]) {
+      out.x.push_back(points_.x[id]);
+      out.y.push_back(points_.y[id]);
+      out.layer.push_back(points_.layer[id]);
+      out.weight.push_back(points_.weight[id]);
+    }
+  }
+  out.outResize(withFollowers);
+  for (int id = 0; id < static_cast<int>(alive_.size()); ++id) {
+    if (not alive_[id]) {
+      continue;
+    }
+    int const i = index[id];
+    out.rho[i] = points_.rho[id];
+    out.delta[i] = points_.delta[id];
+    out.nearestHigher[i] = points_.nearestHigher[id] < 0 ? -1 : index[points_.nearestHigher[id]];
+    out.isSeed[i] = points_.isSeed[id];
+    out.clusterIndex[i] = points_.clusterIndex[id] < 0 ? -1 : cluster[points_.clusterIndex[id]];
+    if (withFollowers) {
+      out.followers[i].clear();
+      for (int j : points_.followers[id]) {
+        out.followers[i].push_back(index[j]);
+      }
+    }
+  }
+}
@@ -0,0 +1,95 @@
+#ifndef CLUEIncremental_Serial_h
+#define CLUEIncremental_Serial_h
+
+#include <array>
+#include <vector>
+
+#include "DataFormats/PointsCloud.h"
+#include "DataFormats/LayerTilesSerial.h"
+
+// CLUE on a set of points that changes by small steps, e.g. the slices of
+// an event delivered by the readout one after the other, or a sliding
+// time window. The points are identified by a non-negative id chosen by
+// the caller (e.g. the index of the hit in the event); insert() and
+// remove() only queue the changes, update() applies them and recomputes
+//  - the density of the points within dc of an inserted or removed point,
+//  - delta and the nearest higher of the points within outlierDeltaFactor
+//    * dc of a point whose density changed, or of a removed point,
+//  - the cluster index of the clusters these points belong to, before or
+//    after the update,
+// so that its cost is proportional to the size of the change and of the
+// clusters it touches rather than to the number of points.
+// After update(), the result is identical to the one of CLUEAlgoSerial
+// on the current points ordered by id, with the same choice of density
+// accumulation (see DataFormats/DensitySums.h).
+class CLUEIncrementalSerial {
+public:
+  CLUEIncrementalSerial(float dc, float rhoc, float outlierDeltaFactor, bool reproducible = false);
+  ~CLUEIncrementalSerial();
+
+  CLUEIncrementalSerial(CLUEIncrementalSerial const &) = delete;
+  CLUEIncrementalSerial &operator=(CLUEIncrementalSerial const &) = delete;
+
+  // remove all the points, and use the given parameters from now on
+  void reset(float dc, float rhoc, float outlierDeltaFactor, bool reproducible = false);
+
+  // the id must not be in use, or must have been removed before the last update()
+  void insert(int id, float x, float y, int layer, float weight);
+  void remove(int id);
+  void update();
+
+  // number of points, as of the last update()
+  int size() const { return nPoints_; }
+
+  // copy the current points and their clustering into out, ordered by id,
+  // with the clusters numbered in the order of the ids of their seeds;
+  // without withFollowers the followers column of out is left empty
+  void fill(PointsCloudSerial &out, bool withFollowers = true) const;
+
+private:
+  struct Change {
+    int id;
+    bool inserted;
+    float x;
+    float y;
+    int layer;
+    float weight;
+  };
+
+  bool alive(int id) const { return id < static_cast<int>(alive_.size()) and alive_[id]; }
+  // add the alive points within radius of (x, y) on the layer to list, once per update
+  void collectNeighbours(int layer, float x, float y, float radius, std::vector<int> &list);
+  void updateRole(int i);
+  int root(int i) const;
+  // set the cluster index of the tree of followers of r
+  void relabel(int r);
+
+  float dc_;
+  float rhoc_;
+  float outlierDeltaFactor_;
+  // fixed point density sums
+  bool reproducible_;
+
+  // indexed by id; the followers are the points whose nearest higher is
+  // the point and that are neither seeds nor outliers, parent_ is the
+  // reverse link (or -1), and clusterIndex holds the id of the seed
+  PointsCloudSerial points_;
+  std::vector<int> parent_;
+  std::vector<char> alive_;
+  int nPoints_ = 0;
+
+  std::array<LayerTilesSerial, NLAYERS> *hist_;
+
+  std::vector<Change> pending_;
+  std::vector<Change> removed_;
+  // points already collected in a list during the current step
+  std::vector<unsigned int> mark_;
+  unsigned int epoch_ = 0;
+  std::vector<int> densityCandidates_;
+  std::vector<int> rhoChanged_;
+  std::vector<int> deltaCandidates_;
+  std::vector<int> seeds_;
+  std::vector<int> stack_;
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include "DataFormats/PointsCloud.h"
 #include "DataFormats/CLUE_config.h"
 #include "CLUEAlgoSerial.h"
+#include "CLUEIncrementalSerial.h"
 
 class CLUESerialClusterizer : public edm::EDProducer {
 public:
@@ -14,11 +15,17 @@ public:
 
 private:
   void produce(edm::Event& iEvent, const edm::EventSetup& iSetup) override;
+  void produceStreaming(PointsCloud const& pc,
+                        Parameters const& par,
+                        PointsCloudSerial& d_points,
+                        bool storeFollowers);
 
   edm::EDGetTokenT<PointsCloud> pointsCloudToken_;
   edm::EDPutTokenT<PointsCloudSerial> clusterToken_;
 
   std::unique_ptr<CLUEAlgoSerial> algo_;
+  std::unique_ptr<CLUEIncrementalSerial> incremental_;
+  std::vector<std::vector<int>> pointsOnLayer_;
 };
 
 CLUESerialClusterizer::CLUESerialClusterizer(edm::ProductRegistry& reg)
@@ -29,10 +36,59 @@ CLUESerialClusterizer::CLUESerialClusterizer(edm::ProductRegistry& reg)
 void CLUESerialClusterizer::produce(edm::Event& event, const edm::EventSetup& eventSetup) {
   auto const& pc = event.get(pointsCloudToken_);
   Parameters const& par = eventSetup.get<Parameters>();
+  // the followers are only needed to assign the clusters, unless a consumer reads them
+  bool const storeFollowers = event.consumedColumns(clusterToken_) & PointsCloudSerial::kFollowers;
   PointsCloudSerial d_points;
-  algo_->makeClusters(pc, d_points, par.dc, par.rhoc, par.outlierDeltaFactor);
+  if (par.slices > 0) {
+    produceStreaming(pc, par, d_points, storeFollowers);
+  } else if (par.approximate) {
+    algo_->makeClustersApproximate(
+        pc, d_points, par.dc, par.rhoc, par.outlierDeltaFactor, par.refineMargin, par.reproducible, storeFollowers);
+  } else {
+    algo_->makeClusters(pc,
+                        d_points,
+                        par.dc,
+                        par.rhoc,
+                        par.outlierDeltaFactor,
+                        par.densityKernel,
+                        par.kernelScale,
+                        par.reproducible,
+                        storeFollowers,
+                        par.neighbourListSize,
+                        par.periodicY);
+  }
 
   event.emplace(clusterToken_, std::move(d_points));
 }
 
+// The points of the event are inserted one slice of layers at a time,
+// updating the clusters after each slice as they would be updated while
+// the rest of the event is still being read out.
+void CLUESerialClusterizer::produceStreaming(PointsCloud const& pc,
+                                             Parameters const& par,
+                                             PointsCloudSerial& d_points,
+                                             bool storeFollowers) {
+  if (not incremental_) {
+    incremental_ = std::make_unique<CLUEIncrementalSerial>(par.dc, par.rhoc, par.outlierDeltaFactor, par.reproducible);
+    pointsOnLayer_.resize(NLAYERS);
+  } else {
+    incremental_->reset(par.dc, par.rhoc, par.outlierDeltaFactor, par.reproducible);
+  }
+  for (auto& points : pointsOnLayer_) {
+    points.clear();
+  }
+  for (unsigned int i = 0; i < pc.x.size(); ++i) {
+    pointsOnLayer_[pc.layer[i]].push_back(i);
+  }
+  for (int slice = 0; slice < par.slices; ++slice) {
+    for (int layer = slice * NLAYERS / par.slices; layer < (slice + 1) * NLAYERS / par.slices; ++layer) {
+      for (int i : pointsOnLayer_[layer]) {
+        incremental_->insert(i, pc.x[i], pc.y[i], layer, pc.weight[i]);
+      }
+    }
+    incremental_->update();
+  }
+  incremental_->fill(d_points, storeFollowers);
+}
+
 DEFINE_FWK_MODULE(CLUESerialClusterizer);
@@ -15,21 +15,7 @@ private:
 };
 
 void CLUESerialClusterizerESProducer::produce(edm::EventSetup& eventSetup) {
-  Parameters par;
-  std::ifstream iFile(data_);
-  std::string value = "";
-  while (getline(iFile, value, ',')) {
-    par.dc = std::stof(value);
-    getline(iFile, value, ',');
-    par.rhoc = std::stof(value);
-    getline(iFile, value, ',');
-    par.outlierDeltaFactor = std::stof(value);
-    getline(iFile, value);
-    par.produceOutput = static_cast<bool>(std::stoi(value));
-  }
-  iFile.close();
-
-  auto parameters = std::make_unique<Parameters>(par);
+  auto parameters = std::make_unique<Parameters>(readParameters(data_));
   eventSetup.put(std::move(parameters));
 }
 
@@ -0,0 +1,129 @@
+#ifndef LayerTileSummary_h
+#define LayerTileSummary_h
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory_resource>
+#include <vector>
+
+#include "DataFormats/LayerTilesConstants.h"
+
+// Per-tile summaries of the points of all the layers, on the same grid
+// as LayerTilesSerial, used by the approximate clustering:
+//  - the sum of the weights of each tile, and its summed-area table, to
+//    get the total weight of any rectangle of tiles in constant time;
+//  - the highest density in each tile, to skip the tiles that can not
+//    contain a point of higher density.
+// The summed-area tables pay off only when the rectangles span many
+// tiles; otherwise weightInBox() adds up the tiles directly. They are
+// built and cleared over the bounding box of the occupied tiles of each
+// layer, the other summaries only over the occupied tiles.
+class LayerTileSummary {
+public:
+  static constexpr int nColumns = LayerTilesConstants::nColumns;
+  static constexpr int nRows = LayerTilesConstants::nRows;
+  static constexpr int nBins = nColumns * nRows;
+  static constexpr int nSums = (nColumns + 1) * (nRows + 1);
+
+  explicit LayerTileSummary(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : weight_(NLAYERS * nBins, 0.f, resource),
+        maxRho_(NLAYERS * nBins, 0.f, resource),
+        sums_(NLAYERS * nSums, 0.f, resource),
+        occupied_(resource) {
+    bounds_.fill(emptyBounds);
+  }
+
+  void fill(int layer, int xBin, int yBin, float weight) {
+    int const index = layer * nBins + xBin + yBin * nColumns;
+    weight_[index] += weight;
+    occupied_.push_back(index);
+    auto& b = bounds_[layer];
+    b[0] = std::min(b[0], xBin);
+    b[1] = std::max(b[1], xBin);
+    b[2] = std::min(b[2], yBin);
+    b[3] = std::max(b[3], yBin);
+  }
+
+  // summed-area tables of the tile weights, to be called after all the fill()s
+  void buildSums() {
+    hasSums_ = true;
+    for (int layer = 0; layer < NLAYERS; ++layer) {
+      auto const& b = bounds_[layer];
+      float* sums = &sums_[layer * nSums];
+      float const* weight = &weight_[layer * nBins];
+      for (int yBin = b[2]; yBin <= b[3]; ++yBin) {
+        float row = 0.f;
+        for (int xBin = b[0]; xBin <= b[1]; ++xBin) {
+          row += weight[xBin + yBin * nColumns];
+          sums[sum(xBin, yBin)] = sums[sum(xBin, yBin - 1)] + row;
+        }
+      }
+    }
+  }
+
+  // total weight of the tiles [xBinMin, xBinMax] x [yBinMin, yBinMax]
+  float weightInBox(int layer, std::array<int, 4> const& box) const {
+    auto const& b = bounds_[layer];
+    int const xMin = std::max(box[0], b[0]);
+    int const xMax = std::min(box[1], b[1]);
+    int const yMin = std::max(box[2], b[2]);
+    int const yMax = std::min(box[3], b[3]);
+    if (xMin > xMax or yMin > yMax) {
+      return 0.f;
+    }
+    if (not hasSums_) {
+      float total = 0.f;
+      for (int yBin = yMin; yBin <= yMax; ++yBin) {
+        for (int xBin = xMin; xBin <= xMax; ++xBin) {
+          total += weight_[layer * nBins + xBin + yBin * nColumns];
+        }
+      }
+      return total;
+    }
+    float const* sums = &sums_[layer * nSums];
+    return sums[sum(xMax, yMax)] - sums[sum(xMin - 1, yMax)] - sums[sum(xMax, yMin - 1)] +
+           sums[sum(xMin - 1, yMin - 1)];
+  }
+
+  void updateMaxRho(int layer, int globalBin, float rho) {
+    auto& value = maxRho_[layer * nBins + globalBin];
+    value = std::max(value, rho);
+  }
+
+  float maxRho(int layer, int globalBin) const { return maxRho_[layer * nBins + globalBin]; }
+
+  void clear() {
+    for (int index : occupied_) {
+      weight_[index] = 0.f;
+      maxRho_[index] = 0.f;
+    }
+    occupied_.clear();
+    for (int layer = 0; layer < NLAYERS; ++layer) {
+      auto& b = bounds_[layer];
+      if (hasSums_) {
+        for (int yBin = b[2]; yBin <= b[3]; ++yBin) {
+          std::fill(&sums_[layer * nSums + sum(b[0], yBin)], &sums_[layer * nSums + sum(b[1], yBin)] + 1, 0.f);
+        }
+      }
+      b = emptyBounds;
+    }
+    hasSums_ = false;
+  }
+
+private:
+  static constexpr std::array<int, 4> emptyBounds = {
+      {std::numeric_limits<int>::max(), -1, std::numeric_limits<int>::max(), -1}};
+
+  // the summed-area table has an extra, always zero, first row and column
+  static int sum(int xBin, int yBin) { return (xBin + 1) + (yBin + 1) * (nColumns + 1); }
+
+  std::pmr::vector<float> weight_;
+  std::pmr::vector<float> maxRho_;
+  std::pmr::vector<float> sums_;
+  std::pmr::vector<int> occupied_;
+  bool hasSums_ = false;
+  std::array<std::array<int, 4>, NLAYERS> bounds_;
+};
+
+#endif
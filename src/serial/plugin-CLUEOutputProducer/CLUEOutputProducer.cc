@@ -20,7 +20,8 @@ private:
   edm::EDGetTokenT<PointsCloudSerial> clustersToken_;
 };
 
-CLUEOutputProducer::CLUEOutputProducer(edm::ProductRegistry& reg) : clustersToken_(reg.consumes<PointsCloudSerial>()) {}
+CLUEOutputProducer::CLUEOutputProducer(edm::ProductRegistry& reg)
+    : clustersToken_(reg.consumes<PointsCloudSerial>(PointsCloudSerial::kAllButFollowers)) {}
 
 void CLUEOutputProducer::produce(edm::Event& event, edm::EventSetup const& eventSetup) {
   auto outDir = eventSetup.get<std::filesystem::path>();
@@ -3,11 +3,23 @@
 
 #include "DataFormats/TICLLayerTile.h"
 #include "DataFormats/ClusterCollection.h"
+#include "DataFormats/DensityKernels.h"
+#include "DataFormats/DensitySums.h"
 #include "DataFormats/Math/deltaR.h"
 #include "DataFormats/Math/deltaPhi.h"
+#include "DataFormats/NeighbourList.h"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <vector>
 
 // all the functions here need to be changed
 
+// the searches below look up to 2 phi bins away, into the ghost columns
+static_assert(TICLLayerTiles::tile_type_t::phiHalo == 0 or TICLLayerTiles::tile_type_t::phiHalo >= 2,
+              "the phi halo of the tiles is narrower than the phi window of the searches");
+
 void KernelComputeHistogram(TICLLayerTiles &d_hist, ClusterCollectionSerialOnLayers &points) {
   for (unsigned int layer = 0; layer < points.size(); layer++) {
     for (unsigned int idxSoAOnLyr = 0; idxSoAOnLyr < points[layer].x.size(); ++idxSoAOnLyr) {
@@ -23,39 +35,151 @@ void KernelComputeHistogramSoA(TICLLayerTiles &d_histSoA, ClusterCollectionSeria
   }
 };
 
+// sibling layers [minLayer, maxLayer] whose clusters contribute to the density of
+// the clusters on layerId, without crossing to the other side of the detector
+inline std::pair<int, int> densitySiblingRange(int layerId, int densitySiblingLayers) {
+  // We need to partition the two sides of the HGCAL detector
+  constexpr int nLayers = TICLLayerTiles::constants_type_t::nLayers;
+  constexpr int lastLayerPerSide = nLayers / 2;
+  int maxLayer = 2 * lastLayerPerSide - 1;
+  int minLayer = 0;
+  if (layerId < lastLayerPerSide) {
+    minLayer = std::max(layerId - densitySiblingLayers, minLayer);
+    maxLayer = std::min(layerId + densitySiblingLayers, lastLayerPerSide - 1);
+  } else {
+    minLayer = std::max(layerId - densitySiblingLayers, lastLayerPerSide);
+    maxLayer = std::min(layerId + densitySiblingLayers, maxLayer);
+  }
+  return {minLayer, maxLayer};
+}
+
+// adds to rho_i, the density of clusterIdxSoA, the contributions of the
+// clusters of currentLayer in the eta-phi window around its bin (etaBin, phiBin)
+template <typename Kernel, typename Sum>
+inline void accumulateDensitySoA(TICLLayerTiles::tile_type_t const &tileOnLayer,
+                                 ClusterCollectionSerial const &points,
+                                 unsigned int clusterIdxSoA,
+                                 int etaBin,
+                                 int phiBin,
+                                 bool onSameLayer,
+                                 int algoVerbosity,
+                                 int densityXYDistanceSqr,
+                                 float kernelDensityFactor,
+                                 bool densityOnSameLayer,
+                                 Kernel const &kernel,
+                                 Sum &rho_i) {
+  constexpr int nEtaBin = TICLLayerTiles::constants_type_t::nEtaBins;
+
+  auto isReachable = [](float r0, float r1, float phi0, float phi1, float delta_sqr) -> bool {
+    // TODO(rovere): import reco::deltaPhi implementation as well
+    auto delta_phi = reco::deltaPhi(phi0, phi1);
+    return (r0 - r1) * (r0 - r1) + r1 * r1 * delta_phi * delta_phi < delta_sqr;
+  };
+  // only evaluated for the kernels with a profile
+  auto distanceSqr = [](float r0, float r1, float phi0, float phi1) -> float {
+    auto delta_phi = reco::deltaPhi(phi0, phi1);
+    return (r0 - r1) * (r0 - r1) + r1 * r1 * delta_phi * delta_phi;
+  };
+  auto distance_debug = [&](float x1, float x2, float y1, float y2) -> float {
+    return sqrt((x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2));
+  };
+
+  if (algoVerbosity > 0) {
+    std::cout << "onSameLayer: " << onSameLayer;
+  }
+  const int etaWindow = 2;
+  const int phiWindow = 2;
+  int etaBinMin = std::max(etaBin - etaWindow, 0);
+  int etaBinMax = std::min(etaBin + etaWindow, nEtaBin - 1);
+  int phiBinMin = phiBin - phiWindow;
+  int phiBinMax = phiBin + phiWindow;
+  if (algoVerbosity > 0) {
+    std::cout << "eta: " << points.eta[clusterIdxSoA] << std::endl;
+    std::cout << "phi: " << points.phi[clusterIdxSoA] << std::endl;
+    std::cout << "etaBinMin: " << etaBinMin << ", etaBinMax: " << etaBinMax << std::endl;
+    std::cout << "phiBinMin: " << phiBinMin << ", phiBinMax: " << phiBinMax << std::endl;
+  }
+  for (int ieta = etaBinMin; ieta <= etaBinMax; ++ieta) {
+    for (int iphi_it = phiBinMin; iphi_it <= phiBinMax; ++iphi_it) {
+      int bin = tileOnLayer.searchBin(ieta, iphi_it);
+      if (algoVerbosity > 0) {
+        std::cout << "iphi: " << iphi_it << std::endl;
+        std::cout << "Entries in tileBin: " << tileOnLayer[bin].size() << std::endl;
+      }
+      for (auto otherClusterIdx : tileOnLayer[bin]) {
+        if (algoVerbosity > 0) {
+          std::cout << "OtherSoaIDX: " << otherClusterIdx << std::endl;
+          std::cout << "OtherEta: " << points.eta[otherClusterIdx] << std::endl;
+          std::cout << "OtherPhi: " << points.phi[otherClusterIdx] << std::endl;
+        }
+        bool reachable = false;
+        // Still differentiate between silicon and Scintillator.
+        // Silicon has yet to be studied further.
+        if (points.isSilicon[clusterIdxSoA]) {
+          reachable = isReachable(points.r_over_absz[clusterIdxSoA] * points.z[clusterIdxSoA],
+                                  points.r_over_absz[otherClusterIdx] * points.z[clusterIdxSoA],
+                                  points.phi[clusterIdxSoA],
+                                  points.phi[otherClusterIdx],
+                                  densityXYDistanceSqr);
+        } else {
+          reachable = isReachable(points.r_over_absz[clusterIdxSoA] * points.z[clusterIdxSoA],
+                                  points.r_over_absz[otherClusterIdx] * points.z[clusterIdxSoA],
+                                  points.phi[clusterIdxSoA],
+                                  points.phi[otherClusterIdx],
+                                  points.radius[clusterIdxSoA] * points.radius[clusterIdxSoA]);
+        }
+        if (algoVerbosity > 0) {
+          std::cout << "Distance[eta,phi]: "
+                    << reco::deltaR2(points.eta[clusterIdxSoA],
+                                     points.phi[clusterIdxSoA],
+                                     points.eta[otherClusterIdx],
+                                     points.phi[otherClusterIdx])
+                    << std::endl;
+          auto dist = distance_debug(points.r_over_absz[clusterIdxSoA],
+                                     points.r_over_absz[otherClusterIdx],
+                                     points.r_over_absz[clusterIdxSoA] * std::abs(points.phi[clusterIdxSoA]),
+                                     points.r_over_absz[otherClusterIdx] * std::abs(points.phi[otherClusterIdx]));
+          std::cout << "Distance[cm]: " << (dist * points.z[clusterIdxSoA]) << std::endl;
+          std::cout << "Energy Other:   " << points.energy[otherClusterIdx] << std::endl;
+          std::cout << "Cluster radius: " << points.radius[clusterIdxSoA] << std::endl;
+        }
+        if (reachable) {
+          float factor_same_layer_different_cluster = (onSameLayer && !densityOnSameLayer) ? 0.f : 1.f;
+          if constexpr (Kernel::usesDistance) {
+            factor_same_layer_different_cluster *=
+                kernel(distanceSqr(points.r_over_absz[clusterIdxSoA] * points.z[clusterIdxSoA],
+                                   points.r_over_absz[otherClusterIdx] * points.z[clusterIdxSoA],
+                                   points.phi[clusterIdxSoA],
+                                   points.phi[otherClusterIdx]));
+          }
+          auto energyToAdd = ((clusterIdxSoA == otherClusterIdx)
+                                  ? 1.f
+                                  : kernelDensityFactor * factor_same_layer_different_cluster) *
+                             points.energy[otherClusterIdx];
+          rho_i.add(energyToAdd);
+          if (algoVerbosity > 0) {
+            std::cout << "Adding " << energyToAdd << " partial " << rho_i.result() << std::endl;
+          }
+        }
+      }  // end of loop on possible compatible clusters
+    }    // end of loop over phi-bin region
+  }      // end of loop over eta-bin region
+}
+
+template <typename Kernel = densitykernels::Flat, typename Sum = densitysums::FloatSum>
 void KernelCalculateDensitySoA(TICLLayerTiles &d_hist,
                                ClusterCollectionSerial &points,
                                int algoVerbosity = 0,
                                int densitySiblingLayers = 3,
                                int densityXYDistanceSqr = 3.24,
                                float kernelDensityFactor = 0.2,
-                               bool densityOnSameLayer = false) {
-  constexpr int nEtaBin = TICLLayerTiles::constants_type_t::nEtaBins;
-  constexpr int nPhiBin = TICLLayerTiles::constants_type_t::nPhiBins;
-  constexpr int nLayers = TICLLayerTiles::constants_type_t::nLayers;
+                               bool densityOnSameLayer = false,
+                               Kernel const &kernel = Kernel(),
+                               Sum const &sum = Sum()) {
   for (unsigned int clusterIdxSoA = 0; clusterIdxSoA < points.x.size(); ++clusterIdxSoA) {
     int layerId = points.layer[clusterIdxSoA];
-
-    auto isReachable = [](float r0, float r1, float phi0, float phi1, float delta_sqr) -> bool {
-      // TODO(rovere): import reco::deltaPhi implementation as well
-      auto delta_phi = reco::deltaPhi(phi0, phi1);
-      return (r0 - r1) * (r0 - r1) + r1 * r1 * delta_phi * delta_phi < delta_sqr;
-    };
-    auto distance_debug = [&](float x1, float x2, float y1, float y2) -> float {
-      return sqrt((x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2));
-    };
-
-    // We need to partition the two sides of the HGCAL detector
-    constexpr int lastLayerPerSide = nLayers / 2;
-    int maxLayer = 2 * lastLayerPerSide - 1;
-    int minLayer = 0;
-    if (layerId < lastLayerPerSide) {
-      minLayer = std::max(layerId - densitySiblingLayers, minLayer);
-      maxLayer = std::min(layerId + densitySiblingLayers, lastLayerPerSide - 1);
-    } else {
-      minLayer = std::max(layerId - densitySiblingLayers, lastLayerPerSide);
-      maxLayer = std::min(layerId + densitySiblingLayers, maxLayer);
-    }
+    auto [minLayer, maxLayer] = densitySiblingRange(layerId, densitySiblingLayers);
+    Sum rho_i = sum;
 
     for (int currentLayer = minLayer; currentLayer <= maxLayer; currentLayer++) {
       if (algoVerbosity > 0) {
@@ -63,103 +187,105 @@ void KernelCalculateDensitySoA(TICLLayerTiles &d_hist,
         std::cout << "NextLayer: " << currentLayer;
       }
       const auto &tileOnLayer = d_hist[currentLayer];
-      bool onSameLayer = (currentLayer == layerId);
-      if (algoVerbosity > 0) {
-        std::cout << "onSameLayer: " << onSameLayer;
-      }
-      const int etaWindow = 2;
-      const int phiWindow = 2;
-      int etaBinMin = std::max(tileOnLayer.etaBin(points.eta[clusterIdxSoA]) - etaWindow, 0);
-      int etaBinMax = std::min(tileOnLayer.etaBin(points.eta[clusterIdxSoA]) + etaWindow, nEtaBin);
-      int phiBinMin = tileOnLayer.phiBin(points.phi[clusterIdxSoA]) - phiWindow;
-      int phiBinMax = tileOnLayer.phiBin(points.phi[clusterIdxSoA]) + phiWindow;
-      if (algoVerbosity > 0) {
-        std::cout << "eta: " << points.eta[clusterIdxSoA] << std::endl;
-        std::cout << "phi: " << points.phi[clusterIdxSoA] << std::endl;
-        std::cout << "etaBinMin: " << etaBinMin << ", etaBinMax: " << etaBinMax << std::endl;
-        std::cout << "phiBinMin: " << phiBinMin << ", phiBinMax: " << phiBinMax << std::endl;
-      }
-      for (int ieta = etaBinMin; ieta <= etaBinMax; ++ieta) {
-        auto offset = ieta * nPhiBin;
-        if (algoVerbosity > 0) {
-          std::cout << "offset: " << offset << std::endl;
-        }
-        for (int iphi_it = phiBinMin; iphi_it <= phiBinMax; ++iphi_it) {
-          int iphi = ((iphi_it % nPhiBin + nPhiBin) % nPhiBin);
-          if (algoVerbosity > 0) {
-            std::cout << "iphi: " << iphi << std::endl;
-            std::cout << "Entries in tileBin: " << tileOnLayer[offset + iphi].size() << std::endl;
-          }
-          for (auto otherClusterIdx : tileOnLayer[offset + iphi]) {
-            //              auto const &clustersLayer = points[currentLayer];
-            if (algoVerbosity > 0) {
-              std::cout << "OtherLayer: " << currentLayer << " SoaIDX: " << otherClusterIdx << std::endl;
-              std::cout << "OtherEta: " << points.eta[otherClusterIdx] << std::endl;
-              std::cout << "OtherPhi: " << points.phi[otherClusterIdx] << std::endl;
-            }
-            bool reachable = false;
-            // Still differentiate between silicon and Scintillator.
-            // Silicon has yet to be studied further.
-            if (points.isSilicon[clusterIdxSoA]) {
-              reachable = isReachable(points.r_over_absz[clusterIdxSoA] * points.z[clusterIdxSoA],
-                                      points.r_over_absz[otherClusterIdx] * points.z[clusterIdxSoA],
-                                      points.phi[clusterIdxSoA],
-                                      points.phi[otherClusterIdx],
-                                      densityXYDistanceSqr);
-            } else {
-              reachable = isReachable(points.r_over_absz[clusterIdxSoA] * points.z[clusterIdxSoA],
-                                      points.r_over_absz[otherClusterIdx] * points.z[clusterIdxSoA],
-                                      points.phi[clusterIdxSoA],
-                                      points.phi[otherClusterIdx],
-                                      points.radius[clusterIdxSoA] * points.radius[clusterIdxSoA]);
-            }
-            if (algoVerbosity > 0) {
-              std::cout << "Distance[eta,phi]: "
-                        << reco::deltaR2(points.eta[clusterIdxSoA],
-                                         points.phi[clusterIdxSoA],
-                                         points.eta[otherClusterIdx],
-                                         points.phi[otherClusterIdx])
-                        << std::endl;
-              auto dist = distance_debug(points.r_over_absz[clusterIdxSoA],
-                                         points.r_over_absz[otherClusterIdx],
-                                         points.r_over_absz[clusterIdxSoA] * std::abs(points.phi[clusterIdxSoA]),
-                                         points.r_over_absz[otherClusterIdx] * std::abs(points.phi[otherClusterIdx]));
-              std::cout << "Distance[cm]: " << (dist * points.z[clusterIdxSoA]) << std::endl;
-              std::cout << "Energy Other:   " << points.energy[otherClusterIdx] << std::endl;
-              std::cout << "Cluster radius: " << points.radius[clusterIdxSoA] << std::endl;
-            }
-            if (reachable) {
-              float factor_same_layer_different_cluster = (onSameLayer && !densityOnSameLayer) ? 0.f : 1.f;
-              auto energyToAdd =
-                  ((clusterIdxSoA == otherClusterIdx) ? 1.f
-                                                      : kernelDensityFactor * factor_same_layer_different_cluster) *
-                  points.energy[otherClusterIdx];
-              points.rho[clusterIdxSoA] += energyToAdd;
-              if (algoVerbosity > 0) {
-                std::cout << "Adding " << energyToAdd << " partial " << points.rho[clusterIdxSoA] << std::endl;
-              }
-            }
-          }  // end of loop on possible compatible clusters
-        }    // end of loop over phi-bin region
-      }      // end of loop over eta-bin region
-    }        // end of loop on the sibling layers
+      accumulateDensitySoA(tileOnLayer,
+                           points,
+                           clusterIdxSoA,
+                           tileOnLayer.etaBin(points.eta[clusterIdxSoA]),
+                           tileOnLayer.phiBin(points.phi[clusterIdxSoA]),
+                           currentLayer == layerId,
+                           algoVerbosity,
+                           densityXYDistanceSqr,
+                           kernelDensityFactor,
+                           densityOnSameLayer,
+                           kernel,
+                           rho_i);
+    }  // end of loop on the sibling layers
+    points.rho[clusterIdxSoA] = rho_i.result();
+  }
+}
+
+// Orders the clusters by layer and by eta-phi bin within the layer, keeping
+// the index order within a bin; the clusters of layer L end up in
+// [layerOffsets[L], layerOffsets[L + 1]) of clustersByBin.
+inline void KernelSortByBinSoA(TICLLayerTiles const &d_hist,
+                               ClusterCollectionSerial const &points,
+                               std::vector<unsigned int> &clustersByBin,
+                               std::vector<int> &layerOffsets) {
+  using Constants = TICLLayerTiles::constants_type_t;
+  constexpr int nBinsPerLayer = Constants::nEtaBins * Constants::nPhiBins;
+  unsigned int const nClusters = points.x.size();
+  std::vector<int> keys(nClusters);
+  for (unsigned int i = 0; i < nClusters; ++i) {
+    auto const &tile = d_hist[points.layer[i]];
+    keys[i] = points.layer[i] * nBinsPerLayer + tile.etaBin(points.eta[i]) * Constants::nPhiBins +
+              tile.phiBin(points.phi[i]);
+  }
+  clustersByBin.resize(nClusters);
+  std::iota(clustersByBin.begin(), clustersByBin.end(), 0u);
+  std::stable_sort(clustersByBin.begin(), clustersByBin.end(), [&](unsigned int i, unsigned int j) {
+    return keys[i] < keys[j];
+  });
+  layerOffsets.assign(Constants::nLayers + 1, 0);
+  for (unsigned int i = 0; i < nClusters; ++i) {
+    ++layerOffsets[points.layer[i] + 1];
+  }
+  std::partial_sum(layerOffsets.begin(), layerOffsets.end(), layerOffsets.begin());
+}
+
+// Density of the clusters of layerId from the sibling layers, processed as
+// blocks of (layerId, sibling layer) pairs: the clusters of layerId are
+// visited bin by bin, in the order of KernelSortByBinSoA, so that the
+// consecutive ones search the same window of the sibling tile while it is
+// in cache. Each cluster still sums its sibling layers in increasing order
+// and the bins of each window in the same order, so the densities are
+// bit-identical to the ones of KernelCalculateDensitySoA. The sums are
+// kept in rho, by cluster, until all the layers are done.
+template <typename Kernel = densitykernels::Flat, typename Sum = densitysums::FloatSum>
+void KernelCalculateDensityBlockedSoA(TICLLayerTiles &d_hist,
+                                      ClusterCollectionSerial const &points,
+                                      std::vector<unsigned int> const &clustersByBin,
+                                      std::vector<int> const &layerOffsets,
+                                      int layerId,
+                                      std::vector<Sum> &rho,
+                                      int algoVerbosity = 0,
+                                      int densitySiblingLayers = 3,
+                                      int densityXYDistanceSqr = 3.24,
+                                      float kernelDensityFactor = 0.2,
+                                      bool densityOnSameLayer = false,
+                                      Kernel const &kernel = Kernel()) {
+  auto [minLayer, maxLayer] = densitySiblingRange(layerId, densitySiblingLayers);
+  for (int currentLayer = minLayer; currentLayer <= maxLayer; currentLayer++) {
+    const auto &tileOnLayer = d_hist[currentLayer];
+    for (int k = layerOffsets[layerId]; k < layerOffsets[layerId + 1]; ++k) {
+      unsigned int clusterIdxSoA = clustersByBin[k];
+      accumulateDensitySoA(tileOnLayer,
+                           points,
+                           clusterIdxSoA,
+                           tileOnLayer.etaBin(points.eta[clusterIdxSoA]),
+                           tileOnLayer.phiBin(points.phi[clusterIdxSoA]),
+                           currentLayer == layerId,
+                           algoVerbosity,
+                           densityXYDistanceSqr,
+                           kernelDensityFactor,
+                           densityOnSameLayer,
+                           kernel,
+                           rho[clusterIdxSoA]);
+    }
   }
-  //  for (unsigned int i = 0; i < points.rho.size(); ++i) {
-  //    std::cout << "Layer " << points.layer[i] << " i " << i << " rho " << points.rho[i] << std::endl;
-  //  }
 }
 
+template <typename Kernel = densitykernels::Flat>
 void KernelCalculateDensity(TICLLayerTiles &d_hist,
                             ClusterCollectionSerialOnLayers &points,
                             int algoVerbosity = 0,
                             int densitySiblingLayers = 3,
                             int densityXYDistanceSqr = 3.24,
                             float kernelDensityFactor = 0.2,
-                            bool densityOnSameLayer = false) {
+                            bool densityOnSameLayer = false,
+                            Kernel const &kernel = Kernel()) {
   // To be verified is those numbers are available via types.
 
   constexpr int nEtaBin = TICLLayerTiles::constants_type_t::nEtaBins;
-  constexpr int nPhiBin = TICLLayerTiles::constants_type_t::nPhiBins;
   constexpr int nLayers = TICLLayerTiles::constants_type_t::nLayers;
   for (int layerId = 0; layerId < nLayers; layerId++) {
     auto &clustersOnLayer = points[layerId];
@@ -170,6 +296,11 @@ void KernelCalculateDensity(TICLLayerTiles &d_hist,
       auto delta_phi = reco::deltaPhi(phi0, phi1);
       return (r0 - r1) * (r0 - r1) + r1 * r1 * delta_phi * delta_phi < delta_sqr;
     };
+    // only evaluated for the kernels with a profile
+    auto distanceSqr = [](float r0, float r1, float phi0, float phi1) -> float {
+      auto delta_phi = reco::deltaPhi(phi0, phi1);
+      return (r0 - r1) * (r0 - r1) + r1 * r1 * delta_phi * delta_phi;
+    };
     auto distance_debug = [&](float x1, float x2, float y1, float y2) -> float {
       return sqrt((x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2));
     };
@@ -200,7 +331,7 @@ void KernelCalculateDensity(TICLLayerTiles &d_hist,
         const int etaWindow = 2;
         const int phiWindow = 2;
         int etaBinMin = std::max(tileOnLayer.etaBin(clustersOnLayer.eta[i]) - etaWindow, 0);
-        int etaBinMax = std::min(tileOnLayer.etaBin(clustersOnLayer.eta[i]) + etaWindow, nEtaBin);
+        int etaBinMax = std::min(tileOnLayer.etaBin(clustersOnLayer.eta[i]) + etaWindow, nEtaBin - 1);
         int phiBinMin = tileOnLayer.phiBin(clustersOnLayer.phi[i]) - phiWindow;
         int phiBinMax = tileOnLayer.phiBin(clustersOnLayer.phi[i]) + phiWindow;
         if (algoVerbosity > 0) {
@@ -210,17 +341,13 @@ void KernelCalculateDensity(TICLLayerTiles &d_hist,
           std::cout << "phiBinMin: " << phiBinMin << ", phiBinMax: " << phiBinMax << std::endl;
         }
         for (int ieta = etaBinMin; ieta <= etaBinMax; ++ieta) {
-          auto offset = ieta * nPhiBin;
-          if (algoVerbosity > 0) {
-            std::cout << "offset: " << offset << std::endl;
-          }
           for (int iphi_it = phiBinMin; iphi_it <= phiBinMax; ++iphi_it) {
-            int iphi = ((iphi_it % nPhiBin + nPhiBin) % nPhiBin);
+            int bin = tileOnLayer.searchBin(ieta, iphi_it);
             if (algoVerbosity > 0) {
-              std::cout << "iphi: " << iphi << std::endl;
-              std::cout << "Entries in tileBin: " << tileOnLayer[offset + iphi].size() << std::endl;
+              std::cout << "iphi: " << iphi_it << std::endl;
+              std::cout << "Entries in tileBin: " << tileOnLayer[bin].size() << std::endl;
             }
-            for (auto otherClusterIdx : tileOnLayer[offset + iphi]) {
+            for (auto otherClusterIdx : tileOnLayer[bin]) {
               auto const &clustersLayer = points[currentLayer];
               if (algoVerbosity > 0) {
                 std::cout << "OtherLayer: " << currentLayer << " SoaIDX: " << otherClusterIdx << std::endl;
@@ -261,6 +388,13 @@ void KernelCalculateDensity(TICLLayerTiles &d_hist,
               }
               if (reachable) {
                 float factor_same_layer_different_cluster = (onSameLayer && !densityOnSameLayer) ? 0.f : 1.f;
+                if constexpr (Kernel::usesDistance) {
+                  factor_same_layer_different_cluster *=
+                      kernel(distanceSqr(clustersOnLayer.r_over_absz[i] * clustersOnLayer.z[i],
+                                         clustersLayer.r_over_absz[otherClusterIdx] * clustersOnLayer.z[i],
+                                         clustersOnLayer.phi[i],
+                                         clustersLayer.phi[otherClusterIdx]));
+                }
                 auto energyToAdd = (onSameLayer && (i == otherClusterIdx)
                                         ? 1.f
                                         : kernelDensityFactor * factor_same_layer_different_cluster) *
@@ -289,7 +423,6 @@ void KernelComputeDistanceToHigherSoA(TICLLayerTiles &d_hist,
                                       int densitySiblingLayers = 3,
                                       bool nearestHigherOnSameLayer = false) {
   constexpr int nEtaBin = TICLLayerTiles::constants_type_t::nEtaBins;
-  constexpr int nPhiBin = TICLLayerTiles::constants_type_t::nPhiBins;
   constexpr int nLayers = TICLLayerTiles::constants_type_t::nLayers;
   for (unsigned int clusterIdxSoA = 0; clusterIdxSoA < points.x.size(); ++clusterIdxSoA) {
     int layerId = points.layer[clusterIdxSoA];
@@ -326,18 +459,17 @@ void KernelComputeDistanceToHigherSoA(TICLLayerTiles &d_hist,
       int etaWindow = 1;
       int phiWindow = 1;
       int etaBinMin = std::max(tileOnLayer.etaBin(points.eta[clusterIdxSoA]) - etaWindow, 0);
-      int etaBinMax = std::min(tileOnLayer.etaBin(points.eta[clusterIdxSoA]) + etaWindow, nEtaBin);
+      int etaBinMax = std::min(tileOnLayer.etaBin(points.eta[clusterIdxSoA]) + etaWindow, nEtaBin - 1);
       int phiBinMin = tileOnLayer.phiBin(points.phi[clusterIdxSoA]) - phiWindow;
       int phiBinMax = tileOnLayer.phiBin(points.phi[clusterIdxSoA]) + phiWindow;
       for (int ieta = etaBinMin; ieta <= etaBinMax; ++ieta) {
-        auto offset = ieta * nPhiBin;
         for (int iphi_it = phiBinMin; iphi_it <= phiBinMax; ++iphi_it) {
-          int iphi = ((iphi_it % nPhiBin + nPhiBin) % nPhiBin);
+          int bin = tileOnLayer.searchBin(ieta, iphi_it);
           if (algoVerbosity > 0) {
             std::cout << "Searching nearestHigher on " << currentLayer << " eta, phi: " << ieta << ", " << iphi_it
-                      << " " << iphi << " " << offset << " " << (offset + iphi);
+                      << " " << bin;
           }
-          for (auto otherClusterIdx : tileOnLayer[offset + iphi]) {
+          for (auto otherClusterIdx : tileOnLayer[bin]) {
             //              auto const &clustersOnOtherLayer = points[currentLayer];
             auto dist = maxDelta;
             auto dist_transverse = maxDelta;
@@ -391,13 +523,130 @@ void KernelComputeDistanceToHigherSoA(TICLLayerTiles &d_hist,
   }
 };
 
+// Neighbour list stage of CLUE3D: a single walk over the sibling layers of
+// each cluster collects both the clusters that contribute to its density,
+// with their squared transverse distance, in densityNeighbours, and the
+// candidates for its nearest higher, within the narrower eta-phi window
+// and layer range of KernelComputeDistanceToHigherSoA, in
+// higherCandidates. Both lists keep the order of the walks they replace.
+// Returns false, leaving the lists incomplete, as soon as they would hold
+// more than maxPairs pairs together.
+inline bool KernelBuildNeighbourListsSoA(TICLLayerTiles const &d_hist,
+                                         ClusterCollectionSerial const &points,
+                                         NeighbourList &densityNeighbours,
+                                         NeighbourList &higherCandidates,
+                                         std::size_t maxPairs,
+                                         int densitySiblingLayers = 3,
+                                         int densityXYDistanceSqr = 3.24,
+                                         bool nearestHigherOnSameLayer = false) {
+  constexpr int nEtaBin = TICLLayerTiles::constants_type_t::nEtaBins;
+  constexpr int lastLayerPerSide = TICLLayerTiles::constants_type_t::nLayers / 2;
+  densityNeighbours.clear();
+  higherCandidates.clear();
+  for (unsigned int clusterIdxSoA = 0; clusterIdxSoA < points.x.size(); ++clusterIdxSoA) {
+    int layerId = points.layer[clusterIdxSoA];
+    float const r0 = points.r_over_absz[clusterIdxSoA] * points.z[clusterIdxSoA];
+    float const phi0 = points.phi[clusterIdxSoA];
+    float const reachableSqr = points.isSilicon[clusterIdxSoA]
+                                   ? float(densityXYDistanceSqr)
+                                   : points.radius[clusterIdxSoA] * points.radius[clusterIdxSoA];
+    // the layers of the nearest higher search start one layer later on the second side
+    auto [minLayer, maxLayer] = densitySiblingRange(layerId, densitySiblingLayers);
+    int const minHigherLayer = layerId < lastLayerPerSide ? minLayer : std::max(minLayer, lastLayerPerSide + 1);
+    for (int currentLayer = minLayer; currentLayer <= maxLayer; currentLayer++) {
+      bool const searchHigher =
+          currentLayer >= minHigherLayer and (nearestHigherOnSameLayer or currentLayer != layerId);
+      const auto &tileOnLayer = d_hist[currentLayer];
+      int const etaBin = tileOnLayer.etaBin(points.eta[clusterIdxSoA]);
+      int const phiBin = tileOnLayer.phiBin(points.phi[clusterIdxSoA]);
+      for (int ieta = std::max(etaBin - 2, 0); ieta <= std::min(etaBin + 2, nEtaBin - 1); ++ieta) {
+        for (int iphi_it = phiBin - 2; iphi_it <= phiBin + 2; ++iphi_it) {
+          bool const higherBin = searchHigher and std::abs(ieta - etaBin) <= 1 and std::abs(iphi_it - phiBin) <= 1;
+          for (auto otherClusterIdx : tileOnLayer[tileOnLayer.searchBin(ieta, iphi_it)]) {
+            float const r1 = points.r_over_absz[otherClusterIdx] * points.z[clusterIdxSoA];
+            auto delta_phi = reco::deltaPhi(phi0, points.phi[otherClusterIdx]);
+            float const distanceSqr = (r0 - r1) * (r0 - r1) + r1 * r1 * delta_phi * delta_phi;
+            if (distanceSqr < reachableSqr) {
+              densityNeighbours.add(otherClusterIdx, distanceSqr);
+            }
+            if (higherBin) {
+              higherCandidates.add(otherClusterIdx, distanceSqr);
+            }
+          }
+        }
+      }
+    }
+    if (densityNeighbours.size() + higherCandidates.size() > maxPairs) {
+      return false;
+    }
+    densityNeighbours.close();
+    higherCandidates.close();
+  }
+  return true;
+}
+
+// same as KernelCalculateDensitySoA, from the neighbour list
+template <typename Kernel = densitykernels::Flat, typename Sum = densitysums::FloatSum>
+void KernelCalculateDensityNeighboursSoA(NeighbourList const &densityNeighbours,
+                                         ClusterCollectionSerial &points,
+                                         float kernelDensityFactor = 0.2,
+                                         bool densityOnSameLayer = false,
+                                         Kernel const &kernel = Kernel(),
+                                         Sum const &sum = Sum()) {
+  for (unsigned int clusterIdxSoA = 0; clusterIdxSoA < points.x.size(); ++clusterIdxSoA) {
+    Sum rho_i = sum;
+    for (unsigned int k = densityNeighbours.offsets[clusterIdxSoA]; k < densityNeighbours.offsets[clusterIdxSoA + 1];
+         ++k) {
+      unsigned int otherClusterIdx = densityNeighbours.neighbours[k];
+      bool onSameLayer = points.layer[otherClusterIdx] == points.layer[clusterIdxSoA];
+      float factor_same_layer_different_cluster = (onSameLayer && !densityOnSameLayer) ? 0.f : 1.f;
+      if constexpr (Kernel::usesDistance) {
+        factor_same_layer_different_cluster *= kernel(densityNeighbours.distances[k]);
+      }
+      rho_i.add(((clusterIdxSoA == otherClusterIdx) ? 1.f : kernelDensityFactor * factor_same_layer_different_cluster) *
+                points.energy[otherClusterIdx]);
+    }
+    points.rho[clusterIdxSoA] = rho_i.result();
+  }
+}
+
+// same as KernelComputeDistanceToHigherSoA, from the neighbour list
+inline void KernelComputeDistanceToHigherNeighboursSoA(NeighbourList const &higherCandidates,
+                                                       ClusterCollectionSerial &points) {
+  constexpr float maxDelta = std::numeric_limits<float>::max();
+  for (unsigned int clusterIdxSoA = 0; clusterIdxSoA < points.x.size(); ++clusterIdxSoA) {
+    int layerId = points.layer[clusterIdxSoA];
+    float i_delta = maxDelta;
+    std::pair<int, int> i_nearestHigher(-1, -1);
+    std::pair<float, int> nearest_distances(maxDelta, std::numeric_limits<int>::max());
+    for (unsigned int k = higherCandidates.offsets[clusterIdxSoA]; k < higherCandidates.offsets[clusterIdxSoA + 1];
+         ++k) {
+      unsigned int otherClusterIdx = higherCandidates.neighbours[k];
+      float dist = higherCandidates.distances[k];
+      bool foundHigher = (points.rho[otherClusterIdx] > points.rho[clusterIdxSoA]);
+      if (foundHigher && dist <= i_delta) {
+        int currentLayer = points.layer[otherClusterIdx];
+        i_delta = dist;
+        nearest_distances = std::make_pair(sqrt(dist), std::abs(currentLayer - layerId));
+        i_nearestHigher = std::make_pair(currentLayer, otherClusterIdx);
+      }
+    }
+    if (i_delta != maxDelta) {
+      points.delta[clusterIdxSoA] = nearest_distances;
+      points.nearestHigher[clusterIdxSoA] = i_nearestHigher;
+    } else {
+      points.delta[clusterIdxSoA] = std::make_pair(maxDelta, std::numeric_limits<int>::max());
+      points.nearestHigher[clusterIdxSoA] = {-1, -1};
+    }
+  }
+}
+
 void KernelComputeDistanceToHigher(TICLLayerTiles &d_hist,
                                    ClusterCollectionSerialOnLayers &points,
                                    int algoVerbosity = 0,
                                    int densitySiblingLayers = 3,
                                    bool nearestHigherOnSameLayer = false) {
   constexpr int nEtaBin = TICLLayerTiles::constants_type_t::nEtaBins;
-  constexpr int nPhiBin = TICLLayerTiles::constants_type_t::nPhiBins;
   constexpr int nLayers = TICLLayerTiles::constants_type_t::nLayers;
   for (int layerId = 0; layerId < nLayers; layerId++) {
     auto &clustersOnLayer = points[layerId];
@@ -436,18 +685,17 @@ void KernelComputeDistanceToHigher(TICLLayerTiles &d_hist,
         int etaWindow = 1;
         int phiWindow = 1;
         int etaBinMin = std::max(tileOnLayer.etaBin(clustersOnLayer.eta[i]) - etaWindow, 0);
-        int etaBinMax = std::min(tileOnLayer.etaBin(clustersOnLayer.eta[i]) + etaWindow, nEtaBin);
+        int etaBinMax = std::min(tileOnLayer.etaBin(clustersOnLayer.eta[i]) + etaWindow, nEtaBin - 1);
         int phiBinMin = tileOnLayer.phiBin(clustersOnLayer.phi[i]) - phiWindow;
         int phiBinMax = tileOnLayer.phiBin(clustersOnLayer.phi[i]) + phiWindow;
         for (int ieta = etaBinMin; ieta <= etaBinMax; ++ieta) {
-          auto offset = ieta * nPhiBin;
           for (int iphi_it = phiBinMin; iphi_it <= phiBinMax; ++iphi_it) {
-            int iphi = ((iphi_it % nPhiBin + nPhiBin) % nPhiBin);
+            int bin = tileOnLayer.searchBin(ieta, iphi_it);
             if (algoVerbosity > 0) {
               std::cout << "Searching nearestHigher on " << currentLayer << " eta, phi: " << ieta << ", " << iphi_it
-                        << " " << iphi << " " << offset << " " << (offset + iphi);
+                        << " " << bin;
             }
-            for (auto otherClusterIdx : tileOnLayer[offset + iphi]) {
+            for (auto otherClusterIdx : tileOnLayer[bin]) {
               auto const &clustersOnOtherLayer = points[currentLayer];
               auto dist = maxDelta;
               auto dist_transverse = maxDelta;
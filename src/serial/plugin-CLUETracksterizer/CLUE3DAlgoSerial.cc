@@ -1,4 +1,9 @@
 #include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include <tbb/parallel_for.h>
+
 #include "DataFormats/ClusterCollection.h"
 
 #include "CLUE3DAlgoSerial.h"
@@ -39,21 +44,69 @@ void CLUE3DAlgoSerial::setup(ClusterCollection const& pc, ClusterCollectionSeria
   }
 }
 
-void CLUE3DAlgoSerial::makeTrackstersSoA(ClusterCollection const& pc, ClusterCollectionSerial& d_clustersSoA) {
+void CLUE3DAlgoSerial::makeTrackstersSoA(ClusterCollection const& pc,
+                                         ClusterCollectionSerial& d_clustersSoA,
+                                         densitykernels::Kernel densityKernel,
+                                         float kernelScale,
+                                         DensitySchedule densitySchedule,
+                                         bool reproducible,
+                                         std::size_t neighbourListSize) {
   setupSoA(pc, d_clustersSoA);
 
   KernelComputeHistogramSoA(*histSoA_, d_clustersSoA);
-  KernelCalculateDensitySoA(*histSoA_, d_clustersSoA);
-  KernelComputeDistanceToHigherSoA(*histSoA_, d_clustersSoA);
+  // otherwise, or when the lists would exceed their size, both steps walk the tiles
+  bool const useNeighbourLists =
+      neighbourListSize > 0 and
+      KernelBuildNeighbourListsSoA(*histSoA_, d_clustersSoA, densityNeighbours_, higherCandidates_, neighbourListSize);
+  densitykernels::dispatch(densityKernel, kernelScale, [&](auto const& kernel) {
+    densitysums::dispatch(reproducible, [&](auto const& sum) {
+      if (useNeighbourLists) {
+        KernelCalculateDensityNeighboursSoA(densityNeighbours_, d_clustersSoA, 0.2, false, kernel, sum);
+        return;
+      }
+      if (densitySchedule == DensitySchedule::Cluster) {
+        KernelCalculateDensitySoA(*histSoA_, d_clustersSoA, 0, 3, 3.24, 0.2, false, kernel, sum);
+        return;
+      }
+      KernelSortByBinSoA(*histSoA_, d_clustersSoA, clustersByBin_, layerOffsets_);
+      std::vector<std::decay_t<decltype(sum)>> rho(d_clustersSoA.x.size(), sum);
+      auto blocksOfLayer = [&](int layerId) {
+        KernelCalculateDensityBlockedSoA(
+            *histSoA_, d_clustersSoA, clustersByBin_, layerOffsets_, layerId, rho, 0, 3, 3.24, 0.2, false, kernel);
+      };
+      constexpr int nLayers = TICLLayerTiles::constants_type_t::nLayers;
+      if (densitySchedule == DensitySchedule::Parallel) {
+        // the blocks of a layer update the same densities, so they stay in one task
+        tbb::parallel_for(0, nLayers, blocksOfLayer);
+      } else {
+        for (int layerId = 0; layerId < nLayers; ++layerId) {
+          blocksOfLayer(layerId);
+        }
+      }
+      for (unsigned int i = 0; i < rho.size(); ++i) {
+        d_clustersSoA.rho[i] = rho[i].result();
+      }
+    });
+  });
+  if (useNeighbourLists) {
+    KernelComputeDistanceToHigherNeighboursSoA(higherCandidates_, d_clustersSoA);
+  } else {
+    KernelComputeDistanceToHigherSoA(*histSoA_, d_clustersSoA);
+  }
   KernelFindAndAssignClustersSoA(d_clustersSoA);
   histSoA_->clear();
 }
 
-void CLUE3DAlgoSerial::makeTracksters(ClusterCollection const& pc, ClusterCollectionSerialOnLayers& d_clusters) {
+void CLUE3DAlgoSerial::makeTracksters(ClusterCollection const& pc,
+                                      ClusterCollectionSerialOnLayers& d_clusters,
+                                      densitykernels::Kernel densityKernel,
+                                      float kernelScale) {
   setup(pc, d_clusters);
 
   KernelComputeHistogram(*hist_, d_clusters);
-  KernelCalculateDensity(*hist_, d_clusters);
+  densitykernels::dispatch(densityKernel, kernelScale, [&](auto const& kernel) {
+    KernelCalculateDensity(*hist_, d_clusters, 0, 3, 3.24, 0.2, false, kernel);
+  });
   KernelComputeDistanceToHigher(*hist_, d_clusters);
   KernelFindAndAssignClusters(d_clusters);
   hist_->clear();
@@ -1,9 +1,14 @@
 #ifndef CLUE3DAlgo_Serial_h
 #define CLUE3DAlgo_Serial_h
 
+#include "DataFormats/CLUE3D_config.h"
 #include "DataFormats/ClusterCollection.h"
+#include "DataFormats/DensityKernels.h"
+#include "DataFormats/NeighbourList.h"
 #include "DataFormats/TICLLayerTile.h"
 
+#include <vector>
+
 class CLUE3DAlgoSerial {
 public:
   // constructor
@@ -17,13 +22,33 @@ public:
     delete histSoA_;
   };
 
-  void makeTrackstersSoA(ClusterCollection const &host_pc, ClusterCollectionSerial &d_clustersSoA);
-  void makeTracksters(ClusterCollection const &host_pc, ClusterCollectionSerialOnLayers &d_clusters);
+  // the density kernel and accumulation are chosen once per event, see
+  // densitykernels::dispatch() and densitysums::dispatch(); with
+  // neighbourListSize > 0 the sibling layers are walked once for both the
+  // density and the nearest higher, unless there are more pairs than that,
+  // see KernelBuildNeighbourListsSoA()
+  void makeTrackstersSoA(ClusterCollection const &host_pc,
+                         ClusterCollectionSerial &d_clustersSoA,
+                         densitykernels::Kernel densityKernel = densitykernels::Kernel::Flat,
+                         float kernelScale = 1.f,
+                         DensitySchedule densitySchedule = DensitySchedule::Blocked,
+                         bool reproducible = false,
+                         std::size_t neighbourListSize = 0);
+  void makeTracksters(ClusterCollection const &host_pc,
+                      ClusterCollectionSerialOnLayers &d_clusters,
+                      densitykernels::Kernel densityKernel = densitykernels::Kernel::Flat,
+                      float kernelScale = 1.f);
 
   TICLLayerTiles *hist_;
   TICLLayerTiles *histSoA_;
 
 private:
+  // the clusters sorted by layer and bin, for the blocked density schedules
+  std::vector<unsigned int> clustersByBin_;
+  std::vector<int> layerOffsets_;
+  NeighbourList densityNeighbours_;
+  NeighbourList higherCandidates_;
+
   void setupSoA(ClusterCollection const &pc, ClusterCollectionSerial &d_clustersSoA);
   void setup(ClusterCollection const &pc, ClusterCollectionSerialOnLayers &d_clusters);
 };
@@ -3,6 +3,7 @@
 #include "Framework/PluginFactory.h"
 #include "Framework/EDProducer.h"
 
+#include "DataFormats/CLUE3D_config.h"
 #include "DataFormats/ClusterCollection.h"
 #include "CLUE3DAlgoSerial.h"
 #include <optional>
@@ -28,6 +29,7 @@ CLUESerialTracksterizer::CLUESerialTracksterizer(edm::ProductRegistry& reg)
 
 void CLUESerialTracksterizer::produce(edm::Event& event, const edm::EventSetup& eventSetup) {
   auto const& pc = event.get(clusterCollectionToken_);
+  Parameters3D const& par = eventSetup.get<Parameters3D>();
 
   if (0) {
     ClusterCollectionSerialOnLayers d_clusters;
@@ -35,7 +37,13 @@ void CLUESerialTracksterizer::produce(edm::Event& event, const edm::EventSetup&
     event.emplace(tracksterToken_, std::move(d_clusters));
   } else {
     ClusterCollectionSerial d_clustersSoA;
-    algo_->makeTrackstersSoA(pc, d_clustersSoA);
+    algo_->makeTrackstersSoA(pc,
+                             d_clustersSoA,
+                             par.kernel,
+                             par.scale,
+                             par.densitySchedule,
+                             par.reproducible,
+                             par.neighbourListSize);
     event.emplace(tracksterToken_, std::move(d_clustersSoA));
   }
 }
@@ -0,0 +1,21 @@
+#include <memory>
+#include "Framework/ESProducer.h"
+#include "Framework/EventSetup.h"
+#include "Framework/ESPluginFactory.h"
+#include "DataFormats/CLUE3D_config.h"
+
+class CLUESerialTracksterizerESProducer : public edm::ESProducer {
+public:
+  CLUESerialTracksterizerESProducer(std::filesystem::path const& config_file) : data_{config_file} {}
+  void produce(edm::EventSetup& eventSetup);
+
+private:
+  std::filesystem::path data_;
+};
+
+void CLUESerialTracksterizerESProducer::produce(edm::EventSetup& eventSetup) {
+  auto parameters = std::make_unique<Parameters3D>(readParameters3D(data_));
+  eventSetup.put(std::move(parameters));
+}
+
+DEFINE_FWK_EVENTSETUP_MODULE(CLUESerialTracksterizerESProducer);
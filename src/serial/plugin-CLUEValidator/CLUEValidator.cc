@@ -1,11 +1,18 @@
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <type_traits>
 #include <unordered_map>
 #include <string>
+#include <utility>
 
 #include "DataFormats/PointsCloud.h"
 #include "DataFormats/CLUE_config.h"
+#include "DataFormats/DensityKernels.h"
+#include "DataFormats/DensitySums.h"
+#include "DataFormats/LayerTilesSerial.h"
 
 #include "Framework/EDProducer.h"
 #include "Framework/Event.h"
@@ -29,15 +36,32 @@ public:
 
 private:
   void produce(edm::Event& event, edm::EventSetup const& eventSetup) override;
+  void endJob() override;
   template <class T>
   bool arraysAreEqual(std::vector<T>, std::vector<T> trueDataArr);
   bool arraysClustersEqual(const PointsCloudSerial& devicePC, const PointsCloudSerial& truePC);
   std::string checkValidation(std::string const& inputFile);
   void validateOutput(const PointsCloudSerial& pc, std::string trueOutFilePath, Parameters const& par);
+  PointsCloudSerial exactClusters(const PointsCloudSerial& pc, Parameters const& par) const;
+  template <typename Tiles>
+  PointsCloudSerial exactClustersOn(const PointsCloudSerial& pc, Parameters const& par) const;
+  void validateApproximation(const PointsCloudSerial& pc, Parameters const& par, int eventId);
+  void validateReproducible(const PointsCloudSerial& pc, Parameters const& par, int eventId);
   edm::EDGetTokenT<PointsCloudSerial> resultsTokenPC_;
+
+  // agreement of the approximate clustering with the exact one, summed over the events
+  std::mutex agreementMutex_;
+  long matchedPoints_ = 0;
+  long clusteredPoints_ = 0;
+  long foundClusters_ = 0;
+  long exactClusters_ = 0;
+  // events compared bit by bit with the exact clustering, and how many differ
+  long reproducibleEvents_ = 0;
+  long differentEvents_ = 0;
 };
 
-CLUEValidator::CLUEValidator(edm::ProductRegistry& reg) : resultsTokenPC_(reg.consumes<PointsCloudSerial>()) {}
+CLUEValidator::CLUEValidator(edm::ProductRegistry& reg)
+    : resultsTokenPC_(reg.consumes<PointsCloudSerial>(PointsCloudSerial::kAllButFollowers)) {}
 
 template <class T>
 bool CLUEValidator::arraysAreEqual(std::vector<T> devicePtr, std::vector<T> trueDataArr) {
@@ -121,12 +145,19 @@ void CLUEValidator::produce(edm::Event& event, edm::EventSetup const& eventSetup
   auto const& pc = event.get(resultsTokenPC_);
   auto const& par = eventSetup.get<Parameters>();
 
+  if (par.approximate) {
+    validateApproximation(pc, par, event.eventID());
+    return;
+  }
+  if (par.reproducible) {
+    validateReproducible(pc, par, event.eventID());
+  }
   if (checkValidation(outDataDir->outFile) != std::string()) {
     auto ref_file = checkValidation(outDataDir->outFile);
     std::filesystem::path ref_path = outDataDir->outFile.parent_path() / "reference";
     std::cout << "Validating output results from " << ref_path / ref_file << std::endl;
     validateOutput(pc, ref_path / ref_file, par);
-  } else {
+  } else if (not par.reproducible) {
     std::cout << "\nThere is no reference output data for the input file selected.\n";
     std::cout << "Please select one of the toyDetectors input files to validate the plugin results\n" << std::endl;
   }
@@ -198,4 +229,198 @@ void CLUEValidator::validateOutput(const PointsCloudSerial& pc, std::string true
   }
 }
 
+// Plain CLUE on the input of the event, as the reference for the
+// approximate and the reproducible modes
+PointsCloudSerial CLUEValidator::exactClusters(const PointsCloudSerial& pc, Parameters const& par) const {
+  if (par.periodicY) {
+    return exactClustersOn<LayerTilesSerialPeriodicY>(pc, par);
+  }
+  return exactClustersOn<LayerTilesSerial>(pc, par);
+}
+
+template <typename Tiles>
+PointsCloudSerial CLUEValidator::exactClustersOn(const PointsCloudSerial& pc, Parameters const& par) const {
+  PointsCloudSerial exact;
+  exact.x = pc.x;
+  exact.y = pc.y;
+  exact.layer = pc.layer;
+  exact.weight = pc.weight;
+  exact.outResize();
+  int const n = exact.x.size();
+
+  auto tiles = std::make_unique<std::array<Tiles, NLAYERS>>();
+  constexpr float yRange = LayerTilesConstants::maxY - LayerTilesConstants::minY;
+  for (int i = 0; i < n; i++) {
+    (*tiles)[exact.layer[i]].fill(exact.x[i], exact.y[i], i);
+  }
+  // calls f(j, distance) for the points j of the layer of i within radius
+  auto forNeighbours = [&](int i, float radius, auto&& f) {
+    auto& lt = (*tiles)[exact.layer[i]];
+    auto box = lt.searchBox(exact.x[i] - radius, exact.x[i] + radius, exact.y[i] - radius, exact.y[i] + radius);
+    for (int xBin = box[0]; xBin <= box[1]; ++xBin) {
+      for (int yBin = box[2]; yBin <= box[3]; ++yBin) {
+        for (int j : lt[lt.getGlobalBinByBin(xBin, yBin)]) {
+          float dx = exact.x[i] - exact.x[j];
+          float dy = exact.y[i] - exact.y[j];
+          if (par.periodicY) {
+            dy -= yRange * std::round(dy / yRange);
+          }
+          float dist = std::sqrt(dx * dx + dy * dy);
+          if (dist <= radius) {
+            f(j, dist);
+          }
+        }
+      }
+    }
+  };
+
+  // the fixed point sums give the densities the reproducible mode has to
+  // match bit by bit, whatever the order of the neighbours
+  densitykernels::dispatch(par.densityKernel, par.kernelScale, [&](auto const& kernel) {
+    auto density = [&](auto const& sum) {
+      for (int i = 0; i < n; i++) {
+        auto rho_i = sum;
+        forNeighbours(i, par.dc, [&](int j, float dist) {
+          rho_i.add((i == j ? 1.f : 0.5f * kernel(dist * dist)) * exact.weight[j]);
+        });
+        exact.rho[i] = rho_i.result();
+      }
+    };
+    if (par.reproducible) {
+      density(densitysums::FixedPointSum());
+    } else {
+      density(densitysums::FloatSum());
+    }
+  });
+  float const dm = par.outlierDeltaFactor * par.dc;
+  for (int i = 0; i < n; i++) {
+    exact.delta[i] = std::numeric_limits<float>::max();
+    exact.nearestHigher[i] = -1;
+    forNeighbours(i, dm, [&](int j, float dist) {
+      bool higher = exact.rho[j] > exact.rho[i] or (exact.rho[j] == exact.rho[i] and j > i);
+      if (higher and dist < exact.delta[i]) {
+        exact.delta[i] = dist;
+        exact.nearestHigher[i] = j;
+      }
+    });
+  }
+
+  std::vector<int> stack;
+  int nClusters = 0;
+  for (int i = 0; i < n; i++) {
+    exact.clusterIndex[i] = -1;
+    bool isSeed = exact.delta[i] > par.dc and exact.rho[i] >= par.rhoc;
+    bool isOutlier = exact.delta[i] > dm and exact.rho[i] < par.rhoc;
+    if (isSeed) {
+      exact.isSeed[i] = 1;
+      exact.clusterIndex[i] = nClusters++;
+      stack.push_back(i);
+    } else if (not isOutlier) {
+      exact.followers[exact.nearestHigher[i]].push_back(i);
+    }
+  }
+  while (not stack.empty()) {
+    int i = stack.back();
+    stack.pop_back();
+    for (int j : exact.followers[i]) {
+      exact.clusterIndex[j] = exact.clusterIndex[i];
+      stack.push_back(j);
+    }
+  }
+  return exact;
+}
+
+// Purity: fraction of the clustered points that belong to the exact
+// cluster sharing the most points with their approximate cluster.
+// Efficiency: fraction of the exact clusters with more than half of
+// their points in a single approximate cluster.
+void CLUEValidator::validateApproximation(const PointsCloudSerial& pc, Parameters const& par, int eventId) {
+  auto exact = exactClusters(pc, par);
+  int const n = pc.x.size();
+
+  std::map<std::pair<int, int>, int> overlap;  // (approximate, exact) -> points
+  std::unordered_map<int, int> approximateSize, exactSize;
+  for (int i = 0; i < n; i++) {
+    if (pc.clusterIndex[i] >= 0) {
+      ++approximateSize[pc.clusterIndex[i]];
+    }
+    if (exact.clusterIndex[i] >= 0) {
+      ++exactSize[exact.clusterIndex[i]];
+    }
+    if (pc.clusterIndex[i] >= 0 and exact.clusterIndex[i] >= 0) {
+      ++overlap[{pc.clusterIndex[i], exact.clusterIndex[i]}];
+    }
+  }
+  std::unordered_map<int, int> bestForApproximate, bestForExact;
+  for (auto const& [clusters, points] : overlap) {
+    auto& a = bestForApproximate[clusters.first];
+    a = std::max(a, points);
+    auto& e = bestForExact[clusters.second];
+    e = std::max(e, points);
+  }
+
+  long matched = 0, clustered = 0, found = 0;
+  for (auto const& [cluster, size] : approximateSize) {
+    clustered += size;
+    matched += bestForApproximate[cluster];
+  }
+  for (auto const& [cluster, size] : exactSize) {
+    if (2 * bestForExact[cluster] > size) {
+      ++found;
+    }
+  }
+
+  std::cout << "Event " << eventId << ": approximate CLUE purity " << (clustered > 0 ? float(matched) / clustered : 1.f)
+            << ", efficiency " << (exactSize.empty() ? 1.f : float(found) / exactSize.size()) << " ("
+            << approximateSize.size() << " clusters, " << exactSize.size() << " with exact CLUE)" << std::endl;
+
+  std::scoped_lock lock(agreementMutex_);
+  matchedPoints_ += matched;
+  clusteredPoints_ += clustered;
+  foundClusters_ += found;
+  exactClusters_ += exactSize.size();
+}
+
+// With the reproducible density sums the result does not depend on the
+// order of the neighbours, so any variant of the exact clustering must
+// match the plain one bit by bit.
+void CLUEValidator::validateReproducible(const PointsCloudSerial& pc, Parameters const& par, int eventId) {
+  auto exact = exactClusters(pc, par);
+  int const n = pc.x.size();
+  int different = -1;
+  for (int i = 0; i < n and different < 0; i++) {
+    if (pc.rho[i] != exact.rho[i] or pc.delta[i] != exact.delta[i] or pc.nearestHigher[i] != exact.nearestHigher[i] or
+        pc.isSeed[i] != exact.isSeed[i] or pc.clusterIndex[i] != exact.clusterIndex[i]) {
+      different = i;
+    }
+  }
+  if (different < 0) {
+    std::cout << "Event " << eventId << ": bit-identical to the reference CLUE" << std::endl;
+  } else {
+    int const i = different;
+    std::cout << "Event " << eventId << ": point " << i << " differs from the reference CLUE, rho " << pc.rho[i]
+              << " /= " << exact.rho[i] << ", delta " << pc.delta[i] << " /= " << exact.delta[i]
+              << ", nearest higher " << pc.nearestHigher[i] << " /= " << exact.nearestHigher[i] << ", cluster "
+              << pc.clusterIndex[i] << " /= " << exact.clusterIndex[i] << std::endl;
+  }
+
+  std::scoped_lock lock(agreementMutex_);
+  ++reproducibleEvents_;
+  if (different >= 0) {
+    ++differentEvents_;
+  }
+}
+
+void CLUEValidator::endJob() {
+  if (exactClusters_ > 0 or clusteredPoints_ > 0) {
+    std::cout << "Approximate CLUE agreement with exact CLUE over all events: purity "
+              << (clusteredPoints_ > 0 ? double(matchedPoints_) / clusteredPoints_ : 1.) << ", efficiency "
+              << (exactClusters_ > 0 ? double(foundClusters_) / exactClusters_ : 1.) << std::endl;
+  }
+  if (reproducibleEvents_ > 0) {
+    std::cout << differentEvents_ << " of " << reproducibleEvents_
+              << " events differ from the reference CLUE with the reproducible density sums" << std::endl;
+  }
+}
+
 DEFINE_FWK_MODULE(CLUEValidator);
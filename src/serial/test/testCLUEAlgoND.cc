@@ -0,0 +1,240 @@
+// Compares CLUEAlgoND with a brute-force O(n^2) CLUE on random clustered
+// points: a 3D (x, y, t) case, and a 2D case periodic in y with clusters
+// across the edge of the period. The densities are summed in fixed point,
+// so that both sides give bit-identical results whatever the order of
+// the neighbours.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DataFormats/DensityKernels.h"
+#include "DataFormats/DensitySums.h"
+#include "DataFormats/PointsCloudND.h"
+#include "plugin-CLUEClusterizer/CLUEAlgoND.h"
+
+// CLUEAlgoND<3> is compiled in the plugin, which the tests do not link
+template class CLUEAlgoND<3>;
+
+namespace {
+  struct Parameters {
+    float dc;
+    float rhoc;
+    float outlierDeltaFactor;
+    densitykernels::Kernel kernel;
+    float kernelScale;
+  };
+
+  struct Reference {
+    std::vector<float> rho;
+    std::vector<float> delta;
+    std::vector<int> nearestHigher;
+    std::vector<int> clusterIndex;
+  };
+
+  // same rules and tie-breaks as CLUEAlgoNDKernels.h, over all the pairs of points
+  template <int N, unsigned periodicMask>
+  Reference bruteForce(PointsCloudND<N> const& points,
+                       std::array<float, N> const& min,
+                       std::array<float, N> const& max,
+                       Parameters const& par) {
+    int const n = points.weight.size();
+    auto distance = [&](int i, int j) {
+      float sum = 0.f;
+      for (int d = 0; d < N; ++d) {
+        float delta = points.coords[d][i] - points.coords[d][j];
+        if (periodicMask & (1u << d)) {
+          float const period = max[d] - min[d];
+          delta -= period * std::round(delta / period);
+        }
+        sum += delta * delta;
+      }
+      return std::sqrt(sum);
+    };
+
+    Reference ref;
+    ref.rho.resize(n);
+    densitykernels::dispatch(par.kernel, par.kernelScale, [&](auto const& kernel) {
+      for (int i = 0; i < n; ++i) {
+        densitysums::FixedPointSum rho;
+        for (int j = 0; j < n; ++j) {
+          float const d = distance(i, j);
+          if (d <= par.dc) {
+            rho.add((i == j ? 1.f : 0.5f * kernel(d * d)) * points.weight[j]);
+          }
+        }
+        ref.rho[i] = rho.result();
+      }
+    });
+
+    float const dm = par.outlierDeltaFactor * par.dc;
+    ref.delta.assign(n, std::numeric_limits<float>::max());
+    ref.nearestHigher.assign(n, -1);
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        bool const higher = ref.rho[j] > ref.rho[i] || (ref.rho[j] == ref.rho[i] && j > i);
+        float const d = distance(i, j);
+        if (higher && d <= dm && d < ref.delta[i]) {
+          ref.delta[i] = d;
+          ref.nearestHigher[i] = j;
+        }
+      }
+    }
+
+    // seeds are numbered in index order, followers take the index of their nearest higher
+    ref.clusterIndex.assign(n, -1);
+    int nClusters = 0;
+    for (int i = 0; i < n; ++i) {
+      if (ref.delta[i] > par.dc && ref.rho[i] >= par.rhoc) {
+        ref.clusterIndex[i] = nClusters++;
+      }
+    }
+    // the nearest higher of a point has a higher density, so resolve in decreasing density
+    std::vector<int> order(n);
+    for (int i = 0; i < n; ++i) {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+      return ref.rho[a] > ref.rho[b] || (ref.rho[a] == ref.rho[b] && a > b);
+    });
+    for (int i : order) {
+      bool const isSeed = ref.delta[i] > par.dc && ref.rho[i] >= par.rhoc;
+      bool const isOutlier = ref.delta[i] > par.outlierDeltaFactor * par.dc && ref.rho[i] < par.rhoc;
+      if (!isSeed && !isOutlier) {
+        ref.clusterIndex[i] = ref.clusterIndex[ref.nearestHigher[i]];
+      }
+    }
+    return ref;
+  }
+
+  // gaussian blobs of points, with some uniform noise; periodic coordinates are wrapped into [min, max)
+  template <int N, unsigned periodicMask>
+  PointsCloudND<N> generate(std::array<float, N> const& min,
+                            std::array<float, N> const& max,
+                            std::vector<std::array<float, N>> const& centres,
+                            float sigma,
+                            int pointsPerBlob,
+                            int noise,
+                            unsigned seed) {
+    std::mt19937 gen(seed);
+    std::normal_distribution<float> gauss(0.f, sigma);
+    std::uniform_real_distribution<float> flat(0.f, 1.f);
+    std::uniform_real_distribution<float> weight(0.5f, 2.f);
+
+    PointsCloudND<N> points;
+    auto add = [&](std::array<float, N> p) {
+      for (int d = 0; d < N; ++d) {
+        if (periodicMask & (1u << d)) {
+          float const period = max[d] - min[d];
+          p[d] -= period * std::floor((p[d] - min[d]) / period);
+        } else {
+          p[d] = std::clamp(p[d], min[d], std::nextafter(max[d], min[d]));
+        }
+        points.coords[d].push_back(p[d]);
+      }
+      points.weight.push_back(weight(gen));
+    };
+    for (auto const& centre : centres) {
+      for (int k = 0; k < pointsPerBlob; ++k) {
+        std::array<float, N> p;
+        for (int d = 0; d < N; ++d) {
+          p[d] = centre[d] + gauss(gen);
+        }
+        add(p);
+      }
+    }
+    for (int k = 0; k < noise; ++k) {
+      std::array<float, N> p;
+      for (int d = 0; d < N; ++d) {
+        p[d] = min[d] + flat(gen) * (max[d] - min[d]);
+      }
+      add(p);
+    }
+    return points;
+  }
+
+  template <int N, unsigned periodicMask>
+  bool compare(std::string const& name,
+               PointsCloudND<N> points,
+               std::array<float, N> const& min,
+               std::array<float, N> const& max,
+               std::array<float, N> const& tileSize,
+               Parameters const& par) {
+    CLUEAlgoND<N, periodicMask> algo(min, max, tileSize);
+    algo.makeClusters(points, par.dc, par.rhoc, par.outlierDeltaFactor, par.kernel, par.kernelScale, true);
+    auto const ref = bruteForce<N, periodicMask>(points, min, max, par);
+
+    int const n = points.weight.size();
+    int differ = 0;
+    int seeds = 0;
+    for (int i = 0; i < n; ++i) {
+      seeds += points.isSeed[i];
+      if (points.rho[i] != ref.rho[i] || points.delta[i] != ref.delta[i] ||
+          points.nearestHigher[i] != ref.nearestHigher[i] || points.clusterIndex[i] != ref.clusterIndex[i]) {
+        if (differ < 10) {
+          std::cout << "  point " << i << ": rho " << points.rho[i] << " vs " << ref.rho[i] << ", delta "
+                    << points.delta[i] << " vs " << ref.delta[i] << ", nearest higher " << points.nearestHigher[i]
+                    << " vs " << ref.nearestHigher[i] << ", cluster " << points.clusterIndex[i] << " vs "
+                    << ref.clusterIndex[i] << std::endl;
+        }
+        ++differ;
+      }
+    }
+    std::cout << name << ": " << differ << " of " << n << " points differ, " << seeds << " clusters" << std::endl;
+    return differ == 0 && seeds > 0;
+  }
+}  // namespace
+
+int main() {
+  bool ok = true;
+
+  // (x, y, t), with the time scaled to the units of the positions
+  {
+    std::array<float, 3> const min{{-50.f, -50.f, -20.f}};
+    std::array<float, 3> const max{{50.f, 50.f, 20.f}};
+    std::vector<std::array<float, 3>> centres;
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> x(-45.f, 45.f);
+    std::uniform_real_distribution<float> t(-15.f, 15.f);
+    for (int k = 0; k < 40; ++k) {
+      centres.push_back({{x(gen), x(gen), t(gen)}});
+    }
+    auto points = generate<3, 0u>(min, max, centres, 1.5f, 50, 1000, 1);
+    ok &= compare<3, 0u>("3D", points, min, max, {{2.f, 2.f, 2.f}}, {2.f, 5.f, 2.f, densitykernels::Kernel::Flat, 1.f});
+    ok &= compare<3, 0u>(
+        "3D gaussian", points, min, max, {{2.f, 2.f, 2.f}}, {2.f, 5.f, 2.f, densitykernels::Kernel::Gaussian, 1.f});
+  }
+
+  // (z, phi), periodic in phi, with clusters across -pi/pi
+  {
+    constexpr float pi = M_PI;
+    std::array<float, 2> const min{{-100.f, -pi}};
+    std::array<float, 2> const max{{100.f, pi}};
+    std::vector<std::array<float, 2>> centres;
+    for (int k = 0; k < 20; ++k) {
+      centres.push_back({{-95.f + 10.f * k, (k % 2 ? pi : -pi) + 0.01f * (k - 10)}});
+      centres.push_back({{-95.f + 10.f * k, 0.3f * (k - 10)}});
+    }
+    auto points = generate<2, 0b10u>(min, max, centres, 0.05f, 40, 2000, 2);
+    ok &= compare<2, 0b10u>(
+        "2D periodic in y", points, min, max, {{0.2f, 0.2f}}, {0.15f, 5.f, 2.f, densitykernels::Kernel::Flat, 1.f});
+    ok &= compare<2, 0b10u>("2D periodic in y, gaussian",
+                            points,
+                            min,
+                            max,
+                            {{0.2f, 0.2f}},
+                            {0.15f, 5.f, 2.f, densitykernels::Kernel::Gaussian, 0.1f});
+  }
+
+  if (!ok) {
+    std::cout << "CLUEAlgoND differs from the brute-force reference" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+// Checks that reco::reduceRangeBranchless and the array overloads of
+// deltaPhi, normalizedPhi and deltaR2 give bit-identical results to the
+// scalar functions, over random angles, around the multiples of pi, and
+// on the half-turn ties where the rounding of the number of turns matters.
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "DataFormats/Math/deltaPhi.h"
+#include "DataFormats/Math/deltaR.h"
+#include "DataFormats/Math/normalizedPhi.h"
+
+namespace {
+  template <typename T>
+  bool sameBits(T a, T b) {
+    return std::memcmp(&a, &b, sizeof(T)) == 0;
+  }
+
+  template <typename T>
+  std::string typeName() {
+    return std::is_same_v<T, float> ? "float" : "double";
+  }
+
+  // reduceRangeBranchless(x) against reduceRange(x) for each x
+  template <typename T>
+  bool checkReduceRange(std::string const& name, std::vector<T> const& angles) {
+    int differ = 0;
+    for (T x : angles) {
+      T const expected = reco::reduceRange(x);
+      T const result = reco::reduceRangeBranchless(x);
+      if (!sameBits(result, expected)) {
+        if (differ < 10) {
+          std::cout << "  reduceRangeBranchless(" << x << ") = " << result << " instead of " << expected << std::endl;
+        }
+        ++differ;
+      }
+    }
+    std::cout << typeName<T>() << " " << name << ": " << differ << " of " << angles.size() << " angles differ"
+              << std::endl;
+    return differ == 0;
+  }
+
+  // the multiples of pi up to a few thousand turns, and their neighbours
+  template <typename T>
+  std::vector<T> multiplesOfPi() {
+    std::vector<T> angles;
+    for (int k = -10000; k <= 10000; ++k) {
+      T x = static_cast<T>(k * M_PI);
+      for (int i = 0; i < 4; ++i) {
+        x = std::nextafter(x, -std::numeric_limits<T>::infinity());
+      }
+      for (int i = 0; i < 9; ++i) {
+        angles.push_back(x);
+        x = std::nextafter(x, std::numeric_limits<T>::infinity());
+      }
+    }
+    return angles;
+  }
+
+  // the angles whose number of turns x / (2 pi), as computed by both
+  // functions, is exactly an integer and a half
+  template <typename T>
+  std::vector<T> halfTurnTies() {
+    constexpr T o2pi = 1. / (2. * M_PI);
+    std::vector<T> angles;
+    for (int k = -10000; k < 10000; ++k) {
+      T const half = T(k) + T(0.5);
+      T x = half / o2pi;
+      for (int i = 0; i < 8; ++i) {
+        x = std::nextafter(x, -std::numeric_limits<T>::infinity());
+      }
+      for (int i = 0; i < 17; ++i) {
+        if (x * o2pi == half) {
+          angles.push_back(x);
+        }
+        x = std::nextafter(x, std::numeric_limits<T>::infinity());
+      }
+    }
+    return angles;
+  }
+
+  template <typename T>
+  std::vector<T> uniform(std::mt19937& gen, T range, std::size_t n) {
+    std::uniform_real_distribution<T> flat(-range, range);
+    std::vector<T> angles(n);
+    for (auto& x : angles) {
+      x = flat(gen);
+    }
+    return angles;
+  }
+
+  // the array overloads against the scalar functions, element by element
+  template <typename T>
+  bool checkArrays(std::mt19937& gen) {
+    // not a multiple of the vector width, so that the loops also run their remainder
+    constexpr std::size_t n = 4099;
+    auto const phi1 = uniform<T>(gen, M_PI, n);
+    auto const phi2 = uniform<T>(gen, M_PI, n);
+    auto const eta2 = uniform<T>(gen, 3, n);
+    auto const wide = uniform<T>(gen, 100, n);
+    T const eta = 0.7;
+    std::vector<T> out(n);
+
+    int differ = 0;
+    auto check = [&](char const* name, auto&& scalar) {
+      int d = 0;
+      for (std::size_t i = 0; i < n; ++i) {
+        if (!sameBits(out[i], scalar(i))) {
+          ++d;
+        }
+      }
+      std::cout << typeName<T>() << " " << name << ": " << d << " of " << n << " elements differ" << std::endl;
+      differ += d;
+    };
+
+    reco::deltaPhi(phi1.data(), phi2.data(), out.data(), n);
+    check("deltaPhi of two arrays", [&](std::size_t i) { return reco::deltaPhi(phi1[i], phi2[i]); });
+    reco::deltaPhi(phi1[0], phi2.data(), out.data(), n);
+    check("deltaPhi of an angle and an array", [&](std::size_t i) { return reco::deltaPhi(phi1[0], phi2[i]); });
+    normalizedPhi(wide.data(), out.data(), n);
+    check("normalizedPhi of an array", [&](std::size_t i) { return normalizedPhi(wide[i]); });
+    reco::deltaR2(eta, phi1[0], eta2.data(), phi2.data(), out.data(), n);
+    check("deltaR2 of a point and an array", [&](std::size_t i) {
+      return reco::deltaR2(eta, phi1[0], eta2[i], phi2[i]);
+    });
+    return differ == 0;
+  }
+
+  template <typename T>
+  bool checkAll(std::mt19937& gen) {
+    bool ok = true;
+    // the difference of two angles in [-pi, pi]
+    ok &= checkReduceRange<T>("in [-3 pi, 3 pi]", uniform<T>(gen, 3 * M_PI, 1 << 20));
+    ok &= checkReduceRange<T>("in [-1e4, 1e4]", uniform<T>(gen, 1e4, 1 << 20));
+    ok &= checkReduceRange<T>("around the multiples of pi", multiplesOfPi<T>());
+    ok &= checkReduceRange<T>("on the half-turn ties", halfTurnTies<T>());
+    ok &= checkArrays<T>(gen);
+    return ok;
+  }
+}  // namespace
+
+int main() {
+  std::mt19937 gen(91);
+  bool ok = true;
+  ok &= checkAll<float>(gen);
+  ok &= checkAll<double>(gen);
+
+  if (!ok) {
+    std::cout << "The branchless range reduction differs from reco::reduceRange" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}